@@ -0,0 +1,27 @@
+#!/bin/bash
+# Builds and runs the benchmarks in bench/. Needs no audio hardware.
+set -e
+mkdir -p build
+g++ bench/uploadBench.cpp src/client.cpp src/flac.cpp src/imaAdpcm.cpp src/linkEstimator.cpp src/audioChunkQueue.cpp src/latency.cpp src/metrics.cpp src/AppLogger.cpp src/logFormat.cpp src/logArchiver.cpp -I include -O2 -lpthread -o build/upload-bench
+./build/upload-bench
+
+g++ bench/ownershipBench.cpp src/client.cpp src/flac.cpp src/imaAdpcm.cpp src/linkEstimator.cpp src/audioChunkQueue.cpp src/latency.cpp src/metrics.cpp src/AppLogger.cpp src/logFormat.cpp src/logArchiver.cpp -I include -O2 -lpthread -o build/ownership-bench
+./build/ownership-bench
+
+g++ bench/energyBench.cpp src/energy.cpp -I include -O2 -o build/energy-bench
+./build/energy-bench
+
+g++ bench/vadBench.cpp src/vad.cpp src/energy.cpp -I include -O2 -o build/vad-bench
+./build/vad-bench
+
+g++ bench/transportBench.cpp src/client.cpp src/flac.cpp src/imaAdpcm.cpp src/linkEstimator.cpp src/audioChunkQueue.cpp src/latency.cpp src/metrics.cpp src/AppLogger.cpp src/logFormat.cpp src/logArchiver.cpp src/mockOrchestrator.cpp -I include -O2 -lpthread -o build/transport-bench
+./build/transport-bench
+
+g++ bench/logBench.cpp src/AppLogger.cpp src/logFormat.cpp src/logArchiver.cpp -I include -O2 -lpthread -o build/log-bench
+./build/log-bench
+
+g++ bench/flacBench.cpp src/flac.cpp src/AppLogger.cpp src/logFormat.cpp src/logArchiver.cpp -I include -O2 -lpthread -o build/flac-bench
+./build/flac-bench
+
+g++ bench/responseDecodeBench.cpp src/streamingPlayer.cpp src/flac.cpp src/imaAdpcm.cpp src/latency.cpp src/AppLogger.cpp src/logFormat.cpp src/logArchiver.cpp -I include -O2 -lpthread -o build/response-decode-bench
+./build/response-decode-bench
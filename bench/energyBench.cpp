@@ -0,0 +1,84 @@
+// Energy kernel microbenchmark: checks every kernel available on this CPU
+// against the scalar reference and reports throughput on 20 ms VAD frames and
+// 512-sample Porcupine frames.
+//
+// Build and run through ./bench.sh.
+#include "energy.hpp"
+
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <vector>
+
+int main()
+{
+  std::mt19937 rng(42);
+  std::uniform_int_distribution<int> dist(-32768, 32767);
+
+  // Correctness: random data, odd lengths for the tails, and the worst case.
+  std::vector<int16_t> data(16000 * 10);
+  for (auto &s : data)
+  {
+    s = static_cast<int16_t>(dist(rng));
+  }
+  std::vector<int16_t> extreme(4099, -32768);
+
+  const auto kernels = energy::availableKernels();
+  bool allMatch = true;
+  for (const auto &kernel : kernels)
+  {
+    for (size_t len : {0UL, 1UL, 7UL, 15UL, 33UL, 320UL, 512UL, data.size()})
+    {
+      if (kernel.fn(data.data(), len) != energy::sumSquaresScalar(data.data(), len))
+      {
+        std::cerr << kernel.name << " mismatch at length " << len << std::endl;
+        allMatch = false;
+      }
+    }
+    if (kernel.fn(extreme.data(), extreme.size()) != energy::sumSquaresScalar(extreme.data(), extreme.size()))
+    {
+      std::cerr << kernel.name << " mismatch on -32768 run" << std::endl;
+      allMatch = false;
+    }
+  }
+
+  std::cout << "active kernel: " << energy::activeKernel().name << std::endl;
+  std::cout << std::left << std::setw(10) << "kernel"
+            << std::setw(18) << "ns/320 frame"
+            << std::setw(18) << "ns/512 frame"
+            << "Msamples/s" << std::endl;
+
+  volatile uint64_t sink = 0;
+  for (const auto &kernel : kernels)
+  {
+    double nsPerFrame[2];
+    double samplesPerSec = 0;
+    size_t frameSizes[2] = {320, 512};
+    for (int f = 0; f < 2; ++f)
+    {
+      const size_t frame = frameSizes[f];
+      const size_t frames = data.size() / frame;
+      const int repeats = 200;
+      auto start = std::chrono::steady_clock::now();
+      for (int r = 0; r < repeats; ++r)
+      {
+        for (size_t i = 0; i < frames; ++i)
+        {
+          sink = sink + kernel.fn(data.data() + i * frame, frame);
+        }
+      }
+      double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+      nsPerFrame[f] = ns / (frames * repeats);
+      samplesPerSec = frames * frame * repeats / (ns / 1e9);
+    }
+    std::cout << std::left << std::setw(10) << kernel.name
+              << std::setw(18) << nsPerFrame[0]
+              << std::setw(18) << nsPerFrame[1]
+              << samplesPerSec / 1e6 << std::endl;
+  }
+
+  std::cout << (allMatch ? "all kernels match the scalar reference" : "KERNEL MISMATCH") << std::endl;
+  return allMatch ? 0 : 1;
+}
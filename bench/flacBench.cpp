@@ -0,0 +1,209 @@
+// FLAC upload benchmark: encodes synthetic voice commands (formant-shaped
+// harmonic speech with fricatives and pauses, over a quiet-room or fan noise
+// floor), checks the round trip through flac::Decoder is bit exact, and
+// reports the size against the WAV body and the encode speed relative to real
+// time at each LPC order.
+//
+// Build and run through ./bench.sh.
+#include "flac.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <vector>
+
+namespace
+{
+  constexpr int SAMPLE_RATE = 16000;
+  constexpr float PI = 3.14159265f;
+
+  float formantGain(float freq, float f1, float f2)
+  {
+    auto peak = [](float f, float centre, float width)
+    {
+      const float d = (f - centre) / width;
+      return 1.0f / (1.0f + d * d);
+    };
+    return peak(freq, f1, 90) + 0.6f * peak(freq, f2, 130) + 0.3f * peak(freq, 2600, 200);
+  }
+
+  // About five seconds: a short lead-in, two or three utterances with gaps.
+  std::vector<int16_t> makeCommand(float noiseRms, bool fan, unsigned seed)
+  {
+    std::mt19937 rng(seed);
+    std::normal_distribution<float> gauss(0.0f, 1.0f);
+    std::uniform_real_distribution<float> uni(0.0f, 1.0f);
+
+    std::vector<float> speech(5 * SAMPLE_RATE, 0.0f);
+    size_t pos = SAMPLE_RATE / 4;
+    while (pos < speech.size() - SAMPLE_RATE)
+    {
+      const size_t len = std::min(static_cast<size_t>((0.8f + uni(rng)) * SAMPLE_RATE), speech.size() - pos);
+      const float f1 = 500 + 300 * uni(rng);
+      const float f2 = 1200 + 800 * uni(rng);
+      float pitch = 110 + 100 * uni(rng);
+      float phase = 0;
+      float lastNoise = 0;
+      const float syllableRate = 3.0f + 2.0f * uni(rng);
+      for (size_t i = 0; i < len; ++i)
+      {
+        const float t = static_cast<float>(i) / SAMPLE_RATE;
+        const float env = 0.55f + 0.45f * std::sin(2 * PI * syllableRate * t);
+        float y = 0;
+        if (std::fmod(t * syllableRate, 2.0f) > 1.7f)
+        {
+          const float n = gauss(rng);
+          y = 0.5f * (n - lastNoise);
+          lastNoise = n;
+        }
+        else
+        {
+          phase += pitch / SAMPLE_RATE;
+          phase -= std::floor(phase);
+          for (int h = 1; h * pitch < 4000; ++h)
+          {
+            y += formantGain(h * pitch, f1, f2) * std::sin(2 * PI * h * phase);
+          }
+          y *= 0.5f;
+        }
+        speech[pos + i] = 3000.0f * env * y;
+        pitch = std::clamp(pitch + 0.002f * gauss(rng), 90.0f, 240.0f);
+      }
+      pos += len + static_cast<size_t>((0.2f + 0.4f * uni(rng)) * SAMPLE_RATE);
+    }
+
+    std::vector<int16_t> audio(speech.size());
+    float brown = 0;
+    for (size_t i = 0; i < speech.size(); ++i)
+    {
+      float n = gauss(rng);
+      if (fan)
+      {
+        brown = 0.98f * brown + 0.2f * n;
+        n = brown + 0.5f * std::sin(2 * PI * 120 * i / SAMPLE_RATE) + 0.3f * gauss(rng);
+      }
+      audio[i] = static_cast<int16_t>(std::clamp(std::round(speech[i] + noiseRms * n), -32768.0f, 32767.0f));
+    }
+    return audio;
+  }
+
+  // Decodes in uneven pieces, as a download would arrive.
+  bool roundTrips(const std::vector<int16_t> &audio, int channels, const std::vector<uint8_t> &encoded)
+  {
+    flac::Decoder decoder;
+    std::vector<int16_t> decoded;
+    std::mt19937 rng(7);
+    std::uniform_int_distribution<size_t> piece(1, 3000);
+    for (size_t offset = 0; offset < encoded.size();)
+    {
+      const size_t n = std::min(piece(rng), encoded.size() - offset);
+      if (!decoder.feed(encoded.data() + offset, n, decoded))
+      {
+        return false;
+      }
+      offset += n;
+    }
+    return decoder.idle() && decoder.sampleRate() == SAMPLE_RATE && decoder.channels() == channels && decoded == audio;
+  }
+}
+
+int main()
+{
+  struct Case
+  {
+    const char *name;
+    std::vector<int16_t> audio;
+    int channels;
+  };
+  std::vector<Case> cases;
+  cases.push_back({"quiet room", makeCommand(30.0f, false, 1), 1});
+  cases.push_back({"fan noise", makeCommand(200.0f, true, 2), 1});
+
+  // Edge cases: silence, full-scale noise, a partial last block, stereo.
+  std::vector<int16_t> silence(SAMPLE_RATE * 2, 0);
+  std::vector<int16_t> noise(SAMPLE_RATE * 2);
+  std::mt19937 rng(3);
+  std::uniform_int_distribution<int> full(-32768, 32767);
+  for (auto &s : noise)
+  {
+    s = static_cast<int16_t>(full(rng));
+  }
+  std::vector<int16_t> odd(cases[0].audio.begin(), cases[0].audio.begin() + 12345);
+  std::vector<int16_t> stereo;
+  for (size_t i = 0; i < SAMPLE_RATE * 2; ++i)
+  {
+    stereo.push_back(cases[0].audio[i]);
+    stereo.push_back(cases[1].audio[i]);
+  }
+
+  bool allExact = true;
+  for (const auto &edge : {Case{"silence", silence, 1}, Case{"white noise", noise, 1},
+                           Case{"odd length", odd, 1}, Case{"stereo", stereo, 2}})
+  {
+    std::vector<uint8_t> encoded;
+    flac::encode(edge.audio.data(), edge.audio.size(), SAMPLE_RATE, edge.channels, encoded);
+    if (!roundTrips(edge.audio, edge.channels, encoded))
+    {
+      std::cerr << edge.name << ": round trip mismatch" << std::endl;
+      allExact = false;
+    }
+  }
+
+  std::cout << std::left << std::setw(12) << "audio"
+            << std::setw(8) << "order"
+            << std::setw(12) << "wav bytes"
+            << std::setw(12) << "flac bytes"
+            << std::setw(10) << "saved"
+            << std::setw(14) << "encode x RT"
+            << "decode x RT" << std::endl;
+
+  for (const auto &c : cases)
+  {
+    const size_t wavBytes = 44 + c.audio.size() * sizeof(int16_t);
+    const double seconds = static_cast<double>(c.audio.size()) / SAMPLE_RATE;
+    for (int order : {0, 4, 8, 12})
+    {
+      std::vector<uint8_t> encoded;
+      const int repeats = 20;
+      auto start = std::chrono::steady_clock::now();
+      for (int r = 0; r < repeats; ++r)
+      {
+        encoded.clear();
+        flac::Encoder encoder(SAMPLE_RATE, c.channels, order);
+        encoder.begin(encoded, c.audio.size());
+        encoder.push(c.audio.data(), c.audio.size(), encoded);
+        encoder.finish(encoded);
+      }
+      const double encodeSec = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() / repeats;
+
+      start = std::chrono::steady_clock::now();
+      std::vector<int16_t> decoded;
+      for (int r = 0; r < repeats; ++r)
+      {
+        flac::Decoder decoder;
+        decoded.clear();
+        decoder.feed(encoded.data(), encoded.size(), decoded);
+      }
+      const double decodeSec = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() / repeats;
+
+      if (!roundTrips(c.audio, c.channels, encoded))
+      {
+        std::cerr << c.name << " order " << order << ": round trip mismatch" << std::endl;
+        allExact = false;
+      }
+      std::cout << std::left << std::setw(12) << c.name
+                << std::setw(8) << order
+                << std::setw(12) << wavBytes
+                << std::setw(12) << encoded.size()
+                << std::setw(10) << (std::to_string(static_cast<int>(std::lround(100.0 * (1.0 - static_cast<double>(encoded.size()) / wavBytes)))) + "%")
+                << std::setw(14) << static_cast<int>(seconds / encodeSec)
+                << static_cast<int>(seconds / decodeSec) << std::endl;
+    }
+  }
+
+  std::cout << (allExact ? "round trips: all bit exact" : "round trips: MISMATCH") << std::endl;
+  return allExact ? 0 : 1;
+}
@@ -0,0 +1,103 @@
+// Logging cost of one interaction on the producer side, i.e. what the
+// recorder and HttpClient threads pay. "before" replays the old pattern: the
+// VAD and upload progress lines written with std::cout << ... << std::endl
+// (one flush each) and the summary lines built by string concatenation.
+// "after" makes the same calls through LOG_* with logLevel = info, which
+// filters the progress lines, and with logLevel = debug, which queues them.
+//
+// Build and run through ./bench.sh.
+#include "AppLogger.hpp"
+
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <thread>
+
+namespace
+{
+  // Sized so a batch never fills the logger queue; the writer drains
+  // between batches, outside the timed region.
+  constexpr int BATCH = 40;
+  constexpr int BATCHES = 250;
+
+  struct Interaction
+  {
+    size_t samples = 48000;
+    int speechMs = 2700;
+    int latencyMs = 310;
+    int hangoverMs = 300;
+    size_t responseBytes = 96044;
+  };
+
+  void before(std::ostream &out, const Interaction &i)
+  {
+    out << "[VAD] Listening for voice..." << std::endl;
+    out << "[VAD] Voice detected. Recording..." << std::endl;
+    out << "[VAD] Endpoint (silence): speech " << i.speechMs << " ms, endpoint latency " << i.latencyMs
+        << " ms, hangover " << i.hangoverMs << " ms" << std::endl;
+    out << "[Recorder] Audio recorded: " << i.samples << " samples" << std::endl;
+    AppLogger::getInstance().info("Voice command recorded: " + std::to_string(i.samples) + " samples, endpoint silence after " +
+                                  std::to_string(i.speechMs) + " ms of speech, endpoint latency " + std::to_string(i.latencyMs) + " ms");
+    out << "processing audio in-memory: " << i.samples << " samples" << std::endl;
+    out << "upload successful, received response size: " << i.responseBytes << " bytes." << std::endl;
+    AppLogger::getInstance().info("Command audio successfully sent.");
+  }
+
+  void after(const Interaction &i)
+  {
+    LOG_DEBUG("VAD: listening for voice...");
+    LOG_DEBUG("VAD: voice detected. Recording...");
+    LOG_DEBUG("VAD: endpoint ({}): speech {} ms, endpoint latency {} ms, hangover {} ms", "silence", i.speechMs, i.latencyMs, i.hangoverMs);
+    LOG_DEBUG("Recorder: audio recorded: {} samples", i.samples);
+    LOG_INFO("Voice command recorded: {} samples, endpoint {} after {} ms of speech, endpoint latency {} ms",
+             i.samples, "silence", i.speechMs, i.latencyMs);
+    LOG_DEBUG("HttpClient: processing audio in-memory: {} samples", i.samples);
+    LOG_DEBUG("HttpClient: upload successful, {} response size: {} bytes.", "received", i.responseBytes);
+    LOG_INFO("Command audio successfully sent.");
+  }
+
+  template <typename F>
+  double nsPerInteraction(F &&interaction)
+  {
+    double ns = 0;
+    for (int b = 0; b < BATCHES; ++b)
+    {
+      const auto start = std::chrono::steady_clock::now();
+      for (int i = 0; i < BATCH; ++i)
+      {
+        interaction();
+      }
+      ns += std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+      std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    }
+    return ns / (BATCH * BATCHES);
+  }
+}
+
+int main()
+{
+  AppLogger::getInstance().open("build/log-bench.log");
+  std::ofstream console("/dev/null");
+  const Interaction interaction;
+
+  std::cout << std::left << std::setw(28) << "variant" << "ns/interaction" << std::endl;
+
+  AppLogger::setLevel(AppLogger::Level::Info);
+  const double baseline = nsPerInteraction([&]
+                                           { before(console, interaction); });
+  std::cout << std::setw(28) << "before (cout + endl)" << baseline << std::endl;
+
+  const double filtered = nsPerInteraction([&]
+                                           { after(interaction); });
+  std::cout << std::setw(28) << "after, logLevel = info" << filtered << std::endl;
+
+  AppLogger::setLevel(AppLogger::Level::Debug);
+  const double queued = nsPerInteraction([&]
+                                         { after(interaction); });
+  std::cout << std::setw(28) << "after, logLevel = debug" << queued << std::endl;
+
+  std::cout << "dropped records: " << AppLogger::getInstance().droppedRecords() << std::endl;
+  return 0;
+}
@@ -0,0 +1,106 @@
+// Buffer ownership check: drives postOrch / takeLastResponseAudio /
+// recycleResponseBuffer against a local server and counts large heap
+// allocations per interaction. After warm-up the steady state must allocate
+// no buffer the size of the audio, i.e. nothing is copied.
+//
+// Build and run through ./bench.sh.
+#include "client.hpp"
+#include "httplib.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+namespace
+{
+  constexpr int PORT = 18932;
+  constexpr size_t LARGE_ALLOCATION = 64 * 1024;
+  constexpr size_t RESPONSE_BYTES = 2 * 1024 * 1024;
+
+  std::atomic<uint64_t> largeAllocations{0};
+  std::atomic<uint64_t> largeBytes{0};
+
+  // Only the client side is measured; the server thread buffers request bodies.
+  thread_local bool countThisThread = false;
+}
+
+void *operator new(size_t size)
+{
+  if (countThisThread && size >= LARGE_ALLOCATION)
+  {
+    largeAllocations.fetch_add(1, std::memory_order_relaxed);
+    largeBytes.fetch_add(size, std::memory_order_relaxed);
+  }
+  if (void *p = std::malloc(size))
+  {
+    return p;
+  }
+  throw std::bad_alloc();
+}
+
+void operator delete(void *p) noexcept { std::free(p); }
+void operator delete(void *p, size_t) noexcept { std::free(p); }
+
+int main()
+{
+  const std::string response(RESPONSE_BYTES, 'x');
+
+  httplib::Server server;
+  server.Post("/process-audio", [&](const httplib::Request &, httplib::Response &res)
+              {
+    res.set_content_provider(response.size(), "audio/wav",
+                             [&](size_t offset, size_t length, httplib::DataSink &sink)
+                             { return sink.write(response.data() + offset, std::min<size_t>(length, 64 * 1024)); }); });
+  std::thread serverThread([&]()
+                           { server.listen("127.0.0.1", PORT); });
+  server.wait_until_ready();
+
+  HttpClient client("127.0.0.1", PORT, "bench");
+  std::vector<int16_t> recording(10 * 16000, 1);
+
+  std::ostringstream quiet;
+  std::streambuf *coutBuf = std::cout.rdbuf(quiet.rdbuf());
+
+  countThisThread = true;
+  bool copyFree = true;
+  std::vector<std::pair<uint64_t, uint64_t>> perIteration;
+  for (int i = 0; i < 10; ++i)
+  {
+    uint64_t allocsBefore = largeAllocations.load();
+    uint64_t bytesBefore = largeBytes.load();
+
+    client.postOrch("/process-audio", recording, 16000, 1);
+    std::vector<uint8_t> audio = client.takeLastResponseAudio();
+    if (audio.size() != RESPONSE_BYTES)
+    {
+      copyFree = false;
+    }
+    client.recycleResponseBuffer(std::move(audio));
+
+    perIteration.emplace_back(largeAllocations.load() - allocsBefore, largeBytes.load() - bytesBefore);
+  }
+
+  countThisThread = false;
+  std::cout.rdbuf(coutBuf);
+  for (size_t i = 0; i < perIteration.size(); ++i)
+  {
+    std::cout << "interaction " << i << ": " << perIteration[i].first << " large allocations, "
+              << perIteration[i].second << " bytes" << std::endl;
+    // The first interaction sizes the pooled buffer; after that nothing may grow.
+    if (i >= 1 && perIteration[i].first != 0)
+    {
+      copyFree = false;
+    }
+  }
+  std::cout << "response pool: " << client.responsePool().acquiredCount() << " acquired, "
+            << client.responsePool().allocatedCount() << " allocated" << std::endl;
+  std::cout << (copyFree ? "PASS: steady state is copy-free" : "FAIL: steady state allocates") << std::endl;
+
+  server.stop();
+  serverThread.join();
+  return copyFree ? 0 : 1;
+}
@@ -0,0 +1,327 @@
+// Response decoding check: feeds every encoding StreamingPlayer accepts (PCM16,
+// A-law, mu-law and IMA ADPCM WAV, and FLAC) through it whole, a byte at a
+// time, in odd-sized pieces and in uneven pieces, as a download would arrive.
+// Checks the output against the source audio (bit exact for PCM and FLAC, at
+// least 30 dB SNR for IMA ADPCM, exact length from the fact chunk) and the
+// G.711 expansion against the ITU reference decoders, and reports decode speed.
+//
+// Build and run through ./bench.sh.
+#include "streamingPlayer.hpp"
+#include "flac.hpp"
+#include "imaAdpcm.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace
+{
+  constexpr int SAMPLE_RATE = 16000;
+  constexpr float PI = 3.14159265f;
+
+  // Keeps what it is given, so the decoded audio can be compared.
+  class CaptureSink : public AudioSink
+  {
+  public:
+    bool open(int sampleRate, int channels) override
+    {
+      sampleRate_ = sampleRate;
+      channels_ = channels;
+      samples_.clear();
+      return true;
+    }
+
+    bool write(const int16_t *samples, size_t count) override
+    {
+      samples_.insert(samples_.end(), samples, samples + count);
+      return true;
+    }
+
+    bool drain() override { return true; }
+    void abort() override {}
+
+    const std::vector<int16_t> &samples() const { return samples_; }
+    int sampleRate() const { return sampleRate_; }
+    int channels() const { return channels_; }
+
+  private:
+    int sampleRate_ = 0;
+    int channels_ = 0;
+    std::vector<int16_t> samples_;
+  };
+
+  // Reference expansions from the ITU-T G.711 software tools (g711.c).
+  int alawToLinear(uint8_t code)
+  {
+    code ^= 0x55;
+    int t = (code & 0x0F) << 4;
+    const int segment = (code & 0x70) >> 4;
+    switch (segment)
+    {
+    case 0:
+      t += 8;
+      break;
+    case 1:
+      t += 0x108;
+      break;
+    default:
+      t += 0x108;
+      t <<= segment - 1;
+    }
+    return (code & 0x80) ? t : -t;
+  }
+
+  int mulawToLinear(uint8_t code)
+  {
+    code = ~code;
+    int t = ((code & 0x0F) << 3) + 0x84;
+    t <<= (code & 0x70) >> 4;
+    return (code & 0x80) ? 0x84 - t : t - 0x84;
+  }
+
+  // Three seconds of a vowel-like tone (harmonics falling at 12 dB per octave)
+  // with a syllable envelope, over a little noise.
+  std::vector<int16_t> makeVoice(int channels)
+  {
+    std::mt19937 rng(11);
+    std::normal_distribution<float> gauss(0.0f, 1.0f);
+    std::vector<int16_t> audio(3 * SAMPLE_RATE * channels + 123 * channels); // not a whole number of blocks
+    for (size_t i = 0; i < audio.size() / channels; ++i)
+    {
+      const float t = static_cast<float>(i) / SAMPLE_RATE;
+      const float env = 0.55f + 0.45f * std::sin(2 * PI * 4 * t);
+      float y = 0;
+      for (int h = 1; h * 140 < 4000; ++h)
+      {
+        y += std::sin(2 * PI * h * 140 * t) / (h * h);
+      }
+      for (int c = 0; c < channels; ++c)
+      {
+        const float v = 6000.0f * env * y * (c == 0 ? 1.0f : 0.7f) + 40.0f * gauss(rng);
+        audio[i * channels + c] = static_cast<int16_t>(std::clamp(std::round(v), -32768.0f, 32767.0f));
+      }
+    }
+    return audio;
+  }
+
+  void putU16(std::vector<uint8_t> &out, uint16_t v)
+  {
+    out.push_back(static_cast<uint8_t>(v));
+    out.push_back(static_cast<uint8_t>(v >> 8));
+  }
+
+  void putU32(std::vector<uint8_t> &out, uint32_t v)
+  {
+    putU16(out, static_cast<uint16_t>(v));
+    putU16(out, static_cast<uint16_t>(v >> 16));
+  }
+
+  // A WAV with a streamed (bogus) data size, as an orchestrator would send.
+  // A non-zero factFrames adds a fact chunk declaring that many frames.
+  std::vector<uint8_t> makeWav(uint16_t formatTag, int channels, int bitsPerSample, const std::vector<uint8_t> &payload,
+                               uint32_t factFrames = 0)
+  {
+    const uint16_t blockAlign = static_cast<uint16_t>(channels * bitsPerSample / 8);
+    std::vector<uint8_t> wav;
+    wav.insert(wav.end(), {'R', 'I', 'F', 'F'});
+    putU32(wav, 0xFFFFFFFF);
+    wav.insert(wav.end(), {'W', 'A', 'V', 'E', 'f', 'm', 't', ' '});
+    putU32(wav, 16);
+    putU16(wav, formatTag);
+    putU16(wav, static_cast<uint16_t>(channels));
+    putU32(wav, SAMPLE_RATE);
+    putU32(wav, SAMPLE_RATE * blockAlign);
+    putU16(wav, blockAlign);
+    putU16(wav, static_cast<uint16_t>(bitsPerSample));
+    if (factFrames > 0)
+    {
+      wav.insert(wav.end(), {'f', 'a', 'c', 't'});
+      putU32(wav, 4);
+      putU32(wav, factFrames);
+    }
+    wav.insert(wav.end(), {'d', 'a', 't', 'a'});
+    putU32(wav, 0xFFFFFFFF);
+    wav.insert(wav.end(), payload.begin(), payload.end());
+    return wav;
+  }
+
+  // Plays body through a StreamingPlayer in pieces drawn from pieceSize.
+  bool play(const std::vector<uint8_t> &body, const std::function<size_t()> &pieceSize, CaptureSink &sink)
+  {
+    StreamingPlayer player(sink);
+    player.reset();
+    for (size_t offset = 0; offset < body.size();)
+    {
+      const size_t n = std::min(pieceSize(), body.size() - offset);
+      if (!player.feed(reinterpret_cast<const char *>(body.data()) + offset, n))
+      {
+        return false;
+      }
+      offset += n;
+    }
+    return player.finish();
+  }
+
+  double snrDb(const std::vector<int16_t> &reference, const std::vector<int16_t> &decoded)
+  {
+    double signal = 0;
+    double noise = 0;
+    for (size_t i = 0; i < reference.size(); ++i)
+    {
+      const double d = static_cast<double>(reference[i]) - decoded[i];
+      signal += static_cast<double>(reference[i]) * reference[i];
+      noise += d * d;
+    }
+    return noise > 0 ? 10.0 * std::log10(signal / noise) : 999.0;
+  }
+
+  struct Case
+  {
+    std::string name;
+    std::vector<uint8_t> body;
+    int channels;
+    std::vector<int16_t> expected;
+    double minSnrDb; // 0 = must be bit exact
+  };
+}
+
+int main()
+{
+  std::vector<Case> cases;
+  for (int channels : {1, 2})
+  {
+    const std::string suffix = channels == 1 ? "" : " stereo";
+    const std::vector<int16_t> voice = makeVoice(channels);
+
+    std::vector<uint8_t> pcm(voice.size() * sizeof(int16_t));
+    std::memcpy(pcm.data(), voice.data(), pcm.size());
+    cases.push_back({"pcm16" + suffix, makeWav(0x0001, channels, 16, pcm), channels, voice, 0});
+
+    std::vector<uint8_t> ima;
+    ima::encodeWav(voice.data(), voice.size(), SAMPLE_RATE, channels, ima);
+    cases.push_back({"ima adpcm" + suffix, ima, channels, voice, 30.0});
+
+    std::vector<uint8_t> encoded;
+    flac::encode(voice.data(), voice.size(), SAMPLE_RATE, channels, encoded);
+    cases.push_back({"flac" + suffix, encoded, channels, voice, 0});
+  }
+
+  // Every G.711 code, a few times over, against the reference expansion.
+  for (bool aLaw : {true, false})
+  {
+    std::vector<uint8_t> codes;
+    std::vector<int16_t> expected;
+    for (int r = 0; r < 64; ++r)
+    {
+      for (int code = 0; code < 256; ++code)
+      {
+        codes.push_back(static_cast<uint8_t>(code));
+        expected.push_back(static_cast<int16_t>(aLaw ? alawToLinear(static_cast<uint8_t>(code))
+                                                     : mulawToLinear(static_cast<uint8_t>(code))));
+      }
+    }
+    cases.push_back({aLaw ? "a-law" : "mu-law", makeWav(aLaw ? 0x0006 : 0x0007, 1, 8, codes), 1, expected, 0});
+  }
+
+  // Stereo G.711 whose fact chunk stops short of the data: the output must be
+  // cut after the declared frames even when a read ends mid-frame.
+  for (bool aLaw : {true, false})
+  {
+    constexpr uint32_t FACT_FRAMES = 1000;
+    std::vector<uint8_t> codes;
+    std::vector<int16_t> expected;
+    for (uint32_t frame = 0; frame < FACT_FRAMES + 37; ++frame)
+    {
+      for (int c = 0; c < 2; ++c)
+      {
+        const uint8_t code = static_cast<uint8_t>(frame * 7 + c * 128);
+        codes.push_back(code);
+        if (frame < FACT_FRAMES)
+        {
+          expected.push_back(static_cast<int16_t>(aLaw ? alawToLinear(code) : mulawToLinear(code)));
+        }
+      }
+    }
+    cases.push_back({aLaw ? "a-law stereo" : "mu-law stereo", makeWav(aLaw ? 0x0006 : 0x0007, 2, 8, codes, FACT_FRAMES),
+                     2, expected, 0});
+  }
+
+  std::cout << std::left << std::setw(18) << "encoding"
+            << std::setw(10) << "bytes"
+            << std::setw(10) << "samples"
+            << std::setw(12) << "quality"
+            << std::setw(14) << "any split"
+            << "decode x RT" << std::endl;
+
+  bool allOk = true;
+  for (const auto &c : cases)
+  {
+    CaptureSink whole;
+    const size_t bodySize = c.body.size();
+    const int repeats = 20;
+    bool ok = true;
+    auto start = std::chrono::steady_clock::now();
+    for (int r = 0; r < repeats; ++r)
+    {
+      ok = play(c.body, [bodySize]
+                { return bodySize; }, whole) && ok;
+    }
+    const double decodeSec = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() / repeats;
+
+    ok = ok && whole.sampleRate() == SAMPLE_RATE && whole.channels() == c.channels &&
+         whole.samples().size() == c.expected.size();
+    std::string quality = "-";
+    if (ok && c.minSnrDb > 0)
+    {
+      const double snr = snrDb(c.expected, whole.samples());
+      std::ostringstream text;
+      text << std::fixed << std::setprecision(1) << snr << " dB";
+      quality = text.str();
+      ok = snr >= c.minSnrDb;
+    }
+    else if (ok)
+    {
+      ok = whole.samples() == c.expected;
+      quality = ok ? "exact" : "MISMATCH";
+    }
+
+    // Same output whether the body arrives a byte at a time, in odd-sized
+    // pieces that end mid-frame, or in uneven pieces.
+    CaptureSink bytewise;
+    CaptureSink threes;
+    CaptureSink sevens;
+    CaptureSink uneven;
+    std::mt19937 rng(5);
+    std::uniform_int_distribution<size_t> piece(1, 1500);
+    const bool splitOk = play(c.body, []
+                              { return size_t{1}; }, bytewise) &&
+                         play(c.body, []
+                              { return size_t{3}; }, threes) &&
+                         play(c.body, []
+                              { return size_t{7}; }, sevens) &&
+                         play(c.body, [&]
+                              { return piece(rng); }, uneven) &&
+                         bytewise.samples() == whole.samples() && threes.samples() == whole.samples() &&
+                         sevens.samples() == whole.samples() && uneven.samples() == whole.samples();
+
+    const double seconds = static_cast<double>(c.expected.size()) / c.channels / SAMPLE_RATE;
+    std::cout << std::left << std::setw(18) << c.name
+              << std::setw(10) << c.body.size()
+              << std::setw(10) << whole.samples().size()
+              << std::setw(12) << quality
+              << std::setw(14) << (splitOk ? "identical" : "DIFFERS")
+              << static_cast<int>(seconds / decodeSec) << std::endl;
+    allOk = allOk && ok && splitOk;
+  }
+
+  std::cout << (allOk ? "response decoding: all checks passed" : "response decoding: FAILED") << std::endl;
+  return allOk ? 0 : 1;
+}
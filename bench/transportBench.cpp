@@ -0,0 +1,157 @@
+// Transport benchmark: drives HttpClient::postOrch against the in-process mock
+// orchestrator and reports requests per second and latency percentiles per
+// payload size. A second pass injects 500s, dropped connections and slow
+// trickles, and runs main.cpp's retry loop (without the back-off sleep) to
+// show what the faults cost end to end.
+//
+// Build and run through ./bench.sh.
+#include "client.hpp"
+#include "metrics.hpp"
+#include "mockOrchestrator.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <vector>
+
+namespace
+{
+  constexpr int PORT = 18932;
+  constexpr int REQUESTS = 100;
+  constexpr int MAX_POST_RETRIES = 5; // retry.maxPostRetries default
+  const char *AUTH = "bench-token";
+
+  double percentile(std::vector<double> sorted, double p)
+  {
+    if (sorted.empty())
+    {
+      return 0.0;
+    }
+    std::sort(sorted.begin(), sorted.end());
+    const size_t index = std::min(sorted.size() - 1, static_cast<size_t>(p / 100.0 * sorted.size()));
+    return sorted[index];
+  }
+
+  struct Result
+  {
+    double rps = 0;
+    double p50 = 0, p95 = 0, p99 = 0;
+    int succeeded = 0;
+    int attempts = 0;
+  };
+
+  // Each sample is one command: up to MAX_POST_RETRIES attempts, as in main.cpp.
+  Result run(HttpClient &client, const std::vector<int16_t> &pcm, int requests)
+  {
+    std::vector<double> latencies;
+    latencies.reserve(requests);
+    Result result;
+
+    const auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < requests; ++i)
+    {
+      const auto t0 = std::chrono::steady_clock::now();
+      bool ok = false;
+      for (int attempt = 0; attempt < MAX_POST_RETRIES && !ok; ++attempt)
+      {
+        result.attempts++;
+        ok = client.postOrch("/process-audio", pcm, 16000, 1);
+      }
+      latencies.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count());
+      result.succeeded += ok;
+      client.recycleResponseBuffer(client.takeLastResponseAudio());
+    }
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    result.rps = requests / seconds;
+    result.p50 = percentile(latencies, 50);
+    result.p95 = percentile(latencies, 95);
+    result.p99 = percentile(latencies, 99);
+    return result;
+  }
+
+  void printHeader()
+  {
+    std::cout << std::left << std::setw(10) << "seconds"
+              << std::setw(12) << "req/s"
+              << std::setw(12) << "p50 ms"
+              << std::setw(12) << "p95 ms"
+              << std::setw(12) << "p99 ms"
+              << std::setw(12) << "success"
+              << "attempts" << std::endl;
+  }
+
+  void printRow(int seconds, const Result &r)
+  {
+    std::cout << std::left << std::setw(10) << seconds
+              << std::fixed << std::setprecision(1)
+              << std::setw(12) << r.rps
+              << std::setw(12) << r.p50
+              << std::setw(12) << r.p95
+              << std::setw(12) << r.p99
+              << std::setw(12) << (std::to_string(r.succeeded) + "/" + std::to_string(REQUESTS))
+              << r.attempts << std::endl;
+  }
+
+  void benchmark(const char *title, const MockOrchestratorOptions &options)
+  {
+    MockOrchestrator server(options);
+    if (!server.start("127.0.0.1", PORT))
+    {
+      std::cerr << "could not bind mock orchestrator to port " << PORT << std::endl;
+      return;
+    }
+    HttpClient client("127.0.0.1", PORT, AUTH);
+    const uint64_t requestsBefore = Metrics::getInstance().get(Metrics::Counter::HttpRequests);
+    const uint64_t connectionsBefore = Metrics::getInstance().get(Metrics::Counter::HttpConnectionsOpened);
+
+    std::cout << "\n"
+              << title << std::endl;
+    printHeader();
+
+    for (int seconds : {1, 5, 15})
+    {
+      std::vector<int16_t> pcm(static_cast<size_t>(seconds) * 16000);
+      for (size_t i = 0; i < pcm.size(); ++i)
+      {
+        pcm[i] = static_cast<int16_t>((i * 7919) & 0x7FFF);
+      }
+
+      // Keep HttpClient's per-request chatter out of the table.
+      std::ostringstream quiet;
+      std::streambuf *coutBuf = std::cout.rdbuf(quiet.rdbuf());
+      std::streambuf *cerrBuf = std::cerr.rdbuf(quiet.rdbuf());
+      Result result = run(client, pcm, REQUESTS);
+      std::cout.rdbuf(coutBuf);
+      std::cerr.rdbuf(cerrBuf);
+
+      printRow(seconds, result);
+    }
+
+    std::cout << "server: " << server.requests() << " requests, " << server.injectedFailures() << " 500s, "
+              << server.injectedResets() << " resets, " << server.trickled() << " trickled, "
+              << server.rejectedAuth() << " auth rejections" << std::endl;
+    const uint64_t requests = Metrics::getInstance().get(Metrics::Counter::HttpRequests) - requestsBefore;
+    const uint64_t connections = Metrics::getInstance().get(Metrics::Counter::HttpConnectionsOpened) - connectionsBefore;
+    std::cout << "client: " << requests << " requests on " << connections << " connections" << std::endl;
+  }
+}
+
+int main()
+{
+  MockOrchestratorOptions clean;
+  clean.authToken = AUTH;
+  clean.responseBytes = 64 * 1024;
+  benchmark("clean (64 KiB responses, no added latency)", clean);
+
+  MockOrchestratorOptions faulty = clean;
+  faulty.latencyMs = 20;
+  faulty.failRate = 0.10;
+  faulty.resetRate = 0.05;
+  faulty.trickleRate = 0.05;
+  faulty.trickleBytesPerSecond = 512 * 1024;
+  benchmark("faulty (20 ms latency, 10% 500s, 5% resets, 5% trickled at 512 KiB/s), with retries", faulty);
+  return 0;
+}
@@ -0,0 +1,133 @@
+// Upload path benchmark: the original buffered multipart construction versus
+// HttpClient's zero-copy content provider, against a local httplib server.
+//
+// Build and run through ./bench.sh, or directly:
+//   g++ bench/uploadBench.cpp src/client.cpp src/audioChunkQueue.cpp -I include -O2 -lpthread -o upload-bench
+#include "client.hpp"
+#include "httplib.h"
+
+#include <chrono>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+namespace
+{
+  constexpr int PORT = 18931;
+  constexpr int ITERATIONS = 50;
+
+  // The pre-zero-copy postOrch, kept here as the baseline. Returns the number
+  // of bytes it copied into intermediate buffers before handing off to httplib.
+  size_t legacyPost(httplib::Client &cli, const std::vector<int16_t> &pcm)
+  {
+    WavHeader header;
+    header.numChannels = 1;
+    header.sampleRate = 16000;
+    header.byteRate = 32000;
+    header.blockAlign = 2;
+    uint32_t dataSize = pcm.size() * sizeof(int16_t);
+    header.dataSize = dataSize;
+    header.fileSize = sizeof(WavHeader) - 8 + dataSize;
+
+    std::vector<uint8_t> wavData(sizeof(WavHeader));
+    std::memcpy(wavData.data(), &header, sizeof(WavHeader));
+    const uint8_t *bytes = reinterpret_cast<const uint8_t *>(pcm.data());
+    wavData.insert(wavData.end(), bytes, bytes + dataSize);
+
+    std::string wavContent(wavData.begin(), wavData.end());
+    httplib::MultipartFormDataItems items = {{"file", wavContent, "recording.wav", "audio/wav", {}}};
+
+    const std::string boundary = httplib::detail::make_multipart_data_boundary();
+    const std::string body = httplib::detail::serialize_multipart_formdata(items, boundary);
+
+    // httplib copies a std::string body once more into the request.
+    auto res = cli.Post("/process-audio", body, httplib::detail::serialize_multipart_formdata_get_content_type(boundary));
+    if (!res || res->status != 200)
+    {
+      std::cerr << "legacy request failed" << std::endl;
+    }
+    return wavData.size() + wavContent.size() + items[0].content.size() + body.size() * 2;
+  }
+
+  template <typename Fn>
+  double timeMs(Fn &&fn)
+  {
+    auto start = std::chrono::steady_clock::now();
+    fn();
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+  }
+}
+
+int main()
+{
+  httplib::Server server;
+  server.set_tcp_nodelay(true); // as the client does; otherwise Nagle stalls each reply on delayed ACK
+  server.Post("/process-audio", [](const httplib::Request &, httplib::Response &res)
+              { res.set_content("ok", "text/plain"); });
+  std::thread serverThread([&]()
+                           { server.listen("127.0.0.1", PORT); });
+  server.wait_until_ready();
+
+  httplib::Client legacyClient("127.0.0.1", PORT);
+  HttpClient client("127.0.0.1", PORT, "bench");
+
+  std::cout << std::left << std::setw(10) << "seconds"
+            << std::setw(22) << "legacy ms/req"
+            << std::setw(22) << "legacy bytes copied"
+            << std::setw(22) << "multipart ms/req"
+            << std::setw(18) << "raw ms/req"
+            << "zero-copy bytes copied" << std::endl;
+
+  // Redirect HttpClient's per-request chatter away from the table.
+  std::streambuf *coutBuf = std::cout.rdbuf();
+
+  for (int seconds : {1, 5, 15, 60})
+  {
+    std::vector<int16_t> pcm(static_cast<size_t>(seconds) * 16000);
+    for (size_t i = 0; i < pcm.size(); ++i)
+    {
+      pcm[i] = static_cast<int16_t>((i * 7919) & 0x7FFF);
+    }
+
+    std::ostringstream sink;
+    std::cout.rdbuf(sink.rdbuf());
+
+    size_t legacyCopied = 0;
+    double legacyMs = timeMs([&]()
+                             {
+      for (int i = 0; i < ITERATIONS; ++i)
+      {
+        legacyCopied = legacyPost(legacyClient, pcm);
+      } });
+
+    client.setUploadFormat(UploadFormat::Multipart);
+    double multipartMs = timeMs([&]()
+                                {
+      for (int i = 0; i < ITERATIONS; ++i)
+      {
+        client.postOrch("/process-audio", pcm, 16000, 1);
+      } });
+
+    client.setUploadFormat(UploadFormat::RawPcm);
+    double rawMs = timeMs([&]()
+                          {
+      for (int i = 0; i < ITERATIONS; ++i)
+      {
+        client.postOrch("/process-audio", pcm, 16000, 1);
+      } });
+
+    std::cout.rdbuf(coutBuf);
+    std::cout << std::left << std::setw(10) << seconds
+              << std::setw(22) << legacyMs / ITERATIONS
+              << std::setw(22) << legacyCopied
+              << std::setw(22) << multipartMs / ITERATIONS
+              << std::setw(18) << rawMs / ITERATIONS
+              << 0 << std::endl;
+  }
+
+  server.stop();
+  serverThread.join();
+  return 0;
+}
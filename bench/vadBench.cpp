@@ -0,0 +1,221 @@
+// VAD comparison: runs the energy and spectral engines over synthetic
+// sessions (harmonic "speech" shaped by formants with syllable envelopes and
+// fricatives, mixed into quiet-room and fan/HVAC noise) and reports per-frame
+// accuracy, false alarms, misses, the longest false-speech run, and cost.
+// The "no pause" sessions start speaking on the first frame, as a command run
+// straight on from the wake word does; the spectral engine runs them cold and
+// after hearing the room while idle, the way the recorder uses it.
+//
+// Build and run through ./bench.sh.
+#include "vad.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <vector>
+
+namespace
+{
+  constexpr int SAMPLE_RATE = 16000;
+  constexpr int FRAME = 320;
+  constexpr int IDLE_FRAME = 512; // Porcupine's frame length
+  constexpr int IDLE_SECONDS = 2;
+  constexpr float PI = 3.14159265f;
+
+  // Matches MicrophoneRecorder's fixed thresholds.
+  constexpr float START_SQ = 500.0f * 500.0f;
+  constexpr float STOP_SQ = 300.0f * 300.0f;
+
+  struct Session
+  {
+    const char *name;
+    std::vector<int16_t> audio;
+    std::vector<bool> labels; // one per frame
+    std::vector<int16_t> idle; // background only, heard before audio
+  };
+
+  // Spectral envelope with three formant peaks, normalised to about 1.
+  float formantGain(float freq, float f1, float f2)
+  {
+    auto peak = [](float f, float centre, float width)
+    {
+      const float d = (f - centre) / width;
+      return 1.0f / (1.0f + d * d);
+    };
+    return peak(freq, f1, 90) + 0.6f * peak(freq, f2, 130) + 0.3f * peak(freq, 2600, 200);
+  }
+
+  Session makeSession(const char *name, float noiseRms, bool fan, unsigned seed, float leadSeconds = 2.0f)
+  {
+    std::mt19937 rng(seed);
+    std::normal_distribution<float> gauss(0.0f, 1.0f);
+    std::uniform_real_distribution<float> uni(0.0f, 1.0f);
+
+    Session s{name, {}, {}, {}};
+    const int totalSeconds = 40;
+    const size_t idleSamples = IDLE_SECONDS * SAMPLE_RATE;
+    std::vector<float> speech(idleSamples + totalSeconds * SAMPLE_RATE, 0.0f);
+    std::vector<bool> speechSample(speech.size(), false);
+
+    // Alternate 2-4 s of silence with 1-3 s utterances.
+    size_t pos = idleSamples + static_cast<size_t>(leadSeconds * SAMPLE_RATE);
+    while (pos < speech.size() - SAMPLE_RATE * 4)
+    {
+      const size_t len = static_cast<size_t>((1.0f + 2.0f * uni(rng)) * SAMPLE_RATE);
+      const float f1 = 500 + 300 * uni(rng);
+      const float f2 = 1200 + 800 * uni(rng);
+      float pitch = 110 + 100 * uni(rng);
+      float phase = 0;
+      float lastNoise = 0;
+      const float syllableRate = 3.0f + 2.0f * uni(rng);
+      for (size_t i = 0; i < len; ++i)
+      {
+        const float t = static_cast<float>(i) / SAMPLE_RATE;
+        const float env = 0.55f + 0.45f * std::sin(2 * PI * syllableRate * t);
+        const bool fricative = std::fmod(t * syllableRate, 2.0f) > 1.7f;
+        float y = 0;
+        if (fricative)
+        {
+          // High-passed noise, like /s/ or /f/.
+          const float n = gauss(rng);
+          y = 0.5f * (n - lastNoise);
+          lastNoise = n;
+        }
+        else
+        {
+          phase += pitch / SAMPLE_RATE;
+          phase -= std::floor(phase);
+          for (int h = 1; h * pitch < 4000; ++h)
+          {
+            y += formantGain(h * pitch, f1, f2) * std::sin(2 * PI * h * phase);
+          }
+          y *= 0.5f;
+        }
+        speech[pos + i] = 3000.0f * env * y;
+        speechSample[pos + i] = true;
+        pitch = std::clamp(pitch + 0.002f * gauss(rng), 90.0f, 240.0f);
+      }
+      pos += len + static_cast<size_t>((2.0f + 2.0f * uni(rng)) * SAMPLE_RATE);
+    }
+
+    // Noise: white for a quiet room, or low-passed noise plus motor hum for a fan.
+    float brown = 0;
+    s.audio.resize(speech.size());
+    for (size_t i = 0; i < speech.size(); ++i)
+    {
+      float n;
+      if (fan)
+      {
+        brown = 0.98f * brown + 0.2f * gauss(rng);
+        const float t = static_cast<float>(i) / SAMPLE_RATE;
+        n = brown + 0.5f * std::sin(2 * PI * 120 * t) + 0.3f * gauss(rng);
+      }
+      else
+      {
+        n = gauss(rng);
+      }
+      const float v = speech[i] + noiseRms * n;
+      s.audio[i] = static_cast<int16_t>(std::clamp(v, -32768.0f, 32767.0f));
+    }
+
+    s.idle.assign(s.audio.begin(), s.audio.begin() + idleSamples);
+    s.audio.erase(s.audio.begin(), s.audio.begin() + idleSamples);
+    speechSample.erase(speechSample.begin(), speechSample.begin() + idleSamples);
+
+    for (size_t f = 0; f + FRAME <= s.audio.size(); f += FRAME)
+    {
+      size_t voiced = 0;
+      for (size_t i = f; i < f + FRAME; ++i)
+      {
+        voiced += speechSample[i];
+      }
+      s.labels.push_back(voiced > FRAME / 2);
+    }
+    return s;
+  }
+
+  void evaluate(VoiceActivityDetector &vad, const Session &s, bool primed = false)
+  {
+    if (primed)
+    {
+      for (size_t i = 0; i + IDLE_FRAME <= s.idle.size(); i += IDLE_FRAME)
+      {
+        vad.observeIdle(s.idle.data() + i, IDLE_FRAME);
+      }
+    }
+
+    size_t correct = 0, falseAlarms = 0, misses = 0, noiseFrames = 0, speechFrames = 0;
+    size_t run = 0, longestFalseRun = 0;
+    bool inSpeech = false;
+
+    auto start = std::chrono::steady_clock::now();
+    for (size_t f = 0; f < s.labels.size(); ++f)
+    {
+      const bool decision = vad.process(s.audio.data() + f * FRAME, FRAME, inSpeech);
+      inSpeech = decision;
+      const bool truth = s.labels[f];
+      correct += decision == truth;
+      if (truth)
+      {
+        ++speechFrames;
+        misses += !decision;
+        run = 0;
+      }
+      else
+      {
+        ++noiseFrames;
+        falseAlarms += decision;
+        run = decision ? run + 1 : 0;
+        longestFalseRun = std::max(longestFalseRun, run);
+      }
+    }
+    const double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+
+    std::cout << std::left << std::setw(22) << s.name
+              << std::setw(10) << (primed ? "primed" : vad.name())
+              << std::setw(11) << std::fixed << std::setprecision(1) << 100.0 * correct / s.labels.size()
+              << std::setw(11) << 100.0 * falseAlarms / std::max<size_t>(noiseFrames, 1)
+              << std::setw(10) << 100.0 * misses / std::max<size_t>(speechFrames, 1)
+              << std::setw(16) << longestFalseRun * FRAME * 1000 / SAMPLE_RATE
+              << std::setprecision(0) << ns / s.labels.size() << std::endl;
+  }
+}
+
+int main()
+{
+  std::vector<Session> sessions;
+  sessions.push_back(makeSession("quiet room", 60.0f, false, 1));
+  sessions.push_back(makeSession("moderate fan", 500.0f, true, 2));
+  sessions.push_back(makeSession("loud fan (HVAC)", 1200.0f, true, 3));
+
+  std::cout << std::left << std::setw(22) << "session"
+            << std::setw(10) << "engine"
+            << std::setw(11) << "acc %"
+            << std::setw(11) << "false %"
+            << std::setw(10) << "miss %"
+            << std::setw(16) << "max false ms"
+            << "ns/frame" << std::endl;
+
+  for (const auto &session : sessions)
+  {
+    EnergyVad energyVad(START_SQ, STOP_SQ);
+    SpectralVad spectralVad(SAMPLE_RATE);
+    evaluate(energyVad, session);
+    evaluate(spectralVad, session);
+  }
+
+  std::vector<Session> noPause;
+  noPause.push_back(makeSession("quiet, no pause", 60.0f, false, 4, 0.0f));
+  noPause.push_back(makeSession("fan, no pause", 500.0f, true, 5, 0.0f));
+  for (const auto &session : noPause)
+  {
+    SpectralVad cold(SAMPLE_RATE);
+    SpectralVad primed(SAMPLE_RATE);
+    evaluate(cold, session);
+    evaluate(primed, session, true);
+  }
+  return 0;
+}
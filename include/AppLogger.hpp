@@ -1,23 +1,94 @@
 #pragma once
 
+#include "logArchiver.hpp"
+#include "logFormat.hpp"
 #include <string>
 #include <fstream>
 #include <chrono>
 #include <ctime>
 #include <filesystem>
+#include <mutex>
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <thread>
+#include <tuple>
+#include <vector>
 
 // AppLogger clas for centralized logging
+//
+// info() and error() only copy the message into a preallocated slot of a
+// bounded lock-free queue; a writer thread formats and writes the lines in
+// batches. Safe to call from any thread. When the queue is full the record
+// is dropped and counted rather than blocking the caller.
+//
+// LOG_INFO / LOG_ERROR go further and defer formatting altogether: the call
+// site registers its format string once and each call only copies the raw
+// arguments. The writer renders them for a text log, or writes them as is
+// to a binary log that sarah-logdecode turns back into text.
+//
+// Levels are filtered twice: LOG_* calls below SARAH_LOG_MIN_LEVEL (a build
+// flag, 0 = trace ... 4 = error) are compiled out, and the rest are checked
+// against the runtime level from setLevel() before anything is queued.
+//
+// With setRotation() the writer rotates the active file by size or age: it
+// renames it in place and hands it to a LogArchiver, which compresses and
+// moves it to the archive directory on a low-priority thread. Keeping the
+// active file on tmpfs and the archive on flash means neither the writer nor
+// the audio thread ever waits on the SD card.
 class AppLogger
 {
 public:
+  using Level = logformat::Level;
+
+  enum class Format
+  {
+    Text,
+    Binary
+  };
+
   static AppLogger &getInstance();
 
-  bool open(const std::string &filename);
+  bool open(const std::string &filename, Format format = Format::Text);
+
+  void setRotation(const LogRotation &rotation);
 
   void info(const std::string &message);
 
   void error(const std::string &message);
 
+  static void setLevel(Level level) { level_.store(level, std::memory_order_relaxed); }
+
+  static bool enabled(Level level) { return level >= level_.load(std::memory_order_relaxed); }
+
+  // Used by the LOG_* macros; returns 0 once the site table is full.
+  static uint32_t registerSite(Level level, const char *format, const char *file, int line);
+
+  template <typename... Args>
+  void log(Level level, uint32_t site, const Args &...args)
+  {
+    if (site == 0)
+    {
+      dropped_.fetch_add(1, std::memory_order_relaxed);
+      return;
+    }
+    size_t pos;
+    Slot *slot = claim(pos);
+    if (!slot)
+    {
+      return;
+    }
+    logformat::ArgWriter writer(slot->payload, TEXT_BYTES);
+    logformat::encodeArgs(writer, args...);
+    slot->site = site;
+    slot->level = level;
+    slot->length = static_cast<uint16_t>(writer.size());
+    publish(slot, pos);
+  }
+
+  // Records lost because the queue was full.
+  uint64_t droppedRecords() const { return dropped_.load(std::memory_order_relaxed); }
+
   ~AppLogger();
 
 private:
@@ -26,9 +97,98 @@ private:
   AppLogger(const AppLogger &) = delete;
   AppLogger &operator=(const AppLogger &) = delete;
 
+  static constexpr size_t QUEUE_SLOTS = 512; // power of two
+  static constexpr size_t SLOT_BYTES = 512;
+  static constexpr size_t TEXT_BYTES = SLOT_BYTES - 24;
+  static constexpr size_t MAX_SITES = 1024;
+
+  struct Slot
+  {
+    std::atomic<size_t> sequence;
+    int64_t timeNs; // system clock
+    uint32_t site;  // 0: payload is preformatted text
+    Level level;
+    uint16_t length;
+    char payload[TEXT_BYTES];
+  };
+
+  struct Site
+  {
+    Level level;
+    const char *format;
+    const char *file;
+    int line;
+  };
+
+  static Site sites_[MAX_SITES];
+  static std::atomic<uint32_t> siteCount_;
+  static std::atomic<Level> level_;
+
+  std::unique_ptr<Slot[]> slots_;
+  alignas(64) std::atomic<size_t> enqueuePos_{0};
+  alignas(64) size_t dequeuePos_ = 0; // writer thread only
+  std::atomic<uint64_t> dropped_{0};
+
   std::ofstream logFile;
+  std::filesystem::path logPath_;
+  Format format_ = Format::Text;
+  LogRotation rotation_;
+  LogArchiver archiver_;
+  uint64_t fileBytes_ = 0;
+  std::chrono::steady_clock::time_point fileOpened_;
+  bool recordsSinceHeader_ = false; // a file holding only its header is not rotated
+  unsigned rotationSeq_ = 0;
+  std::vector<bool> sitesWritten_; // binary format: declared in this file yet
+  std::mutex fileMutex_;           // open() against the writer
+
+  std::thread writer_;
+  std::mutex wakeMutex_;
+  std::condition_variable wake_;
+  std::atomic<bool> running_{true};
+
+  // Writer-side timestamp cache, reformatted once per second.
+  std::time_t cachedSecond_ = 0;
+  char timestampBuffer_[32] = {};
+
+  Slot *claim(size_t &pos);
+  void publish(Slot *slot, size_t pos);
+  void enqueue(Level level, const std::string &message);
+  void writerLoop();
+  size_t drain(std::string &out, std::string &errors);
+  void renderText(std::string &out, const Slot &slot);
+  void writeFileHeader();
+  void writeFileFooter();
+  bool rotationDue() const;
+  void rotate(bool reopen);
+
+  const char *cachedTimestamp(std::time_t when);
+};
+
+#ifndef SARAH_LOG_MIN_LEVEL
+#define SARAH_LOG_MIN_LEVEL 1 // debug
+#endif
 
-  std::string getTimestamp();
+// Deferred-formatting log call: "{}" placeholders, numeric or string
+// arguments. The placeholder count is checked at compile time, even for
+// levels that are compiled out.
+#define SARAH_LOG(level, format, ...)                                                                    \
+  do                                                                                                     \
+  {                                                                                                      \
+    static_assert(logformat::placeholderCount(format) ==                                                 \
+                      std::tuple_size<decltype(std::make_tuple(__VA_ARGS__))>::value,                    \
+                  "log format placeholders do not match the arguments");                                 \
+    if constexpr (static_cast<int>(level) >= SARAH_LOG_MIN_LEVEL)                                        \
+    {                                                                                                    \
+      if (AppLogger::enabled(level))                                                                     \
+      {                                                                                                  \
+        static const uint32_t sarahLogSite = AppLogger::registerSite(level, format, __FILE__, __LINE__); \
+        AppLogger::getInstance().log(level, sarahLogSite, ##__VA_ARGS__);                               \
+      }                                                                                                  \
+    }                                                                                                    \
+  } while (0)
 
-  void logToStream(const std::string &message);
-};
\ No newline at end of file
+#define LOG_TRACE(format, ...) SARAH_LOG(AppLogger::Level::Trace, format, ##__VA_ARGS__)
+#define LOG_DEBUG(format, ...) SARAH_LOG(AppLogger::Level::Debug, format, ##__VA_ARGS__)
+#define LOG_INFO(format, ...) SARAH_LOG(AppLogger::Level::Info, format, ##__VA_ARGS__)
+#define LOG_WARN(format, ...) SARAH_LOG(AppLogger::Level::Warn, format, ##__VA_ARGS__)
+#define LOG_ERROR(format, ...) SARAH_LOG(AppLogger::Level::Error, format, ##__VA_ARGS__)
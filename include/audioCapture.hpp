@@ -0,0 +1,58 @@
+#pragma once
+
+#include "audioSource.hpp"
+#include "ringBuffer.hpp"
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <portaudio.h>
+
+// Owns the one and only input stream. A PortAudio callback pushes samples into
+// a lock-free ring, and the wake word detector and the recorder take turns
+// reading from it, so the device is opened once and never reopened per command.
+class AudioCapture : public AudioSource
+{
+public:
+  AudioCapture(int sampleRate = 16000, int channels = 1, int ringSeconds = 4);
+
+  ~AudioCapture() override;
+
+  bool start() override;
+
+  void stop() override;
+
+  bool isRunning() const override;
+
+  bool read(int16_t *dest, size_t numSamples,
+            std::chrono::milliseconds timeout = std::chrono::milliseconds(1000)) override;
+
+  size_t drain() override;
+
+  size_t available() const;
+
+  // Samples lost because the ring was full.
+  uint64_t droppedSamples() const;
+
+  // Callbacks for which the device reported an input overflow. PortAudio does
+  // not say how much audio the device lost, so these are counted apart.
+  uint64_t inputOverflows() const;
+
+  int getSampleRate() const override;
+  int getChannels() const override;
+
+private:
+  bool paInitialized = false;
+  PaStream *stream = nullptr;
+  int sampleRate;
+  int channels;
+
+  SpscRingBuffer<int16_t> ring_;
+  std::atomic<uint64_t> droppedSamples_{0};
+  std::atomic<uint64_t> inputOverflows_{0};
+
+  static int paCallback(const void *input, void *output,
+                        unsigned long frameCount,
+                        const PaStreamCallbackTimeInfo *timeInfo,
+                        PaStreamCallbackFlags statusFlags,
+                        void *userData);
+};
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+// Hands recorded PCM from the recording thread to an upload thread.
+// The recorder pushes frames as they are captured and calls finish() at the
+// endpoint; the uploader blocks in pop() until audio arrives or the stream ends.
+//
+// Chunks live in a ring of preallocated slots. pop() swaps the caller's
+// previous chunk into the slot it empties, so once the ring has grown to the
+// uploader's lag, pushing a frame allocates nothing.
+class AudioChunkQueue
+{
+public:
+  explicit AudioChunkQueue(size_t slots = 16, size_t chunkSamples = 320);
+
+  void push(const int16_t *samples, size_t count);
+
+  // No more audio will follow. Wakes the consumer so the last chunk goes out now.
+  void finish();
+
+  // Consumer gave up (e.g. the request failed); further pushes are dropped.
+  void cancel();
+
+  // Blocks until a chunk is available. Returns false once the stream is
+  // finished and drained, or cancelled. Reuse chunk across calls: its buffer
+  // goes back to the ring.
+  bool pop(std::vector<int16_t> &chunk);
+
+  size_t totalSamples() const;
+
+private:
+  mutable std::mutex mutex_;
+  std::condition_variable cv_;
+  std::vector<std::vector<int16_t>> slots_;
+  size_t head_ = 0;  // oldest queued chunk
+  size_t queued_ = 0;
+  size_t totalSamples_ = 0;
+  bool finished_ = false;
+  bool cancelled_ = false;
+};
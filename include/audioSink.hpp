@@ -0,0 +1,150 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+
+// Where response audio and prompts go: the speaker (PortAudioSink) or nowhere
+// (NullSink, for headless runs). One open()/drain() cycle per response.
+class AudioSink
+{
+public:
+  virtual ~AudioSink() = default;
+
+  virtual bool open(int sampleRate, int channels) = 0;
+
+  // Queues interleaved samples. May block while the sink is full.
+  virtual bool write(const int16_t *samples, size_t count) = 0;
+
+  // Plays out everything queued, then closes.
+  virtual bool drain() = 0;
+
+  // Stops at once, dropping whatever is queued. Safe to call when not open.
+  virtual void abort() = 0;
+};
+
+// Accepts and discards audio instantly, counting what it was given.
+class NullSink : public AudioSink
+{
+public:
+  bool open(int sampleRate, int channels) override
+  {
+    sampleRate_ = sampleRate;
+    channels_ = channels;
+    samples_ = 0;
+    return true;
+  }
+
+  bool write(const int16_t * /*samples*/, size_t count) override
+  {
+    samples_ += count;
+    return true;
+  }
+
+  bool drain() override { return true; }
+  void abort() override {}
+
+  size_t samplesWritten() const { return samples_; }
+
+  // Playback time the discarded audio would have taken.
+  double durationMs() const
+  {
+    return sampleRate_ > 0 && channels_ > 0 ? 1000.0 * samples_ / channels_ / sampleRate_ : 0.0;
+  }
+
+private:
+  int sampleRate_ = 0;
+  int channels_ = 0;
+  size_t samples_ = 0;
+};
+
+// One output device shared by several players (responses and spoken prompts),
+// each through its own Handle. A handle's open() waits until whoever holds the
+// device has drained or aborted, so a prompt never opens a second stream over
+// a response; on ALSA hw: devices that open would fail.
+class SharedAudioSink
+{
+public:
+  explicit SharedAudioSink(AudioSink &sink) : sink_(sink) {}
+
+  class Handle : public AudioSink
+  {
+  public:
+    explicit Handle(SharedAudioSink &shared) : shared_(shared) {}
+
+    bool open(int sampleRate, int channels) override
+    {
+      if (!held_)
+      {
+        shared_.acquire();
+        held_ = true;
+      }
+      if (!shared_.sink_.open(sampleRate, channels))
+      {
+        release();
+        return false;
+      }
+      return true;
+    }
+
+    bool write(const int16_t *samples, size_t count) override
+    {
+      return held_ && shared_.sink_.write(samples, count);
+    }
+
+    bool drain() override
+    {
+      if (!held_)
+      {
+        return false;
+      }
+      const bool played = shared_.sink_.drain();
+      release();
+      return played;
+    }
+
+    // Only touches the device if this handle holds it.
+    void abort() override
+    {
+      if (held_)
+      {
+        shared_.sink_.abort();
+        release();
+      }
+    }
+
+  private:
+    SharedAudioSink &shared_;
+    bool held_ = false;
+
+    void release()
+    {
+      held_ = false;
+      shared_.release();
+    }
+  };
+
+private:
+  AudioSink &sink_;
+  std::mutex mutex_;
+  std::condition_variable released_;
+  bool busy_ = false;
+
+  void acquire()
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    released_.wait(lock, [this]
+                   { return !busy_; });
+    busy_ = true;
+  }
+
+  void release()
+  {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      busy_ = false;
+    }
+    released_.notify_one();
+  }
+};
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+// Where the wake word detector and the recorder get their audio from: the
+// microphone (AudioCapture) or a recorded session (WavFileSource).
+class AudioSource
+{
+public:
+  virtual ~AudioSource() = default;
+
+  virtual bool start() = 0;
+  virtual void stop() = 0;
+  virtual bool isRunning() const = 0;
+
+  // Blocks until numSamples are available or the timeout expires.
+  // Returns false on timeout, if the source is stopped, or at end of stream.
+  virtual bool read(int16_t *dest, size_t numSamples,
+                    std::chrono::milliseconds timeout = std::chrono::milliseconds(1000)) = 0;
+
+  // Drops audio that piled up while nobody was reading. Returns samples dropped.
+  virtual size_t drain() = 0;
+
+  // True once a finite source has been read to the end.
+  virtual bool endOfStream() const { return false; }
+
+  virtual int getSampleRate() const = 0;
+  virtual int getChannels() const = 0;
+};
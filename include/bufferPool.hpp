@@ -0,0 +1,63 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+// Recycles large audio buffers so their capacity survives across interactions.
+// Owners take a buffer with acquire(), move it along the pipeline, and hand it
+// back with release() once the last consumer is done with it.
+template <typename T>
+class BufferPool
+{
+public:
+  explicit BufferPool(size_t initialCapacity = 0, size_t maxPooled = 4)
+      : initialCapacity_(initialCapacity), maxPooled_(maxPooled) {}
+
+  std::vector<T> acquire()
+  {
+    acquired_.fetch_add(1, std::memory_order_relaxed);
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (!free_.empty())
+      {
+        std::vector<T> buffer = std::move(free_.back());
+        free_.pop_back();
+        buffer.clear();
+        return buffer;
+      }
+    }
+
+    allocated_.fetch_add(1, std::memory_order_relaxed);
+    std::vector<T> buffer;
+    buffer.reserve(initialCapacity_);
+    return buffer;
+  }
+
+  void release(std::vector<T> &&buffer)
+  {
+    if (buffer.capacity() == 0)
+    {
+      return;
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (free_.size() < maxPooled_)
+    {
+      free_.push_back(std::move(buffer));
+    }
+  }
+
+  // Buffers handed out, and how many of those needed a fresh allocation.
+  uint64_t acquiredCount() const { return acquired_.load(std::memory_order_relaxed); }
+  uint64_t allocatedCount() const { return allocated_.load(std::memory_order_relaxed); }
+
+private:
+  size_t initialCapacity_;
+  size_t maxPooled_;
+  std::mutex mutex_;
+  std::vector<std::vector<T>> free_;
+  std::atomic<uint64_t> acquired_{0};
+  std::atomic<uint64_t> allocated_{0};
+};
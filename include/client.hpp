@@ -1,10 +1,18 @@
 #pragma once
 
 #include "httplib.h"
+#include "bufferPool.hpp"
+#include "flac.hpp"
+#include "linkEstimator.hpp"
+#include <chrono>
 #include <cstdint>
+#include <mutex>
+#include <thread>
 #include <vector>
 #include <string>
 
+class AudioChunkQueue;
+
 struct WavHeader
 {
   char riff[4] = {'R', 'I', 'F', 'F'};
@@ -22,23 +30,110 @@ struct WavHeader
   uint32_t dataSize;
 } __attribute__((packed));
 
+// How postOrch frames the recorded PCM on the wire.
+enum class UploadFormat
+{
+  Multipart, // multipart/form-data with a single "file" part holding a WAV
+  Wav,       // bare audio/wav body
+  RawPcm,    // application/octet-stream; format travels in X-Sample-Rate/X-Channels
+  Flac,      // audio/flac, lossless; about half the bytes of WAV for speech
+  ImaAdpcm,  // WAV holding IMA ADPCM, lossy; a quarter of the bytes
+  Auto       // per request, whichever of Wav, Flac and ImaAdpcm should arrive first
+};
+
+// Keeps one connection to the orchestrator open across requests, with
+// TCP_NODELAY and TCP keep-alive probes. A dead connection is replaced
+// transparently on the next request.
 class HttpClient
 {
 public:
   HttpClient(const std::string &host, int port, const std::string &authToken);
+  ~HttpClient();
+
+  // A connection idle for this long is closed before the next request rather
+  // than trusted: NAT and VPN paths such as Tailscale can drop idle flows
+  // without the client seeing a reset. Zero keeps idle connections forever.
+  void setIdleTimeout(std::chrono::seconds timeout);
+
+  // Opens or validates the connection with a GET of path on a background
+  // thread, so the TCP setup overlaps with recording. A request made before
+  // it finishes waits for it.
+  void prewarm(const std::string &path);
+
+  void setUploadFormat(UploadFormat format);
+
+  // With UploadFormat::Auto, the lossy encoding is only picked when it is
+  // expected to arrive at least this much sooner than the best lossless one.
+  // Negative never picks it.
+  void setLossyMinSaving(std::chrono::milliseconds saving);
 
+  // Parses "multipart", "wav", "raw", "flac", "adpcm" or "auto"; unknown
+  // values fall back to multipart.
+  static UploadFormat parseUploadFormat(const std::string &name);
+
+  // Uploads a finished recording in one request. For the PCM formats the WAV
+  // header, multipart framing and PCM are written to the socket straight from
+  // audioData through a content provider; nothing is copied.
   bool postOrch(const std::string &path,
                 const std::vector<int16_t> &audioData,
                 int sampleRate,
                 int channels);
 
-  std::vector<uint8_t> getLastResponseAudio() const;
+  // Opens the request immediately and sends PCM with chunked transfer encoding
+  // as it is popped from the queue. The body ends when the queue is finished.
+  // With UploadFormat::Flac, a FLAC frame is sent per completed block instead;
+  // Auto picks WAV or FLAC. ImaAdpcm is not streamed and sends WAV.
+  bool postOrchStreaming(const std::string &path,
+                         AudioChunkQueue &audioQueue,
+                         int sampleRate,
+                         int channels);
+
+  // Moves the last response out of the client. Give it back with
+  // recycleResponseBuffer() once played so its capacity is reused.
+  std::vector<uint8_t> takeLastResponseAudio();
+
+  void recycleResponseBuffer(std::vector<uint8_t> &&buffer);
+
+  const BufferPool<uint8_t> &responsePool() const;
+
+  // When set, successful response bodies are handed to the receiver as they
+  // arrive instead of being buffered for takeLastResponseAudio().
+  void setResponseReceiver(httplib::ContentReceiver receiver);
 
 private:
   httplib::Client cli_;
+  BufferPool<uint8_t> responsePool_;
   std::vector<uint8_t> lastResponseAudio_;
+  httplib::ContentReceiver responseReceiver_;
+  size_t lastStreamedBytes_ = 0;
+  UploadFormat uploadFormat_ = UploadFormat::Multipart;
+  std::vector<uint8_t> encodedUpload_; // compressed body, capacity kept between requests
+
+  // What each body encoding has cost so far, for UploadFormat::Auto.
+  struct EncodingCost
+  {
+    double encodeSecondsPerAudioSecond;
+    double sizeRatio; // body bytes per PCM byte
+  };
+  EncodingCost flacCost_{0.002, 0.55};
+  EncodingCost imaAdpcmCost_{0.0005, 0.26};
+  double lossyMinSavingSeconds_ = 0.15;
+  LinkEstimator link_;
+
+  // Serializes requests with the prewarm and guards the fields below.
+  std::mutex connectionMutex_;
+  std::chrono::steady_clock::time_point lastUsed_;
+  std::chrono::seconds idleTimeout_{30};
+  bool socketOpened_ = false; // set by the socket hook while a request connects
+  std::thread prewarmThread_;
+
+  UploadFormat chooseUploadFormat(size_t pcmBytes, double audioSeconds);
+  UploadFormat chooseStreamingFormat(int sampleRate, int channels) const;
+  void recordEncoding(EncodingCost &cost, double seconds, double audioSeconds, size_t bytes, size_t pcmBytes);
+  void reapIdleConnection();
+  bool countConnection(const httplib::Result &res);
+  httplib::Result send(httplib::Request &req);
+  bool handleResponse(const httplib::Result &res);
 
-  std::vector<uint8_t> createWavFromPCM(const std::vector<int16_t> &pcmData,
-                                        int sampleRate,
-                                        int channels);
+  static WavHeader makeWavHeader(size_t numSamples, int sampleRate, int channels);
 };
@@ -0,0 +1,66 @@
+#pragma once
+
+// Decides when a command is over from the per-frame VAD decisions.
+//
+// Hangover (the silence needed to end an utterance) adapts within
+// [minHangoverMs, maxHangoverMs]: a pause the speaker resumed from raises it
+// to cover that pause, and past longUtteranceMs of speech it shrinks, since
+// long commands rarely end with a trailing afterthought.
+
+enum class EndpointReason
+{
+  None,
+  Silence,
+  NoSpeechTimeout,
+  MaxLength,
+};
+
+struct EndpointerConfig
+{
+  int noSpeechTimeoutMs = 5000; // give up if nothing is said after the wake word
+  int hangoverMs = 600;         // starting hangover
+  int minHangoverMs = 300;
+  int maxHangoverMs = 1200;
+  int longUtteranceMs = 4000;
+  int maxUtteranceMs = 60000; // measured from speech onset
+};
+
+struct EndpointStats
+{
+  EndpointReason reason = EndpointReason::None;
+  int speechMs = 0;    // onset to last voiced frame
+  int latencyMs = 0;   // last voiced frame to the endpoint decision
+  int hangoverMs = 0;  // hangover in force when the endpoint was declared
+};
+
+class Endpointer
+{
+public:
+  explicit Endpointer(const EndpointerConfig &config = {});
+
+  void setConfig(const EndpointerConfig &config);
+  const EndpointerConfig &config() const;
+
+  void reset();
+
+  // Feeds one frame's VAD decision; returns the reason once the endpoint is
+  // reached, None until then.
+  EndpointReason process(bool voiced, int frameMs);
+
+  bool speechStarted() const;
+  int currentHangoverMs() const;
+  const EndpointStats &stats() const;
+
+  static const char *reasonName(EndpointReason reason);
+
+private:
+  static constexpr int PAUSE_MARGIN_MS = 200;
+
+  EndpointerConfig config_;
+  EndpointStats stats_;
+  bool speechStarted_ = false;
+  int waitedMs_ = 0;    // before onset
+  int elapsedMs_ = 0;   // since onset
+  int silenceMs_ = 0;   // current run of unvoiced frames
+  int hangoverMs_ = 0;  // base hangover after pause adaptation
+};
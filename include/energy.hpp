@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Sum-of-squares kernels for int16 audio, used by the VAD and gating paths.
+// Every kernel accumulates exactly in 64 bits, so all of them return the same
+// value as the scalar reference for any input, including runs of -32768.
+namespace energy
+{
+  using SumSquaresFn = uint64_t (*)(const int16_t *data, size_t numSamples);
+
+  struct Kernel
+  {
+    const char *name;
+    SumSquaresFn fn;
+  };
+
+  uint64_t sumSquaresScalar(const int16_t *data, size_t numSamples);
+
+  // Kernels compiled into this binary that the running CPU supports,
+  // scalar first. Used by the dispatcher and the benchmark.
+  std::vector<Kernel> availableKernels();
+
+  // Fastest supported kernel, picked once on first use.
+  const Kernel &activeKernel();
+
+  inline uint64_t sumSquares(const int16_t *data, size_t numSamples)
+  {
+    return activeKernel().fn(data, numSamples);
+  }
+
+  // Mean of the squared samples, i.e. RMS squared.
+  inline float meanSquare(const int16_t *data, size_t numSamples)
+  {
+    if (numSamples == 0)
+    {
+      return 0.0f;
+    }
+    return static_cast<float>(static_cast<double>(sumSquares(data, numSamples)) / numSamples);
+  }
+}
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Lossless audio compression in the FLAC bitstream format, so the
+// orchestrator can decode uploads with any FLAC library. The encoder picks,
+// per block and channel, the cheapest of a constant, fixed polynomial
+// (orders 0-4) or quantized LPC predictor and Rice-codes the residual with
+// the best partitioning. Channels are coded independently.
+namespace flac
+{
+  constexpr const char *CONTENT_TYPE = "audio/flac";
+  constexpr size_t BLOCK_SIZE = 4096; // samples per channel per frame
+  constexpr int MAX_LPC_ORDER = 12;
+
+  // Encodes int16 PCM as it arrives: begin() writes the stream header, push()
+  // appends a frame for every complete block and finish() flushes the rest.
+  // The header is written before the length is known, so the stream can go
+  // out while the command is still being recorded.
+  class Encoder
+  {
+  public:
+    Encoder(int sampleRate, int channels, int maxLpcOrder = 8);
+
+    // totalFrames is the length in samples per channel, 0 when unknown.
+    void begin(std::vector<uint8_t> &out, uint64_t totalFrames = 0);
+
+    // Interleaved samples; count is the total over all channels.
+    void push(const int16_t *samples, size_t count, std::vector<uint8_t> &out);
+
+    void finish(std::vector<uint8_t> &out);
+
+  private:
+    int sampleRate_;
+    int channels_;
+    int maxLpcOrder_;
+    uint64_t frameNumber_ = 0;
+    std::vector<int16_t> pending_; // interleaved, less than one block
+
+    // Scratch reused across frames.
+    std::vector<int32_t> channel_;
+    std::vector<int32_t> residual_;
+    std::vector<int32_t> bestResidual_;
+    std::vector<double> window_;
+
+    void encodeFrame(const int16_t *samples, size_t frames, std::vector<uint8_t> &out);
+  };
+
+  // Whole-buffer form of Encoder.
+  void encode(const int16_t *samples, size_t count, int sampleRate, int channels, std::vector<uint8_t> &out);
+
+  // Decodes a FLAC stream fed in arbitrary pieces, e.g. as it downloads.
+  // Accepts what common encoders produce: any block size, stereo
+  // decorrelation, wasted bits, 8-32 bit samples (converted to int16).
+  class Decoder
+  {
+  public:
+    // Appends the interleaved samples of every frame completed by data.
+    // Returns false once the stream is found to be corrupt.
+    bool feed(const uint8_t *data, size_t size, std::vector<int16_t> &out);
+
+    bool hasFormat() const { return state_ == State::Frames; }
+    int sampleRate() const { return sampleRate_; }
+    int channels() const { return channels_; }
+
+    // True when every byte fed so far belonged to a complete frame.
+    bool idle() const { return pending_.size() == consumed_; }
+
+  private:
+    enum class State
+    {
+      Marker,
+      Metadata,
+      Frames,
+      Failed
+    };
+
+    enum class Result
+    {
+      Done,
+      NeedMore,
+      Corrupt
+    };
+
+    State state_ = State::Marker;
+    std::vector<uint8_t> pending_;
+    size_t consumed_ = 0;
+    int sampleRate_ = 0;
+    int channels_ = 0;
+    int bitsPerSample_ = 0;
+    std::vector<std::vector<int32_t>> decoded_;
+
+    Result parseHeaders();
+    Result decodeFrame(std::vector<int16_t> &out);
+  };
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include "httplib.h"
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+
+enum class OrchestratorHealth
+{
+  Unknown, // no probe has finished yet
+  Up,
+  Down
+};
+
+struct HealthMonitorConfig
+{
+  int intervalMs = 10000;   // between probes while the orchestrator is up
+  int minBackoffMs = 500;   // first retry after a failure
+  int maxBackoffMs = 30000; // backoff doubles up to this
+  int timeoutMs = 3000;     // per probe
+  int failuresToDown = 2;   // consecutive failures before Up turns Down
+};
+
+// Probes the orchestrator's health endpoint on a background thread over one
+// kept-alive connection and publishes the result as an atomic state, so the
+// wake loop can check it without touching the network. While the
+// orchestrator is down, probes back off exponentially with jitter.
+class HealthMonitor
+{
+public:
+  // Runs on the monitor thread, once per change of state. It must not block:
+  // the next probe waits for it to return.
+  using TransitionCallback = std::function<void(OrchestratorHealth from, OrchestratorHealth to)>;
+
+  HealthMonitor(const std::string &host, int port, const std::string &path,
+                const std::string &authToken, const HealthMonitorConfig &config = {});
+  ~HealthMonitor();
+
+  HealthMonitor(const HealthMonitor &) = delete;
+  HealthMonitor &operator=(const HealthMonitor &) = delete;
+
+  void start(TransitionCallback onTransition);
+  void stop();
+
+  OrchestratorHealth state() const { return state_.load(std::memory_order_acquire); }
+
+  // Probes as soon as possible instead of waiting out the current backoff.
+  void probeNow();
+
+  static const char *stateName(OrchestratorHealth state);
+
+private:
+  httplib::Client cli_;
+  std::string path_;
+  HealthMonitorConfig config_;
+  TransitionCallback onTransition_;
+
+  std::atomic<OrchestratorHealth> state_{OrchestratorHealth::Unknown};
+  std::mt19937 rng_;
+
+  std::mutex mutex_;
+  std::condition_variable wake_;
+  bool stopping_ = false;
+  bool probeRequested_ = false;
+  std::thread thread_;
+
+  void run();
+  bool probe();
+  int backoffMs(int failures);
+};
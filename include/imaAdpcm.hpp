@@ -0,0 +1,25 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Microsoft IMA ADPCM (WAVE format 0x11): 4 bits per sample in independent
+// blocks, each opening with the exact first sample and step index of every
+// channel. A quarter of the PCM16 size, at some cost in quality.
+namespace ima
+{
+  constexpr const char *CONTENT_TYPE = "audio/vnd.wave;codec=11";
+  constexpr uint16_t FORMAT_TAG = 0x0011;
+  constexpr size_t BLOCK_ALIGN_PER_CHANNEL = 256; // 505 samples, ~32 ms at 16 kHz
+
+  // Samples per channel in a block of blockAlign bytes.
+  size_t samplesPerBlock(size_t blockAlign, int channels);
+
+  // Appends the decoded, interleaved samples of one block.
+  void decodeBlock(const uint8_t *block, size_t blockAlign, int channels, std::vector<int16_t> &out);
+
+  // Encodes interleaved PCM16 into a complete WAV file. The last block is
+  // padded with its final sample; the fact chunk records the true length.
+  void encodeWav(const int16_t *samples, size_t count, int sampleRate, int channels, std::vector<uint8_t> &out);
+}
@@ -0,0 +1,118 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <ostream>
+#include <thread>
+
+// Log-linear histogram in the style of HdrHistogram: values (microseconds)
+// below 64 get exact buckets, larger ones 32 sub-buckets per power of two,
+// i.e. about 3% relative precision up to ~19 hours. Recording is lock-free.
+class LatencyHistogram
+{
+public:
+  void record(uint64_t micros);
+  void reset();
+
+  uint64_t count() const { return count_.load(std::memory_order_relaxed); }
+  uint64_t max() const { return max_.load(std::memory_order_relaxed); }
+  uint64_t sum() const { return sum_.load(std::memory_order_relaxed); }
+  double mean() const;
+
+  // Samples in buckets that lie wholly at or below micros, for cumulative
+  // exports. Samples in the bucket straddling micros (up to ~3% below it)
+  // are left to the next larger bound, never counted above their own.
+  uint64_t countAtOrBelow(uint64_t micros) const;
+
+  // Value at or below which p percent of samples fall (bucket midpoint).
+  uint64_t percentile(double p) const;
+
+private:
+  static constexpr int SUB_BUCKET_BITS = 5;
+  static constexpr int SUB_BUCKETS = 1 << SUB_BUCKET_BITS;
+  static constexpr int MAX_EXPONENT = 36;
+  static constexpr int NUM_BUCKETS = 2 * SUB_BUCKETS + (MAX_EXPONENT - SUB_BUCKET_BITS - 1) * SUB_BUCKETS;
+
+  std::array<std::atomic<uint64_t>, NUM_BUCKETS> buckets_{};
+  std::atomic<uint64_t> count_{0};
+  std::atomic<uint64_t> sum_{0};
+  std::atomic<uint64_t> max_{0};
+
+  static int bucketFor(uint64_t micros);
+  static uint64_t bucketMidpoint(int index);
+};
+
+// Stages of one wake-to-reply interaction, in pipeline order.
+enum class Stage
+{
+  WakeDetected,
+  SpeechOnset,
+  Endpoint,
+  UploadStart,
+  UploadEnd,
+  FirstResponseByte,
+  LastResponseByte,
+  PlaybackStart,
+  PlaybackEnd,
+  Count
+};
+
+// Collects steady_clock timestamps for the current interaction and, when it
+// ends, folds them into two histograms per stage: time since the wake word,
+// and time since the previous stage that was reached. Dumps go to AppLogger,
+// periodically from a reporter thread and on demand via requestDump(), which
+// is async-signal-safe so it can be wired to SIGUSR1.
+class LatencyTracker
+{
+public:
+  static LatencyTracker &getInstance();
+
+  void beginInteraction();
+
+  // First mark in an interaction wins (retries do not move it).
+  void mark(Stage stage);
+
+  // Last mark wins, for stages that end something.
+  void markLatest(Stage stage);
+
+  void endInteraction();
+
+  uint64_t interactions() const { return interactions_.load(std::memory_order_relaxed); }
+  const LatencyHistogram &sinceWake(Stage stage) const { return sinceWake_[static_cast<size_t>(stage)]; }
+  const LatencyHistogram &sincePrevious(Stage stage) const { return sincePrevious_[static_cast<size_t>(stage)]; }
+
+  void dump(std::ostream &out) const;
+  void dumpToLog() const;
+
+  void startReporter(std::chrono::seconds interval);
+  void stopReporter();
+  void requestDump();
+
+  static const char *stageName(Stage stage);
+
+  ~LatencyTracker();
+
+private:
+  LatencyTracker() = default;
+
+  LatencyTracker(const LatencyTracker &) = delete;
+  LatencyTracker &operator=(const LatencyTracker &) = delete;
+
+  static constexpr size_t NUM_STAGES = static_cast<size_t>(Stage::Count);
+
+  // Nanoseconds on the steady clock; 0 means not reached.
+  std::array<std::atomic<int64_t>, NUM_STAGES> marks_{};
+  std::array<LatencyHistogram, NUM_STAGES> sinceWake_;
+  std::array<LatencyHistogram, NUM_STAGES> sincePrevious_;
+  std::atomic<uint64_t> interactions_{0};
+
+  std::thread reporter_;
+  std::mutex reporterMutex_;
+  std::condition_variable reporterCv_;
+  bool stopReporter_ = false;
+  std::atomic<bool> dumpRequested_{false};
+};
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <cstddef>
+
+// Round-trip time and upload throughput to one orchestrator, as EWMAs of the
+// kernel's own per-connection estimates (TCP_INFO) taken after each upload.
+// The kernel sees every ACK, so this works for bodies that fit in the socket
+// buffer, where timing the writes would only measure a memcpy.
+class LinkEstimator
+{
+public:
+  explicit LinkEstimator(double alpha = 0.3);
+
+  // Call while the connection an upload went out on is still open, i.e.
+  // once the response has started. Returns false if the kernel had no
+  // estimate to give.
+  bool sample(int sock);
+
+  bool hasEstimate() const { return bytesPerSecond_ > 0; }
+  double rttSeconds() const { return rttSeconds_; }
+  double bytesPerSecond() const { return bytesPerSecond_; }
+
+  // Expected time from the first byte leaving until the last one arrives.
+  double transferSeconds(size_t bytes) const;
+
+private:
+  double alpha_;
+  double rttSeconds_ = 0;
+  double bytesPerSecond_ = 0;
+};
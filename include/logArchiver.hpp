@@ -0,0 +1,54 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <thread>
+
+struct LogRotation
+{
+  uint64_t maxBytes = 0;  // rotate once the active file reaches this size (0 = never)
+  int maxAgeSeconds = 0;  // rotate once the active file is this old (0 = never)
+  int generations = 5;    // rotated files kept in the archive directory
+  bool compress = true;   // gzip rotated files
+  std::string directory;  // where rotated files go; empty = next to the active file
+};
+
+// Moves rotated log files off the active file's filesystem on a
+// low-priority thread: compresses them with gzip into the archive directory
+// and deletes the oldest generations beyond the limit. AppLogger only
+// renames the active file, so its writer never waits on the archive disk.
+class LogArchiver
+{
+public:
+  LogArchiver() = default;
+  ~LogArchiver();
+
+  LogArchiver(const LogArchiver &) = delete;
+  LogArchiver &operator=(const LogArchiver &) = delete;
+
+  // activeName is the active log's file name; archives are named after it.
+  void configure(const LogRotation &rotation, const std::string &activeName);
+
+  // Takes ownership of a file the logger has rotated out.
+  void submit(const std::filesystem::path &rotated);
+
+  // Archives everything submitted so far, then stops the thread.
+  void stop();
+
+private:
+  std::mutex mutex_;
+  std::condition_variable wake_;
+  std::deque<std::filesystem::path> pending_;
+  LogRotation rotation_;
+  std::string activeName_;
+  bool stopping_ = false;
+  std::thread thread_;
+
+  void run();
+  bool archive(const std::filesystem::path &rotated, const LogRotation &rotation);
+  void prune(const std::filesystem::path &directory, const LogRotation &rotation);
+};
@@ -0,0 +1,158 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <ctime>
+#include <ostream>
+#include <string>
+#include <type_traits>
+
+// Shared by AppLogger and sarah-logdecode: how log-site arguments are packed,
+// how a format string is rendered from them, and the binary log file layout.
+namespace logformat
+{
+  // Ordered by severity; the values are also the SARAH_LOG_MIN_LEVEL numbers.
+  enum class Level : uint8_t
+  {
+    Trace,
+    Debug,
+    Info,
+    Warn,
+    Error
+  };
+
+  const char *levelTag(Level level);
+
+  // "trace", "debug", "info", "warn" or "error"; false for anything else.
+  bool parseLevel(const std::string &name, Level &level);
+
+  // Argument encoding: a one-byte tag, then 8 bytes for numbers or a 16-bit
+  // length and the bytes for strings. Native byte order.
+  enum class ArgType : uint8_t
+  {
+    Int,
+    Uint,
+    Double,
+    String,
+    Truncated // payload ran out of room; no further arguments
+  };
+
+  // Number of "{}" placeholders, usable in a static_assert.
+  constexpr size_t placeholderCount(const char *format)
+  {
+    size_t count = 0;
+    for (; *format != '\0'; ++format)
+    {
+      if (format[0] == '{' && format[1] == '}')
+      {
+        ++count;
+        ++format;
+      }
+    }
+    return count;
+  }
+
+  // Appends encoded arguments to a fixed buffer, never past its end.
+  class ArgWriter
+  {
+  public:
+    ArgWriter(char *buffer, size_t capacity) : buffer_(buffer), capacity_(capacity) {}
+
+    size_t size() const { return size_; }
+
+    template <typename T>
+    void add(const T &value)
+    {
+      if constexpr (std::is_same_v<T, bool>)
+      {
+        addNumber(ArgType::Uint, static_cast<uint64_t>(value));
+      }
+      else if constexpr (std::is_enum_v<T>)
+      {
+        addNumber(ArgType::Int, static_cast<int64_t>(value));
+      }
+      else if constexpr (std::is_integral_v<T> && std::is_signed_v<T>)
+      {
+        addNumber(ArgType::Int, static_cast<int64_t>(value));
+      }
+      else if constexpr (std::is_integral_v<T>)
+      {
+        addNumber(ArgType::Uint, static_cast<uint64_t>(value));
+      }
+      else if constexpr (std::is_floating_point_v<T>)
+      {
+        addNumber(ArgType::Double, static_cast<double>(value));
+      }
+      else if constexpr (std::is_convertible_v<T, const char *>)
+      {
+        const char *s = value;
+        addString(s, s ? std::strlen(s) : 0);
+      }
+      else
+      {
+        static_assert(std::is_same_v<T, std::string>, "log arguments are numbers or strings");
+        addString(value.data(), value.size());
+      }
+    }
+
+  private:
+    char *buffer_;
+    size_t capacity_;
+    size_t size_ = 0;
+    bool full_ = false;
+
+    bool reserve(size_t bytes);
+
+    template <typename N>
+    void addNumber(ArgType type, N value)
+    {
+      if (reserve(1 + sizeof(N)))
+      {
+        buffer_[size_] = static_cast<char>(type);
+        std::memcpy(buffer_ + size_ + 1, &value, sizeof(N));
+        size_ += 1 + sizeof(N);
+      }
+    }
+
+    void addString(const char *s, size_t length);
+  };
+
+  inline void encodeArgs(ArgWriter &) {}
+
+  template <typename T, typename... Rest>
+  void encodeArgs(ArgWriter &writer, const T &first, const Rest &...rest)
+  {
+    writer.add(first);
+    encodeArgs(writer, rest...);
+  }
+
+  // Replaces each "{}" in format with the next encoded argument.
+  void render(std::string &out, const char *format, const char *payload, size_t length);
+
+  void formatTimestamp(std::time_t when, char *buffer, size_t size);
+
+  // Binary log file: a stream of records, each starting with a RecordType
+  // byte. Every session starts with a Header and re-declares its sites, since
+  // site ids are assigned in the order call sites first run.
+  enum class RecordType : uint8_t
+  {
+    Header = 'H', // magic "SLOG", u16 version, i64 ns
+    Site = 'S',   // u32 id, u8 level, u32 line, u16 len + file, u16 len + format
+    Entry = 'E',  // u32 site (0 = preformatted text), u8 level, i64 ns, u16 len + payload
+    End = 'X'     // i64 ns
+  };
+
+  constexpr char MAGIC[4] = {'S', 'L', 'O', 'G'};
+  constexpr uint16_t VERSION = 2; // 2: five levels
+
+  void appendHeader(std::string &out, int64_t ns);
+  void appendSite(std::string &out, uint32_t id, Level level, const char *file, uint32_t line, const char *format);
+  void appendEntry(std::string &out, uint32_t site, Level level, int64_t ns, const char *payload, size_t length);
+  void appendEnd(std::string &out, int64_t ns);
+
+  // Renders a binary log in the text log format. A malformed or truncated
+  // record skips ahead to the next session header, with a marker line in the
+  // output; returns false with every damaged byte range and its cause in error.
+  bool decode(const char *data, size_t size, std::ostream &out, std::string &error);
+}
@@ -0,0 +1,112 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <thread>
+
+namespace httplib
+{
+  class Server;
+}
+
+// Process-wide counters. increment() is a single relaxed fetch_add, so the
+// audio and network threads never wait on a scrape.
+class Metrics
+{
+public:
+  enum class Counter
+  {
+    WakeDetections,
+    VadAborts,       // wake word heard but no command recorded
+    PostRetries,
+    HttpErrors4xx,
+    HttpErrors5xx,
+    HttpErrorsOther, // any other non-200 status
+    HttpTransportErrors,
+    HttpRequests,
+    HttpConnectionsOpened,
+    HttpRequestsReused, // command uploads that needed no new connection
+    BytesSent,
+    BytesReceived,
+    AudioReadErrors,
+    AudioReinits,
+    SpeakErrors,
+    HealthProbeFailures,
+    UploadsMultipart,
+    UploadsWav,
+    UploadsRawPcm,
+    UploadsFlac,
+    UploadsImaAdpcm,
+    NotificationsCoalesced,
+    NotificationsRateLimited,
+    NotificationsDropped,
+    Count
+  };
+
+  // Last-value readings, mostly the inputs to upload format selection.
+  enum class Gauge
+  {
+    LinkRttSeconds,
+    LinkUploadBytesPerSecond,
+    FlacSizeRatio,
+    ExpectedUploadSecondsWav,
+    ExpectedUploadSecondsFlac,
+    ExpectedUploadSecondsImaAdpcm,
+    VadNoiseFloorDbfs,
+    VadStartThresholdDbfs,
+    VadStopThresholdDbfs,
+    Count
+  };
+
+  static Metrics &getInstance();
+
+  void increment(Counter counter, uint64_t amount = 1)
+  {
+    counters_[static_cast<size_t>(counter)].fetch_add(amount, std::memory_order_relaxed);
+  }
+
+  uint64_t get(Counter counter) const
+  {
+    return counters_[static_cast<size_t>(counter)].load(std::memory_order_relaxed);
+  }
+
+  void set(Gauge gauge, double value)
+  {
+    gauges_[static_cast<size_t>(gauge)].store(value, std::memory_order_relaxed);
+  }
+
+  double get(Gauge gauge) const
+  {
+    return gauges_[static_cast<size_t>(gauge)].load(std::memory_order_relaxed);
+  }
+
+  // Counters, gauges and the stage latency histograms in Prometheus text format.
+  std::string renderPrometheus() const;
+
+private:
+  Metrics() = default;
+
+  Metrics(const Metrics &) = delete;
+  Metrics &operator=(const Metrics &) = delete;
+
+  std::array<std::atomic<uint64_t>, static_cast<size_t>(Counter::Count)> counters_{};
+  std::array<std::atomic<double>, static_cast<size_t>(Gauge::Count)> gauges_{};
+};
+
+// Serves GET /metrics on a background thread. Binds to loopback only.
+class MetricsServer
+{
+public:
+  MetricsServer();
+  ~MetricsServer();
+
+  bool start(int port);
+  void stop();
+
+private:
+  std::unique_ptr<httplib::Server> server_;
+  std::thread thread_;
+};
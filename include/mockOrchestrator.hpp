@@ -0,0 +1,79 @@
+#pragma once
+
+#include "httplib.h"
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+
+// Stand-in for the orchestrator, for benchmarks and headless runs. Serves
+// /health and /process-audio with the same X-Auth check, answering uploads with
+// a WAV of responseBytes. Latency and faults can be injected per request:
+//   failRate     - 500 Internal Server Error
+//   resetRate    - connection dropped halfway through the response body
+//   trickleRate  - body sent in small pieces at trickleBytesPerSecond
+// Rates are probabilities in [0, 1], drawn in that order.
+struct MockOrchestratorOptions
+{
+  std::string authToken;
+  size_t responseBytes = 64 * 1024;
+  int latencyMs = 0;
+  double failRate = 0.0;
+  double resetRate = 0.0;
+  double trickleRate = 0.0;
+  size_t trickleBytesPerSecond = 32 * 1024;
+  unsigned seed = 1;
+};
+
+class MockOrchestrator
+{
+public:
+  explicit MockOrchestrator(const MockOrchestratorOptions &options = {});
+
+  ~MockOrchestrator();
+
+  // Listens on a background thread. Returns once the server accepts connections.
+  bool start(const std::string &host, int port);
+
+  void stop();
+
+  // Blocks serving requests on the calling thread.
+  bool listen(const std::string &host, int port);
+
+  uint64_t requests() const { return requests_.load(); }
+  uint64_t rejectedAuth() const { return rejectedAuth_.load(); }
+  uint64_t injectedFailures() const { return injectedFailures_.load(); }
+  uint64_t injectedResets() const { return injectedResets_.load(); }
+  uint64_t trickled() const { return trickled_.load(); }
+  uint64_t bytesReceived() const { return bytesReceived_.load(); }
+
+private:
+  enum class Fault
+  {
+    None,
+    Fail,
+    Reset,
+    Trickle
+  };
+
+  MockOrchestratorOptions options_;
+  httplib::Server server_;
+  std::thread thread_;
+  std::string response_;
+
+  std::mutex rngMutex_;
+  std::mt19937 rng_;
+
+  std::atomic<uint64_t> requests_{0};
+  std::atomic<uint64_t> rejectedAuth_{0};
+  std::atomic<uint64_t> injectedFailures_{0};
+  std::atomic<uint64_t> injectedResets_{0};
+  std::atomic<uint64_t> trickled_{0};
+  std::atomic<uint64_t> bytesReceived_{0};
+
+  void setupRoutes();
+  bool authorized(const httplib::Request &req, httplib::Response &res);
+  Fault drawFault();
+};
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Background noise estimate by minimum statistics: the smoothed frame power is
+// tracked over a sliding window of a few seconds and its minimum, scaled for
+// bias, is taken as the floor. Speech only raises the power, so short
+// utterances (including the wake word itself) do not lift the estimate.
+//
+// update() is called from a single thread (the wake word loop); the getters
+// are safe to call from any thread.
+class NoiseFloorTracker
+{
+public:
+  explicit NoiseFloorTracker(int sampleRate = 16000, float windowSeconds = 2.0f);
+
+  // Returns true when the frame completed a sub-window and the floor was
+  // re-estimated.
+  bool update(const int16_t *frame, size_t numSamples);
+  void reset();
+
+  // True once a full window has been seen.
+  bool hasEstimate() const;
+
+  // Floor as mean square (RMS squared) and in dB relative to full scale.
+  float floorMeanSquare() const;
+  float floorDbfs() const;
+
+  // VAD thresholds as SNR margins above the floor, in dB.
+  void setMargins(float startDb, float stopDb);
+  float startThresholdSq() const;
+  float stopThresholdSq() const;
+  float startThresholdDbfs() const;
+  float stopThresholdDbfs() const;
+
+private:
+  static constexpr int NUM_SUBWINDOWS = 8;
+  static constexpr float SMOOTHING = 0.85f;
+  static constexpr float BIAS = 1.2f; // minimum of a noisy power track sits below its mean
+
+  // Thresholds never drop below these, so digital silence or a muted mic
+  // cannot make every click count as speech.
+  static constexpr float MIN_START_SQ = 150.0f * 150.0f;
+  static constexpr float MIN_STOP_SQ = 100.0f * 100.0f;
+
+  size_t subwindowSamples_;
+  size_t samplesInSubwindow_ = 0;
+  float smoothed_ = -1.0f;
+  float subwindowMin_;
+  std::vector<float> subwindowMins_;
+  size_t subwindowIndex_ = 0;
+  size_t subwindowsSeen_ = 0;
+
+  std::atomic<bool> hasEstimate_{false};
+  std::atomic<float> floor_{0.0f};
+  std::atomic<float> startMargin_; // linear power ratios
+  std::atomic<float> stopMargin_;
+};
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+
+struct NotificationConfig
+{
+  size_t maxQueued = 8;                          // beyond this, the least important message is dropped
+  std::chrono::milliseconds repeatInterval{10000}; // the last text said is not repeated sooner than this
+};
+
+// Spoken status messages, said one at a time on a thread of their own so
+// that no caller waits on speech. A message already queued or being said is
+// not queued again, a repeat of the last message within repeatInterval is
+// dropped, and the most important queued message goes first.
+class NotificationQueue
+{
+public:
+  enum class Priority
+  {
+    Low,    // progress chatter; dropped from the queue once anything more important arrives
+    Normal,
+    High    // outcomes the user must hear
+  };
+
+  // Says one message; runs on the queue's thread.
+  using Speaker = std::function<bool(const std::string &text)>;
+
+  explicit NotificationQueue(Speaker speak, const NotificationConfig &config = {});
+  ~NotificationQueue();
+
+  NotificationQueue(const NotificationQueue &) = delete;
+  NotificationQueue &operator=(const NotificationQueue &) = delete;
+
+  void start();
+
+  // Finishes the message being said and drops the rest.
+  void stop();
+
+  // Never blocks on speech. Messages sharing a non-empty topic report one
+  // piece of state ("orchestrator": not available / back online), so a newer
+  // one replaces any still queued.
+  void notify(const std::string &text, Priority priority = Priority::Normal, const std::string &topic = {});
+
+  size_t pending() const;
+
+private:
+  struct Item
+  {
+    std::string text;
+    Priority priority;
+    std::string topic;
+  };
+
+  Speaker speak_;
+  NotificationConfig config_;
+
+  mutable std::mutex mutex_;
+  std::condition_variable wake_;
+  std::deque<Item> queue_; // arrival order; a handful of entries, scanned linearly
+  std::string speaking_;
+  std::string lastSaid_;
+  std::chrono::steady_clock::time_point lastSaidAt_;
+  bool stopping_ = false;
+  std::thread thread_;
+
+  void run();
+};
@@ -0,0 +1,46 @@
+#pragma once
+
+#include "audioSink.hpp"
+#include "ringBuffer.hpp"
+#include <atomic>
+#include <memory>
+#include <portaudio.h>
+
+// Speaker output. Samples go through a jitter buffer drained by a PortAudio
+// callback; the device stream starts once prebufferMs of audio is queued (or
+// at drain() for short clips).
+class PortAudioSink : public AudioSink
+{
+public:
+  explicit PortAudioSink(int prebufferMs = 200);
+
+  ~PortAudioSink() override;
+
+  bool open(int sampleRate, int channels) override;
+  bool write(const int16_t *samples, size_t count) override;
+  bool drain() override;
+  void abort() override;
+
+  uint64_t underrunFrames() const { return underrunFrames_.load(std::memory_order_relaxed); }
+
+private:
+  bool paInitialized = false;
+  int prebufferMs;
+  PaStream *stream = nullptr;
+
+  std::unique_ptr<SpscRingBuffer<int16_t>> jitterBuffer_; // allocated once, kept across responses
+  bool open_ = false;
+  size_t prebufferSamples_ = 0;
+  int sampleRate_ = 0;
+  int channels_ = 1;
+  std::atomic<bool> draining_{false};
+  std::atomic<uint64_t> underrunFrames_{0};
+
+  bool startStream();
+
+  static int paCallback(const void *input, void *output,
+                        unsigned long frameCount,
+                        const PaStreamCallbackTimeInfo *timeInfo,
+                        PaStreamCallbackFlags statusFlags,
+                        void *userData);
+};
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Fixed-size circular history of the most recent samples. Used to keep a short
+// window of audio from before speech onset so it can be prepended to the
+// recording. Not thread-safe; owned by a single reader.
+class PreRollBuffer
+{
+public:
+  explicit PreRollBuffer(size_t capacitySamples = 0)
+      : buffer_(capacitySamples) {}
+
+  void resize(size_t capacitySamples)
+  {
+    buffer_.assign(capacitySamples, 0);
+    head_ = 0;
+    size_ = 0;
+  }
+
+  size_t capacity() const { return buffer_.size(); }
+  size_t size() const { return size_; }
+
+  void clear()
+  {
+    head_ = 0;
+    size_ = 0;
+  }
+
+  void push(const int16_t *data, size_t count)
+  {
+    const size_t cap = buffer_.size();
+    if (cap == 0)
+    {
+      return;
+    }
+    if (count >= cap)
+    {
+      // Only the newest cap samples survive.
+      std::copy(data + (count - cap), data + count, buffer_.begin());
+      head_ = 0;
+      size_ = cap;
+      return;
+    }
+
+    const size_t firstPart = std::min(count, cap - head_);
+    std::copy(data, data + firstPart, buffer_.begin() + head_);
+    std::copy(data + firstPart, data + count, buffer_.begin());
+    head_ = (head_ + count) % cap;
+    size_ = std::min(size_ + count, cap);
+  }
+
+  // Appends the buffered history, oldest first, to out.
+  void appendTo(std::vector<int16_t> &out) const
+  {
+    const size_t cap = buffer_.size();
+    const size_t start = (head_ + cap - size_) % (cap == 0 ? 1 : cap);
+    const size_t firstPart = std::min(size_, cap - start);
+    out.insert(out.end(), buffer_.begin() + start, buffer_.begin() + start + firstPart);
+    out.insert(out.end(), buffer_.begin(), buffer_.begin() + (size_ - firstPart));
+  }
+
+private:
+  std::vector<int16_t> buffer_;
+  size_t head_ = 0; // next write position
+  size_t size_ = 0;
+};
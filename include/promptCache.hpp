@@ -0,0 +1,86 @@
+#pragma once
+
+#include "audioSink.hpp"
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// A spoken prompt, ready to hand to an AudioSink.
+struct PromptClip
+{
+  const int16_t *samples = nullptr;
+  size_t count = 0;
+  int sampleRate = 0;
+};
+
+// Spoken prompts rendered once by espeak-ng and kept as PCM16 clips in a
+// memory-mapped asset pack, so saying one costs no process spawn. load()
+// renders whatever the pack lacks and rewrites it; text that was not known
+// up front is rendered on first use and added to the pack as well.
+//
+// Pack layout (native endianness): "SPK1", uint32 count, uint32 length and
+// text of the voice settings it was rendered with, count index entries, the
+// texts, then the samples at 8-byte alignment. A pack rendered with other
+// settings is rendered again.
+class PromptCache
+{
+public:
+  PromptCache(const std::string &packPath, const std::string &voice, int wordsPerMinute);
+  ~PromptCache();
+
+  PromptCache(const PromptCache &) = delete;
+  PromptCache &operator=(const PromptCache &) = delete;
+
+  // Maps the pack and renders any of texts it does not hold yet.
+  void load(const std::vector<std::string> &texts);
+
+  // The clip for text, synthesized and cached on a miss. The samples stay
+  // valid for the cache's lifetime. False if espeak-ng failed.
+  bool get(const std::string &text, PromptClip &clip);
+
+  size_t size() const;
+
+  // Runs espeak-ng with the given settings and collects its WAV output.
+  static bool synthesize(const std::string &text, const std::string &voice, int wordsPerMinute,
+                         std::vector<int16_t> &samples, int &sampleRate);
+
+private:
+  struct Rendered
+  {
+    std::vector<int16_t> samples;
+    int sampleRate = 0;
+  };
+
+  std::string packPath_;
+  std::string voice_;
+  int wordsPerMinute_;
+
+  mutable std::mutex mutex_;
+  const uint8_t *map_ = nullptr;
+  size_t mapSize_ = 0;
+  std::unordered_map<std::string, PromptClip> packed_;
+  std::unordered_map<std::string, Rendered> rendered_; // not in the mapped pack
+
+  std::string settings() const;
+  void mapPack();
+  bool renderLocked(const std::string &text);
+  void savePack();
+};
+
+// Says prompts through an AudioSink, one at a time; callers on
+// different threads queue up behind each other.
+class PromptPlayer
+{
+public:
+  PromptPlayer(PromptCache &cache, AudioSink &sink);
+
+  // Blocks until the prompt has played.
+  bool say(const std::string &text);
+
+private:
+  PromptCache &cache_;
+  AudioSink &sink_;
+  std::mutex mutex_;
+};
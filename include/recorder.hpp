@@ -1,35 +1,79 @@
 #pragma once
 #include <string>
 #include <vector>
+#include <functional>
+#include <memory>
 #include <cstdint> 
-#include <portaudio.h> 
+#include "preRollBuffer.hpp"
+#include "bufferPool.hpp"
+#include "vad.hpp"
+#include "noiseFloor.hpp"
+#include "endpointer.hpp"
+
+class AudioSource;
+
+// Optional hooks for consumers that want the audio while it is being recorded,
+// e.g. to stream it to the orchestrator before the endpoint.
+struct RecordingCallbacks
+{
+  std::function<void()> onSpeechStart;
+  std::function<void(const int16_t *samples, size_t count)> onAudio;
+  std::function<void()> onEndpoint;
+};
 
 class MicrophoneRecorder
 {
 public:
   MicrophoneRecorder(int sampleRate = 16000, int channels = 1);
 
-  ~MicrophoneRecorder();
+  // Reads from the source shared with the wake word detector; no device is
+  // opened per command. The source keeps every sample, so the recording
+  // picks up right after the frame the wake word was detected in, and speech
+  // that runs straight on from the wake word is kept without the wake word.
+  // The returned buffer is moved out of the recorder's pool; hand it back with
+  // recycleRecording() so the next command reuses its capacity.
+  std::vector<int16_t> recordWithVAD(AudioSource &capture, const RecordingCallbacks &callbacks = {});
+
+  void recycleRecording(std::vector<int16_t> &&buffer);
+
+  const BufferPool<int16_t> &recordingPool() const;
+
+  // Audio kept from before the frame the VAD first marks as speech.
+  void setPreRollMs(int ms);
+
+  // "energy" (default) or "spectral"; see vad.hpp.
+  void setVadEngine(const std::string &engine);
+
+  // When set and warmed up, energy thresholds follow the measured noise floor
+  // instead of VAD_START_THRESHOLD_SQ / VAD_STOP_THRESHOLD_SQ.
+  void setNoiseFloorTracker(const NoiseFloorTracker *tracker);
 
-  bool isInitialized() const;
+  // Audio heard between commands; lets the VAD learn the room beforehand.
+  void observeIdle(const int16_t *frame, size_t numSamples);
 
-  std::vector<int16_t> recordWithVAD();
+  // No-speech timeout, hangover and max-length policy for recordWithVAD().
+  void setEndpointerConfig(const EndpointerConfig &config);
 
-  bool playAudioData(const std::vector<uint8_t> &wavData);
+  // How the last recordWithVAD() call ended, including endpoint latency.
+  const EndpointStats &lastEndpoint() const;
 
 private:
-  bool initialized;
   int sampleRate;
   int channels;
 
   static constexpr float VAD_START_THRESHOLD_SQ = 500.0f * 500.0f;
   static constexpr float VAD_STOP_THRESHOLD_SQ = 300.0f * 300.0f;
 
-  static constexpr int MAX_SILENCE_FRAMES_BEFORE_STOP = 30;
   static constexpr int FRAME_DURATION_MS = 20;
+  static constexpr int DEFAULT_PRE_ROLL_MS = 300;
 
   static constexpr size_t MAX_RECORDING_SAMPLES = 60 * 16000; // 60 seconds at 16kHz
+  BufferPool<int16_t> recordingPool_{MAX_RECORDING_SAMPLES};
   std::vector<int16_t> recordingBuffer_;
+  PreRollBuffer onsetPreRoll_;
+  std::unique_ptr<VoiceActivityDetector> vad_;
+  const NoiseFloorTracker *noiseFloor_ = nullptr;
+  Endpointer endpointer_;
 
-  float computeRMS(const int16_t *data, size_t numSamples);
+  void applyNoiseFloor();
 };
\ No newline at end of file
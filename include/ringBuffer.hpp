@@ -0,0 +1,90 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstring>
+#include <vector>
+
+// Lock-free single-producer/single-consumer ring buffer.
+// The producer (typically a PortAudio callback) only touches writeIndex_,
+// the consumer only touches readIndex_, so neither side ever blocks.
+template <typename T>
+class SpscRingBuffer
+{
+public:
+  // Capacity is rounded up to the next power of two.
+  explicit SpscRingBuffer(size_t minCapacity)
+  {
+    size_t capacity = 1;
+    while (capacity < minCapacity)
+    {
+      capacity <<= 1;
+    }
+    buffer_.resize(capacity);
+    mask_ = capacity - 1;
+  }
+
+  size_t capacity() const { return buffer_.size(); }
+
+  // Number of elements ready to be read. Safe from either side.
+  size_t available() const
+  {
+    return writeIndex_.load(std::memory_order_acquire) - readIndex_.load(std::memory_order_acquire);
+  }
+
+  // Producer side. Writes as many elements as fit and returns that count.
+  size_t write(const T *data, size_t count)
+  {
+    const size_t write = writeIndex_.load(std::memory_order_relaxed);
+    const size_t read = readIndex_.load(std::memory_order_acquire);
+    const size_t space = buffer_.size() - (write - read);
+    if (count > space)
+    {
+      count = space;
+    }
+
+    const size_t start = write & mask_;
+    const size_t firstPart = std::min(count, buffer_.size() - start);
+    std::memcpy(buffer_.data() + start, data, firstPart * sizeof(T));
+    std::memcpy(buffer_.data(), data + firstPart, (count - firstPart) * sizeof(T));
+
+    writeIndex_.store(write + count, std::memory_order_release);
+    return count;
+  }
+
+  // Consumer side. Reads up to count elements and returns how many were read.
+  size_t read(T *dest, size_t count)
+  {
+    const size_t read = readIndex_.load(std::memory_order_relaxed);
+    const size_t write = writeIndex_.load(std::memory_order_acquire);
+    if (count > write - read)
+    {
+      count = write - read;
+    }
+
+    const size_t start = read & mask_;
+    const size_t firstPart = std::min(count, buffer_.size() - start);
+    std::memcpy(dest, buffer_.data() + start, firstPart * sizeof(T));
+    std::memcpy(dest + firstPart, buffer_.data(), (count - firstPart) * sizeof(T));
+
+    readIndex_.store(read + count, std::memory_order_release);
+    return count;
+  }
+
+  // Consumer side. Drops everything currently buffered and returns the count.
+  size_t discardAll()
+  {
+    const size_t read = readIndex_.load(std::memory_order_relaxed);
+    const size_t write = writeIndex_.load(std::memory_order_acquire);
+    readIndex_.store(write, std::memory_order_release);
+    return write - read;
+  }
+
+private:
+  std::vector<T> buffer_;
+  size_t mask_ = 0;
+
+  alignas(64) std::atomic<size_t> writeIndex_{0};
+  alignas(64) std::atomic<size_t> readIndex_{0};
+};
@@ -0,0 +1,105 @@
+#pragma once
+
+#include "audioSink.hpp"
+#include "flac.hpp"
+#include <cstdint>
+#include <vector>
+
+// Response encodings StreamingPlayer can decode, for the request's Accept
+// header. WAVE codecs are named by format tag in hex (RFC 2361): 1 PCM16,
+// 6 A-law, 7 mu-law, 11 IMA ADPCM.
+constexpr const char *ACCEPTED_RESPONSE_AUDIO =
+    "audio/flac, audio/vnd.wave;codec=11, audio/vnd.wave;codec=7, audio/vnd.wave;codec=6, audio/wav;q=0.5";
+
+// Incremental RIFF/WAVE parser. Bytes may arrive in arbitrary pieces; once the
+// fmt chunk has been seen, everything inside the data chunk is decoded to
+// PCM16 as soon as it is complete: single samples for PCM16 and G.711
+// A-law/mu-law, whole blocks for IMA ADPCM. Streamed WAVs often carry a bogus
+// data size, so the data chunk is treated as running to the end of the stream;
+// a fact chunk, when present, caps the output at its sample count so the
+// padding of a final IMA block is not played.
+class WavStreamParser
+{
+public:
+  enum class State
+  {
+    RiffHeader,
+    ChunkHeader,
+    FmtChunk,
+    FactChunk,
+    SkipChunk,
+    Data,
+    Error
+  };
+
+  void reset();
+
+  // Feeds raw bytes. Decoded samples are appended to out. Returns false on a
+  // malformed or unsupported stream.
+  bool feed(const uint8_t *data, size_t len, std::vector<int16_t> &out);
+
+  bool hasFormat() const { return state_ == State::Data; }
+  int getSampleRate() const { return sampleRate_; }
+  int getChannels() const { return channels_; }
+
+private:
+  State state_ = State::RiffHeader;
+  std::vector<uint8_t> pending_;
+  size_t needed_ = 12;
+  size_t skipRemaining_ = 0;
+
+  uint16_t audioFormat_ = 0;
+  uint16_t channels_ = 0;
+  uint32_t sampleRate_ = 0;
+  uint16_t blockAlign_ = 0;
+  uint16_t bitsPerSample_ = 0;
+  bool haveFmt_ = false;
+  uint32_t factFrames_ = 0; // 0 = no fact chunk
+  uint64_t samplesOut_ = 0;
+
+  bool handleHeaderBytes();
+  bool checkEncoding() const;
+  size_t feedData(const uint8_t *data, size_t len, std::vector<int16_t> &out);
+  void limitToFact(std::vector<int16_t> &out, size_t start);
+};
+
+// Plays a response while it is still downloading: incoming bytes are decoded
+// and handed to the sink as soon as whole samples are available. The first
+// bytes pick the container, so WAV and FLAC responses both work.
+class StreamingPlayer
+{
+public:
+  explicit StreamingPlayer(AudioSink &sink);
+
+  // Prepares for a new response, dropping anything still queued in the sink.
+  void reset();
+
+  // Compatible with httplib::ContentReceiver. Returning false aborts the download.
+  bool feed(const char *data, size_t len);
+
+  // Plays out whatever is buffered and closes the sink.
+  bool finish();
+
+  size_t bytesReceived() const { return bytesReceived_; }
+
+private:
+  AudioSink &sink_;
+  bool sinkOpen_ = false;
+  bool failed = false;
+
+  enum class Container
+  {
+    Unknown, // fewer than four bytes seen
+    Wav,
+    Flac
+  };
+  Container container_ = Container::Unknown;
+  std::vector<uint8_t> magic_;
+
+  WavStreamParser parser_;
+  flac::Decoder flac_;
+  std::vector<int16_t> decoded_;
+  size_t bytesReceived_ = 0;
+
+  bool decode(const uint8_t *data, size_t len);
+};
@@ -0,0 +1,116 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Frame-level voice activity decision. The recorder calls process() once per
+// 20 ms frame; inSpeech tells the engine whether an utterance is already
+// running so it can apply start/continue hysteresis.
+class VoiceActivityDetector
+{
+public:
+  virtual ~VoiceActivityDetector() = default;
+
+  virtual bool process(const int16_t *frame, size_t numSamples, bool inSpeech) = 0;
+
+  // Last frame's score in the engine's own units (energy or log-likelihood).
+  virtual float lastScore() const = 0;
+
+  virtual const char *name() const = 0;
+
+  // Level thresholds (mean square) derived from the measured noise floor.
+  // Engines that do not use absolute levels ignore them.
+  virtual void setEnergyThresholds(float startThresholdSq, float stopThresholdSq)
+  {
+    (void)startThresholdSq;
+    (void)stopThresholdSq;
+  }
+
+  // Audio heard while waiting for the wake word. Engines that model the
+  // background learn it here, so a command that starts straight after the
+  // wake word is not taken for the room's noise.
+  virtual void observeIdle(const int16_t *frame, size_t numSamples)
+  {
+    (void)frame;
+    (void)numSamples;
+  }
+};
+
+// The original detector: mean-square energy against start/stop levels, either
+// the recorder's constants or ones derived from the noise floor.
+class EnergyVad : public VoiceActivityDetector
+{
+public:
+  EnergyVad(float startThresholdSq, float stopThresholdSq);
+
+  bool process(const int16_t *frame, size_t numSamples, bool inSpeech) override;
+  float lastScore() const override { return lastEnergy_; }
+  const char *name() const override { return "energy"; }
+  void setEnergyThresholds(float startThresholdSq, float stopThresholdSq) override;
+
+private:
+  float startThresholdSq_;
+  float stopThresholdSq_;
+  float lastEnergy_ = 0.0f;
+};
+
+// Spectral detector in the style of WebRTC's VAD: log energies in six
+// sub-bands (80 Hz - 4 kHz) plus spectral flatness, scored by per-band
+// two-component Gaussian mixtures for noise and speech. The noise mixtures
+// adapt on non-speech frames, so steady HVAC or fan noise is absorbed into the
+// noise model instead of holding the detector open. The models are seeded from
+// the first frame seen, which should be background, so feed idle audio through
+// observeIdle() before the first recording.
+class SpectralVad : public VoiceActivityDetector
+{
+public:
+  explicit SpectralVad(int sampleRate = 16000);
+
+  bool process(const int16_t *frame, size_t numSamples, bool inSpeech) override;
+  float lastScore() const override { return lastLlr_; }
+  const char *name() const override { return "spectral"; }
+  void observeIdle(const int16_t *frame, size_t numSamples) override;
+
+  static constexpr int NUM_BANDS = 6;
+  static constexpr int NUM_COMPONENTS = 2;
+
+private:
+  struct Mixture
+  {
+    std::array<float, NUM_COMPONENTS> weight;
+    std::array<float, NUM_COMPONENTS> mean;
+    std::array<float, NUM_COMPONENTS> stddev;
+  };
+
+  int sampleRate_;
+  size_t fftSize_;
+  std::vector<float> window_;
+  std::vector<float> twiddleRe_;
+  std::vector<float> twiddleIm_;
+  std::vector<float> re_; // FFT work buffers
+  std::vector<float> im_;
+  std::vector<float> power_;
+  std::array<std::pair<size_t, size_t>, NUM_BANDS> bandBins_;
+  std::pair<size_t, size_t> flatnessBins_;
+
+  std::array<Mixture, NUM_BANDS> noise_;
+  std::array<Mixture, NUM_BANDS> speech_;
+  bool modelsInitialized_ = false;
+  bool idleInSpeech_ = false; // hysteresis state of the idle stream
+  std::vector<int16_t> idleFrame_; // idle audio not yet making up a 20 ms frame
+  float lastLlr_ = 0.0f;
+
+  void computePowerSpectrum(const int16_t *frame, size_t numSamples);
+  void initializeModels(const std::array<float, NUM_BANDS> &features);
+  void adapt(const std::array<float, NUM_BANDS> &features, bool speech);
+};
+
+// "energy" or "spectral"; unknown names fall back to energy.
+std::unique_ptr<VoiceActivityDetector> createVad(const std::string &engine,
+                                                 int sampleRate,
+                                                 float startThresholdSq,
+                                                 float stopThresholdSq);
@@ -4,11 +4,12 @@
 #include <vector>
 #include <functional>
 #include <cstdint>
-#include <portaudio.h>
 #include <pv_porcupine.h>
+#include "noiseFloor.hpp"
 
 
 class AppLogger;
+class AudioSource;
 
 class PorcupineDetector
 {
@@ -16,17 +17,27 @@ public:
   PorcupineDetector(const std::string &accessKey,
                     const std::string &modelPath,
                     const std::string &keywordPath,
-                    float sensitivity);
+                    float sensitivity,
+                    AudioSource &capture);
 
   ~PorcupineDetector();
 
   bool isInitialized() const;
 
+  // Loops until the audio source reaches end of stream (file replay only).
   void run(const std::function<void()> &onWakeWord);
 
+  // Noise floor measured from the frames run() listens to while idle.
+  NoiseFloorTracker &getNoiseFloor();
+
+  // Called from run() with every frame it listens to while idle.
+  void setIdleListener(std::function<void(const int16_t *frame, size_t numSamples)> listener);
+
 private:
   pv_porcupine_t *porcupineHandle = nullptr;
-  PaStream *paStream = nullptr;
+  AudioSource &capture;
+  NoiseFloorTracker noiseFloor;
+  std::function<void(const int16_t *, size_t)> idleListener;
 
   bool initializedPorcupine = false;
   bool initializedStream = false;
@@ -0,0 +1,52 @@
+#pragma once
+
+#include "audioSource.hpp"
+#include <chrono>
+#include <string>
+#include <vector>
+
+// Replays a recorded session from a PCM16 WAV file in place of the microphone.
+// In real-time mode reads are paced by the wall clock and drain() skips the
+// audio that "arrived" while nobody was reading, exactly like the live
+// capture. In fast mode reads return immediately and nothing is ever dropped,
+// so a run over the same file is deterministic.
+//
+// trailingSilenceMs of silence is appended so the last command can reach its
+// endpoint before the stream ends.
+class WavFileSource : public AudioSource
+{
+public:
+  WavFileSource(const std::string &path, bool realtime, int trailingSilenceMs = 2000);
+
+  bool isLoaded() const { return loaded_; }
+
+  bool start() override;
+  void stop() override;
+  bool isRunning() const override { return running_; }
+
+  bool read(int16_t *dest, size_t numSamples,
+            std::chrono::milliseconds timeout = std::chrono::milliseconds(1000)) override;
+
+  size_t drain() override;
+
+  bool endOfStream() const override { return position_ >= samples_.size(); }
+
+  int getSampleRate() const override { return sampleRate_; }
+  int getChannels() const override { return channels_; }
+
+  // Position in the recording, in ms of audio.
+  double positionMs() const;
+
+private:
+  std::vector<int16_t> samples_;
+  size_t position_ = 0;
+  int sampleRate_ = 0;
+  int channels_ = 0;
+  bool loaded_ = false;
+  bool realtime_;
+  bool running_ = false;
+  std::chrono::steady_clock::time_point startTime_;
+
+  // Samples that have "arrived" by now in real-time mode.
+  size_t clockPosition() const;
+};
@@ -93,7 +93,7 @@ else
 fi
 
 info "Compiling Sarah client..."
-g++ src/wakeword.cpp src/main.cpp src/client.cpp src/recorder.cpp src/configLoader.cpp src/AppLogger.cpp \
+g++ src/wakeword.cpp src/main.cpp src/client.cpp src/flac.cpp src/imaAdpcm.cpp src/linkEstimator.cpp src/healthMonitor.cpp src/recorder.cpp src/configLoader.cpp src/AppLogger.cpp src/logFormat.cpp src/logArchiver.cpp src/audioCapture.cpp src/audioChunkQueue.cpp src/streamingPlayer.cpp src/promptCache.cpp src/notificationQueue.cpp src/energy.cpp src/vad.cpp src/noiseFloor.cpp src/endpointer.cpp src/wavFileSource.cpp src/portAudioSink.cpp src/latency.cpp src/metrics.cpp \
    -I include -O3 -flto \
    -lportaudio \
    -L./lib -Wl,-rpath,'$ORIGIN/lib' -lpv_porcupine \
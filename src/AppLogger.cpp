@@ -1,7 +1,29 @@
 #include "AppLogger.hpp"
 #include <stdexcept>
+#include <algorithm>
 #include <iostream>
 #include <iomanip>
+#include <cstring>
+#include <cstdint>
+#include <cstdio>
+
+namespace {
+    // How long the writer sleeps when the queue is empty. Errors wake it
+    // early; info lines may sit this long before reaching the file.
+    constexpr auto WRITER_IDLE_WAIT = std::chrono::milliseconds(50);
+
+    const char* TRUNCATED_MARK = "...";
+
+    int64_t nowNs() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                   std::chrono::system_clock::now().time_since_epoch())
+            .count();
+    }
+}
+
+AppLogger::Site AppLogger::sites_[MAX_SITES];
+std::atomic<uint32_t> AppLogger::siteCount_{0};
+std::atomic<AppLogger::Level> AppLogger::level_{AppLogger::Level::Info};
 
 
 AppLogger& AppLogger::getInstance() {
@@ -10,17 +32,63 @@ AppLogger& AppLogger::getInstance() {
 }
 
 
-AppLogger::AppLogger() = default;
+AppLogger::AppLogger()
+    : slots_(new Slot[QUEUE_SLOTS]), sitesWritten_(MAX_SITES + 1, false) {
+    static_assert((QUEUE_SLOTS & (QUEUE_SLOTS - 1)) == 0, "QUEUE_SLOTS must be a power of two");
+    static_assert(sizeof(Slot) <= SLOT_BYTES, "Slot outgrew SLOT_BYTES");
+    for (size_t i = 0; i < QUEUE_SLOTS; ++i) {
+        slots_[i].sequence.store(i, std::memory_order_relaxed);
+    }
+    writer_ = std::thread(&AppLogger::writerLoop, this);
+}
 
 AppLogger::~AppLogger() {
+    running_.store(false, std::memory_order_release);
+    wake_.notify_one();
+    if (writer_.joinable()) {
+        writer_.join();
+    }
+
+    bool spilled = false;
+    {
+        std::lock_guard<std::mutex> lock(fileMutex_);
+        // An active file on tmpfs would not survive a reboot, so hand it to
+        // the archive on the way out.
+        if (logFile.is_open() && !rotation_.directory.empty() &&
+            std::filesystem::path(rotation_.directory) != logPath_.parent_path()) {
+            rotate(false);
+            spilled = true;
+        }
+    }
+    // The archiver logs through us, and the writer is gone: stop it first,
+    // then write what it said by hand.
+    archiver_.stop();
+
+    std::lock_guard<std::mutex> lock(fileMutex_);
+    std::string out;
+    std::string errors;
+    drain(out, errors);
+    if (spilled && !out.empty()) {
+        // A new active file, continued by the next session.
+        logFile.clear();
+        logFile.open(logPath_, std::ios_base::app | std::ios_base::binary);
+        if (logFile.is_open()) {
+            writeFileHeader();
+        }
+    }
     if (logFile.is_open()) {
-        logFile << "--- Log Ended: " << getTimestamp() << " ---\n";
+        logFile.write(out.data(), out.size());
+        writeFileFooter();
         logFile.close();
+    } else if (format_ == Format::Text) {
+        std::cout.write(out.data(), out.size());
     }
+    std::cerr.write(errors.data(), errors.size());
 }
 
-bool AppLogger::open(const std::string& filename) {
+bool AppLogger::open(const std::string& filename, Format format) {
     std::filesystem::path logPath(filename);
+    std::lock_guard<std::mutex> lock(fileMutex_);
     if (logPath.has_parent_path()) {
         std::error_code ec;
         std::filesystem::create_directories(logPath.parent_path(), ec);
@@ -30,40 +98,295 @@ bool AppLogger::open(const std::string& filename) {
             return false;
         }
     }
-    logFile.open(filename, std::ios_base::app);
+    logFile.open(filename, std::ios_base::app | std::ios_base::binary);
     if (!logFile.is_open()) {
         std::cerr << "Error: Could not open log file: " << filename << std::endl;
         return false;
     }
-    logFile << "--- Log Started: " << getTimestamp() << " ---\n";
+    logPath_ = logPath;
+    format_ = format;
+    std::error_code ec;
+    const auto existing = std::filesystem::file_size(logPath_, ec);
+    fileBytes_ = ec ? 0 : existing;
+    fileOpened_ = std::chrono::steady_clock::now();
+    writeFileHeader();
+    archiver_.configure(rotation_, logPath_.filename().string());
     return true;
 }
 
+void AppLogger::setRotation(const LogRotation& rotation) {
+    std::lock_guard<std::mutex> lock(fileMutex_);
+    rotation_ = rotation;
+    if (logFile.is_open()) {
+        archiver_.configure(rotation_, logPath_.filename().string());
+    }
+}
+
+// The write helpers below are called with fileMutex_ held.
+void AppLogger::writeFileHeader() {
+    std::string header;
+    if (format_ == Format::Binary) {
+        // Site ids are per process, so every session and every rotated file
+        // declares its own.
+        std::fill(sitesWritten_.begin(), sitesWritten_.end(), false);
+        logformat::appendHeader(header, nowNs());
+    } else {
+        char timestamp[32];
+        logformat::formatTimestamp(std::time(nullptr), timestamp, sizeof(timestamp));
+        header = std::string("--- Log Started: ") + timestamp + " ---\n";
+    }
+    logFile.write(header.data(), header.size());
+    fileBytes_ += header.size();
+    recordsSinceHeader_ = false;
+}
+
+void AppLogger::writeFileFooter() {
+    std::string footer;
+    if (format_ == Format::Binary) {
+        logformat::appendEnd(footer, nowNs());
+    } else {
+        char timestamp[32];
+        logformat::formatTimestamp(std::time(nullptr), timestamp, sizeof(timestamp));
+        footer = std::string("--- Log Ended: ") + timestamp + " ---\n";
+    }
+    logFile.write(footer.data(), footer.size());
+}
+
+bool AppLogger::rotationDue() const {
+    // Otherwise a quiet client rotates out empty files on age alone, and
+    // pruning them pushes the real logs out of the archive.
+    if (!recordsSinceHeader_) {
+        return false;
+    }
+    if (rotation_.maxBytes > 0 && fileBytes_ >= rotation_.maxBytes) {
+        return true;
+    }
+    return rotation_.maxAgeSeconds > 0 &&
+           std::chrono::steady_clock::now() - fileOpened_ >= std::chrono::seconds(rotation_.maxAgeSeconds);
+}
+
+// Only a rename on the active file's filesystem; the archiver does the rest.
+void AppLogger::rotate(bool reopen) {
+    writeFileFooter();
+    logFile.close();
+
+    char stamp[32];
+    std::tm local_tm{};
+    const std::time_t now = std::time(nullptr);
+    localtime_r(&now, &local_tm);
+    std::strftime(stamp, sizeof(stamp), "%Y%m%d-%H%M%S", &local_tm);
+    // The sequence number keeps names unique and in rotation order when
+    // several share a second; the archive may already hold earlier ones.
+    std::filesystem::path rotated;
+    do {
+        char suffix[48];
+        std::snprintf(suffix, sizeof(suffix), ".%s-%03u", stamp, rotationSeq_++ % 1000);
+        rotated = logPath_;
+        rotated += suffix;
+    } while (std::filesystem::exists(rotated));
+
+    std::error_code ec;
+    std::filesystem::rename(logPath_, rotated, ec);
+    if (!ec) {
+        archiver_.submit(rotated);
+    }
+    if (!reopen) {
+        return;
+    }
+
+    logFile.clear();
+    logFile.open(logPath_, std::ios_base::app | std::ios_base::binary);
+    fileBytes_ = 0;
+    fileOpened_ = std::chrono::steady_clock::now();
+    if (logFile.is_open()) {
+        writeFileHeader();
+    }
+}
+
 void AppLogger::info(const std::string& message) {
-    logToStream("[INFO] " + message + "\n");
+    if (enabled(Level::Info)) {
+        enqueue(Level::Info, message);
+    }
 }
 
 void AppLogger::error(const std::string& message) {
-    std::cerr << "[ERROR] " << message << "\n";
-    logToStream("[ERROR] " + message + "\n");
-    logFile.flush();
+    if (enabled(Level::Error)) {
+        enqueue(Level::Error, message);
+    }
 }
 
-std::string AppLogger::getTimestamp() {
-    auto now = std::chrono::system_clock::now();
-    std::time_t now_c = std::chrono::system_clock::to_time_t(now);
-    std::tm* local_tm = std::localtime(&now_c);
-    
-    char buffer[80];
-    std::strftime(buffer, sizeof(buffer), "%Y-%m-%d %H:%M:%S", local_tm);
-    return buffer;
+uint32_t AppLogger::registerSite(Level level, const char* format, const char* file, int line) {
+    const uint32_t index = siteCount_.fetch_add(1, std::memory_order_relaxed);
+    if (index >= MAX_SITES) {
+        return 0;
+    }
+    // Published to the writer by the release store of the first record.
+    sites_[index] = {level, format, file, line};
+    return index + 1;
 }
 
-void AppLogger::logToStream(const std::string& message) {
-    if (logFile.is_open()) {
-        logFile << getTimestamp() << " " << message;
+// Bounded MPSC queue after Vyukov: each slot's sequence says whose turn it
+// is, so producers only contend on the enqueue position.
+AppLogger::Slot* AppLogger::claim(size_t& pos) {
+    pos = enqueuePos_.load(std::memory_order_relaxed);
+    while (true) {
+        Slot* slot = &slots_[pos & (QUEUE_SLOTS - 1)];
+        const size_t sequence = slot->sequence.load(std::memory_order_acquire);
+        const intptr_t diff = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos);
+        if (diff == 0) {
+            if (enqueuePos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                slot->timeNs = nowNs();
+                return slot;
+            }
+        } else if (diff < 0) {
+            dropped_.fetch_add(1, std::memory_order_relaxed);
+            return nullptr;
+        } else {
+            pos = enqueuePos_.load(std::memory_order_relaxed);
+        }
+    }
+}
+
+void AppLogger::publish(Slot* slot, size_t pos) {
+    const bool urgent = slot->level >= Level::Warn;
+    slot->sequence.store(pos + 1, std::memory_order_release);
+
+    // Warnings and errors also go to stderr, so do not leave them waiting out
+    // the idle sleep; in a burst, wake the writer well before the queue fills.
+    if (urgent || (pos & (QUEUE_SLOTS / 4 - 1)) == 0) {
+        wake_.notify_one();
+    }
+}
+
+void AppLogger::enqueue(Level level, const std::string& message) {
+    size_t pos;
+    Slot* slot = claim(pos);
+    if (!slot) {
+        return;
+    }
+    slot->site = 0;
+    slot->level = level;
+    if (message.size() <= TEXT_BYTES) {
+        slot->length = static_cast<uint16_t>(message.size());
+        std::memcpy(slot->payload, message.data(), message.size());
+    } else {
+        const size_t markLength = std::strlen(TRUNCATED_MARK);
+        slot->length = static_cast<uint16_t>(TEXT_BYTES);
+        std::memcpy(slot->payload, message.data(), TEXT_BYTES - markLength);
+        std::memcpy(slot->payload + TEXT_BYTES - markLength, TRUNCATED_MARK, markLength);
+    }
+    publish(slot, pos);
+}
+
+void AppLogger::renderText(std::string& out, const Slot& slot) {
+    if (slot.site == 0) {
+        out.append(slot.payload, slot.length);
     } else {
-        // fallback to std::cout if the log file is not open
-        std::cout << getTimestamp() << " " << message;
+        logformat::render(out, sites_[slot.site - 1].format, slot.payload, slot.length);
     }
-}
\ No newline at end of file
+}
+
+// Called with fileMutex_ held.
+size_t AppLogger::drain(std::string& out, std::string& errors) {
+    size_t drained = 0;
+    while (drained < QUEUE_SLOTS) {
+        Slot& slot = slots_[dequeuePos_ & (QUEUE_SLOTS - 1)];
+        if (slot.sequence.load(std::memory_order_acquire) != dequeuePos_ + 1) {
+            break;
+        }
+
+        if (format_ == Format::Binary) {
+            if (slot.site != 0 && !sitesWritten_[slot.site]) {
+                const Site& site = sites_[slot.site - 1];
+                logformat::appendSite(out, slot.site, site.level, site.file, static_cast<uint32_t>(site.line), site.format);
+                sitesWritten_[slot.site] = true;
+            }
+            logformat::appendEntry(out, slot.site, slot.level, slot.timeNs, slot.payload, slot.length);
+        } else {
+            out.append(cachedTimestamp(static_cast<std::time_t>(slot.timeNs / 1000000000)));
+            out.push_back(' ');
+            out.append(logformat::levelTag(slot.level));
+            out.push_back(' ');
+            renderText(out, slot);
+            out.push_back('\n');
+        }
+        if (slot.level >= Level::Warn) {
+            errors.append(logformat::levelTag(slot.level));
+            errors.push_back(' ');
+            renderText(errors, slot);
+            errors.push_back('\n');
+        }
+
+        slot.sequence.store(dequeuePos_ + QUEUE_SLOTS, std::memory_order_release);
+        ++dequeuePos_;
+        ++drained;
+    }
+    return drained;
+}
+
+void AppLogger::writerLoop() {
+    std::string out;
+    std::string errors;
+    out.reserve(QUEUE_SLOTS * SLOT_BYTES);
+    uint64_t reportedDrops = 0;
+
+    while (true) {
+        // Read before draining so nothing enqueued ahead of shutdown is lost.
+        const bool stopping = !running_.load(std::memory_order_acquire);
+
+        out.clear();
+        errors.clear();
+        size_t drained;
+        {
+            std::lock_guard<std::mutex> lock(fileMutex_);
+            drained = drain(out, errors);
+
+            const uint64_t drops = dropped_.load(std::memory_order_relaxed);
+            if (drops != reportedDrops) {
+                const std::string message = "AppLogger: queue full, dropped " + std::to_string(drops - reportedDrops) + " log records";
+                if (format_ == Format::Binary) {
+                    logformat::appendEntry(out, 0, Level::Error, nowNs(), message.data(), message.size());
+                } else {
+                    out.append(cachedTimestamp(std::time(nullptr)));
+                    out.append(" [ERROR] " + message + "\n");
+                }
+                reportedDrops = drops;
+            }
+
+            if (!out.empty()) {
+                if (logFile.is_open()) {
+                    logFile.write(out.data(), out.size());
+                    logFile.flush();
+                    fileBytes_ += out.size();
+                    recordsSinceHeader_ = true;
+                } else if (format_ == Format::Text) {
+                    // fallback to std::cout if the log file is not open
+                    std::cout.write(out.data(), out.size());
+                    std::cout.flush();
+                }
+            }
+            if (logFile.is_open() && rotationDue()) {
+                rotate(true);
+            }
+        }
+        if (!errors.empty()) {
+            std::cerr.write(errors.data(), errors.size());
+        }
+
+        if (stopping) {
+            break;
+        }
+        if (drained == 0) {
+            std::unique_lock<std::mutex> lock(wakeMutex_);
+            wake_.wait_for(lock, WRITER_IDLE_WAIT);
+        }
+    }
+}
+
+const char* AppLogger::cachedTimestamp(std::time_t when) {
+    if (when != cachedSecond_) {
+        logformat::formatTimestamp(when, timestampBuffer_, sizeof(timestampBuffer_));
+        cachedSecond_ = when;
+    }
+    return timestampBuffer_;
+}
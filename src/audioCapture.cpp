@@ -0,0 +1,195 @@
+#include "audioCapture.hpp"
+#include "AppLogger.hpp"
+#include <algorithm>
+#include <string>
+#include <thread>
+
+namespace
+{
+  constexpr unsigned long CALLBACK_FRAMES = 256;
+}
+
+AudioCapture::AudioCapture(int sampleRate, int channels, int ringSeconds)
+    : sampleRate(sampleRate),
+      channels(channels),
+      ring_(static_cast<size_t>(sampleRate) * channels * ringSeconds)
+{
+  // Pa_Initialize is reference counted, so this is safe alongside PortAudioSink.
+  PaError err = Pa_Initialize();
+  if (err != paNoError)
+  {
+    AppLogger::getInstance().error("AudioCapture: PortAudio initialization failed: " + std::string(Pa_GetErrorText(err)));
+    return;
+  }
+  paInitialized = true;
+}
+
+AudioCapture::~AudioCapture()
+{
+  stop();
+  if (paInitialized)
+  {
+    Pa_Terminate();
+  }
+}
+
+int AudioCapture::paCallback(const void *input, void * /*output*/,
+                             unsigned long frameCount,
+                             const PaStreamCallbackTimeInfo * /*timeInfo*/,
+                             PaStreamCallbackFlags statusFlags,
+                             void *userData)
+{
+  auto *self = static_cast<AudioCapture *>(userData);
+  if (statusFlags & paInputOverflow)
+  {
+    self->inputOverflows_.fetch_add(1, std::memory_order_relaxed);
+  }
+  if (input == nullptr)
+  {
+    return paContinue;
+  }
+
+  const size_t count = frameCount * self->channels;
+  const size_t written = self->ring_.write(static_cast<const int16_t *>(input), count);
+  if (written < count)
+  {
+    self->droppedSamples_.fetch_add(count - written, std::memory_order_relaxed);
+  }
+  return paContinue;
+}
+
+bool AudioCapture::start()
+{
+  if (stream)
+  {
+    return true;
+  }
+  if (!paInitialized)
+  {
+    AppLogger::getInstance().error("AudioCapture: PortAudio not initialized. Cannot start capture.");
+    return false;
+  }
+
+  AppLogger::getInstance().info("AudioCapture: Opening shared input stream...");
+
+  PaError err = Pa_OpenDefaultStream(&stream,
+                                     channels,
+                                     0,
+                                     paInt16,
+                                     sampleRate,
+                                     CALLBACK_FRAMES,
+                                     &AudioCapture::paCallback,
+                                     this);
+  if (err != paNoError)
+  {
+    AppLogger::getInstance().error("AudioCapture: Failed to open input stream: " + std::string(Pa_GetErrorText(err)));
+    stream = nullptr;
+    return false;
+  }
+
+  ring_.discardAll();
+
+  err = Pa_StartStream(stream);
+  if (err != paNoError)
+  {
+    AppLogger::getInstance().error("AudioCapture: Failed to start input stream: " + std::string(Pa_GetErrorText(err)));
+    Pa_CloseStream(stream);
+    stream = nullptr;
+    return false;
+  }
+
+  AppLogger::getInstance().info("AudioCapture: Input stream started.");
+  return true;
+}
+
+void AudioCapture::stop()
+{
+  if (!stream)
+  {
+    return;
+  }
+
+  PaError err = Pa_StopStream(stream);
+  if (err != paNoError)
+  {
+    AppLogger::getInstance().error("AudioCapture: Warning: Failed to stop input stream: " + std::string(Pa_GetErrorText(err)));
+  }
+
+  err = Pa_CloseStream(stream);
+  if (err != paNoError)
+  {
+    AppLogger::getInstance().error("AudioCapture: Warning: Failed to close input stream: " + std::string(Pa_GetErrorText(err)));
+  }
+  stream = nullptr;
+  AppLogger::getInstance().info("AudioCapture: Input stream closed.");
+
+  if (droppedSamples() > 0 || inputOverflows() > 0)
+  {
+    LOG_WARN("AudioCapture: {} samples dropped, {} device input overflows", droppedSamples(), inputOverflows());
+  }
+}
+
+bool AudioCapture::isRunning() const
+{
+  return stream != nullptr && Pa_IsStreamActive(stream) == 1;
+}
+
+bool AudioCapture::read(int16_t *dest, size_t numSamples, std::chrono::milliseconds timeout)
+{
+  if (!stream)
+  {
+    return false;
+  }
+
+  // Nothing is taken from the ring until the whole request is there, so a
+  // read that times out leaves the audio for the next one.
+  const auto deadline = std::chrono::steady_clock::now() + timeout;
+  while (true)
+  {
+    const size_t available = ring_.available();
+    if (available >= numSamples)
+    {
+      ring_.read(dest, numSamples);
+      return true;
+    }
+
+    if (std::chrono::steady_clock::now() >= deadline || !isRunning())
+    {
+      return false;
+    }
+
+    // Sleep roughly until the missing audio should have arrived.
+    const long missingUs = static_cast<long>((numSamples - available) * 1000000 / (sampleRate * channels));
+    std::this_thread::sleep_for(std::chrono::microseconds(std::clamp(missingUs, 500L, 10000L)));
+  }
+}
+
+size_t AudioCapture::drain()
+{
+  return ring_.discardAll();
+}
+
+size_t AudioCapture::available() const
+{
+  return ring_.available();
+}
+
+uint64_t AudioCapture::droppedSamples() const
+{
+  return droppedSamples_.load(std::memory_order_relaxed);
+}
+
+uint64_t AudioCapture::inputOverflows() const
+{
+  return inputOverflows_.load(std::memory_order_relaxed);
+}
+
+int AudioCapture::getSampleRate() const
+{
+  return sampleRate;
+}
+
+int AudioCapture::getChannels() const
+{
+  return channels;
+}
@@ -0,0 +1,80 @@
+#include "audioChunkQueue.hpp"
+#include <algorithm>
+
+AudioChunkQueue::AudioChunkQueue(size_t slots, size_t chunkSamples)
+    : slots_(std::max<size_t>(slots, 1))
+{
+  for (auto &slot : slots_)
+  {
+    slot.reserve(chunkSamples);
+  }
+}
+
+void AudioChunkQueue::push(const int16_t *samples, size_t count)
+{
+  if (count == 0)
+  {
+    return;
+  }
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (finished_ || cancelled_)
+    {
+      return;
+    }
+    if (queued_ == slots_.size())
+    {
+      // The uploader has fallen behind the whole ring: grow it, oldest first.
+      std::rotate(slots_.begin(), slots_.begin() + head_, slots_.end());
+      head_ = 0;
+      slots_.emplace_back();
+    }
+    slots_[(head_ + queued_) % slots_.size()].assign(samples, samples + count);
+    ++queued_;
+    totalSamples_ += count;
+  }
+  cv_.notify_one();
+}
+
+void AudioChunkQueue::finish()
+{
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    finished_ = true;
+  }
+  cv_.notify_all();
+}
+
+void AudioChunkQueue::cancel()
+{
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    cancelled_ = true;
+    head_ = 0;
+    queued_ = 0;
+  }
+  cv_.notify_all();
+}
+
+bool AudioChunkQueue::pop(std::vector<int16_t> &chunk)
+{
+  std::unique_lock<std::mutex> lock(mutex_);
+  cv_.wait(lock, [this]
+           { return queued_ > 0 || finished_ || cancelled_; });
+
+  if (cancelled_ || queued_ == 0)
+  {
+    return false;
+  }
+
+  chunk.swap(slots_[head_]);
+  head_ = (head_ + 1) % slots_.size();
+  --queued_;
+  return true;
+}
+
+size_t AudioChunkQueue::totalSamples() const
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  return totalSamples_;
+}
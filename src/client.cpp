@@ -1,21 +1,209 @@
 #include "client.hpp"
+#include "AppLogger.hpp"
+#include "audioChunkQueue.hpp"
+#include "imaAdpcm.hpp"
+#include "latency.hpp"
+#include "metrics.hpp"
+#include "streamingPlayer.hpp"
 #include "httplib.h"
-#include <iostream>
 #include <fstream>
 #include <cstring>
 #include <vector>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+
+namespace
+{
+  // Keep-alive probes find a dead peer within about a minute of silence.
+  constexpr int TCP_KEEPALIVE_IDLE_SECONDS = 30;
+  constexpr int TCP_KEEPALIVE_INTERVAL_SECONDS = 10;
+  constexpr int TCP_KEEPALIVE_PROBES = 3;
+
+  // Called by httplib for every socket it opens, before connecting.
+  void configureSocket(socket_t sock)
+  {
+    const int on = 1;
+    setsockopt(sock, SOL_SOCKET, SO_KEEPALIVE, &on, sizeof(on));
+    setsockopt(sock, IPPROTO_TCP, TCP_KEEPIDLE, &TCP_KEEPALIVE_IDLE_SECONDS, sizeof(int));
+    setsockopt(sock, IPPROTO_TCP, TCP_KEEPINTVL, &TCP_KEEPALIVE_INTERVAL_SECONDS, sizeof(int));
+    setsockopt(sock, IPPROTO_TCP, TCP_KEEPCNT, &TCP_KEEPALIVE_PROBES, sizeof(int));
+  }
+}
 
 HttpClient::HttpClient(const std::string &host, int port, const std::string &authToken)
     : cli_(host, port)
 {
-  cli_.set_default_headers({{"X-Auth", authToken}});
+  cli_.set_default_headers({{"X-Auth", authToken}, {"Accept", ACCEPTED_RESPONSE_AUDIO}});
   cli_.set_connection_timeout(std::chrono::seconds(5));
   cli_.set_read_timeout(std::chrono::seconds(30));
   cli_.set_write_timeout(std::chrono::seconds(30));
+  cli_.set_keep_alive(true);
+  cli_.set_tcp_nodelay(true);
+  cli_.set_socket_options([this](socket_t sock)
+                          {
+    configureSocket(sock);
+    socketOpened_ = true; });
+}
+
+HttpClient::~HttpClient()
+{
+  if (prewarmThread_.joinable())
+  {
+    prewarmThread_.join();
+  }
+}
+
+void HttpClient::setIdleTimeout(std::chrono::seconds timeout)
+{
+  std::lock_guard<std::mutex> lock(connectionMutex_);
+  idleTimeout_ = timeout;
+}
+
+// Called with connectionMutex_ held, so no request is in flight.
+void HttpClient::reapIdleConnection()
+{
+  if (idleTimeout_.count() > 0 && cli_.is_socket_open() &&
+      std::chrono::steady_clock::now() - lastUsed_ > idleTimeout_)
+  {
+    LOG_DEBUG("HttpClient: closing connection idle for over {} s", idleTimeout_.count());
+    cli_.stop();
+  }
 }
 
-std::vector<uint8_t> HttpClient::createWavFromPCM(const std::vector<int16_t> &pcmData,
-                                                  int sampleRate, int channels)
+// Called with connectionMutex_ held after each request. Counts a connection
+// only if the socket hook ran and the connect itself did not fail; true if
+// the request opened a new socket at all.
+bool HttpClient::countConnection(const httplib::Result &res)
+{
+  if (!socketOpened_)
+  {
+    return false;
+  }
+  if (res || (res.error() != httplib::Error::Connection && res.error() != httplib::Error::ConnectionTimeout))
+  {
+    Metrics::getInstance().increment(Metrics::Counter::HttpConnectionsOpened);
+  }
+  return true;
+}
+
+void HttpClient::prewarm(const std::string &path)
+{
+  if (prewarmThread_.joinable())
+  {
+    prewarmThread_.join();
+  }
+  prewarmThread_ = std::thread([this, path]()
+                               {
+    std::lock_guard<std::mutex> lock(connectionMutex_);
+    reapIdleConnection();
+    socketOpened_ = false;
+    auto res = cli_.Get(path);
+    countConnection(res);
+    lastUsed_ = std::chrono::steady_clock::now();
+    if (res)
+    {
+      LOG_DEBUG("HttpClient: connection warm ({})", res->status);
+    }
+    else
+    {
+      LOG_DEBUG("HttpClient: prewarm failed: {}", httplib::to_string(res.error()));
+    } });
+}
+
+void HttpClient::setUploadFormat(UploadFormat format)
+{
+  uploadFormat_ = format;
+}
+
+UploadFormat HttpClient::parseUploadFormat(const std::string &name)
+{
+  if (name == "raw")
+  {
+    return UploadFormat::RawPcm;
+  }
+  if (name == "wav")
+  {
+    return UploadFormat::Wav;
+  }
+  if (name == "flac")
+  {
+    return UploadFormat::Flac;
+  }
+  if (name == "adpcm")
+  {
+    return UploadFormat::ImaAdpcm;
+  }
+  if (name == "auto")
+  {
+    return UploadFormat::Auto;
+  }
+  return UploadFormat::Multipart;
+}
+
+void HttpClient::setLossyMinSaving(std::chrono::milliseconds saving)
+{
+  lossyMinSavingSeconds_ = saving.count() < 0 ? -1.0 : saving.count() / 1000.0;
+}
+
+// Expected time to the upload-complete point is the encode time plus the
+// transfer time of the body on the link as last measured. Until the link has
+// been measured, FLAC is the safe bet: never much slower than WAV on a fast
+// link, and lossless.
+UploadFormat HttpClient::chooseUploadFormat(size_t pcmBytes, double audioSeconds)
+{
+  auto expected = [&](const EncodingCost &cost)
+  {
+    return cost.encodeSecondsPerAudioSecond * audioSeconds + link_.transferSeconds(static_cast<size_t>(pcmBytes * cost.sizeRatio));
+  };
+  const double wav = link_.transferSeconds(pcmBytes);
+  const double flac = expected(flacCost_);
+  const double adpcm = expected(imaAdpcmCost_);
+
+  Metrics &metrics = Metrics::getInstance();
+  metrics.set(Metrics::Gauge::LinkRttSeconds, link_.rttSeconds());
+  metrics.set(Metrics::Gauge::LinkUploadBytesPerSecond, link_.bytesPerSecond());
+  metrics.set(Metrics::Gauge::FlacSizeRatio, flacCost_.sizeRatio);
+  metrics.set(Metrics::Gauge::ExpectedUploadSecondsWav, wav);
+  metrics.set(Metrics::Gauge::ExpectedUploadSecondsFlac, flac);
+  metrics.set(Metrics::Gauge::ExpectedUploadSecondsImaAdpcm, adpcm);
+
+  UploadFormat choice = UploadFormat::Flac;
+  if (link_.hasEstimate())
+  {
+    choice = wav <= flac ? UploadFormat::Wav : UploadFormat::Flac;
+    if (lossyMinSavingSeconds_ >= 0 && adpcm + lossyMinSavingSeconds_ <= std::min(wav, flac))
+    {
+      choice = UploadFormat::ImaAdpcm;
+    }
+  }
+  LOG_DEBUG("HttpClient: upload as {} (expected wav {} ms, flac {} ms, adpcm {} ms; rtt {} ms, {} kB/s)",
+            choice == UploadFormat::Wav ? "wav" : choice == UploadFormat::Flac ? "flac"
+                                                                                  : "adpcm",
+            wav * 1e3, flac * 1e3, adpcm * 1e3, link_.rttSeconds() * 1e3, link_.bytesPerSecond() / 1e3);
+  return choice;
+}
+
+// While streaming, audio is produced in real time, so what matters is whether
+// the link keeps up with WAV's byte rate; with headroom to spare, WAV saves
+// the encoder's block delay.
+UploadFormat HttpClient::chooseStreamingFormat(int sampleRate, int channels) const
+{
+  const double wavBytesPerSecond = 2.0 * sampleRate * channels;
+  return link_.hasEstimate() && link_.bytesPerSecond() >= 4 * wavBytesPerSecond ? UploadFormat::Wav : UploadFormat::Flac;
+}
+
+void HttpClient::recordEncoding(EncodingCost &cost, double seconds, double audioSeconds, size_t bytes, size_t pcmBytes)
+{
+  constexpr double ALPHA = 0.3;
+  if (audioSeconds > 0 && pcmBytes > 0)
+  {
+    cost.encodeSecondsPerAudioSecond += ALPHA * (seconds / audioSeconds - cost.encodeSecondsPerAudioSecond);
+    cost.sizeRatio += ALPHA * (static_cast<double>(bytes) / pcmBytes - cost.sizeRatio);
+  }
+}
+
+WavHeader HttpClient::makeWavHeader(size_t numSamples, int sampleRate, int channels)
 {
   WavHeader header;
   header.numChannels = channels;
@@ -23,60 +211,328 @@ std::vector<uint8_t> HttpClient::createWavFromPCM(const std::vector<int16_t> &pc
   header.byteRate = sampleRate * channels * 2;
   header.blockAlign = channels * 2;
 
-  uint32_t dataSize = pcmData.size() * sizeof(int16_t);
+  uint32_t dataSize = numSamples * sizeof(int16_t);
   header.dataSize = dataSize;
   header.fileSize = sizeof(WavHeader) - 8 + dataSize;
+  return header;
+}
 
-  std::vector<uint8_t> wavData;
-  wavData.reserve(sizeof(WavHeader) + dataSize);
-
-  wavData.resize(sizeof(WavHeader));
-  std::memcpy(wavData.data(), &header, sizeof(WavHeader));
+std::vector<uint8_t> HttpClient::takeLastResponseAudio()
+{
+  return std::move(lastResponseAudio_);
+}
 
-  const uint8_t *pcmBytes = reinterpret_cast<const uint8_t *>(pcmData.data());
-  wavData.insert(wavData.end(), pcmBytes, pcmBytes + dataSize);
+void HttpClient::recycleResponseBuffer(std::vector<uint8_t> &&buffer)
+{
+  responsePool_.release(std::move(buffer));
+}
 
-  return wavData;
+const BufferPool<uint8_t> &HttpClient::responsePool() const
+{
+  return responsePool_;
 }
 
-std::vector<uint8_t> HttpClient::getLastResponseAudio() const
+void HttpClient::setResponseReceiver(httplib::ContentReceiver receiver)
 {
-  return lastResponseAudio_;
+  responseReceiver_ = std::move(receiver);
 }
 
 bool HttpClient::postOrch(const std::string &path, const std::vector<int16_t> &audioData,
                           int sampleRate, int channels)
 {
-  std::cout << "processing audio in-memory: " << audioData.size() << " samples" << std::endl;
+  LOG_DEBUG("HttpClient: processing audio in-memory: {} samples", audioData.size());
+
+  const WavHeader header = makeWavHeader(audioData.size(), sampleRate, channels);
+
+  // The body is a list of views into memory that outlives the request; the
+  // content provider writes each one to the socket directly.
+  struct Segment
+  {
+    const char *data;
+    size_t size;
+  };
+  std::vector<Segment> segments;
+  std::string multipartHead;
+  std::string multipartTail;
+
+  httplib::Request req;
+  req.method = "POST";
+  req.path = path;
+
+  const size_t pcmBytes = audioData.size() * sizeof(int16_t);
+  const double audioSeconds = static_cast<double>(audioData.size()) / (sampleRate * channels);
+  const UploadFormat format = uploadFormat_ == UploadFormat::Auto ? chooseUploadFormat(pcmBytes, audioSeconds) : uploadFormat_;
+  const auto encodeStart = std::chrono::steady_clock::now();
+
+  switch (format)
+  {
+  case UploadFormat::Multipart:
+  {
+    const std::string boundary = httplib::detail::make_multipart_data_boundary();
+    multipartHead = "--" + boundary + "\r\n"
+                    "Content-Disposition: form-data; name=\"file\"; filename=\"recording.wav\"\r\n"
+                    "Content-Type: audio/wav\r\n\r\n";
+    multipartTail = "\r\n--" + boundary + "--\r\n";
+    req.set_header("Content-Type", httplib::detail::serialize_multipart_formdata_get_content_type(boundary));
+    segments.push_back({multipartHead.data(), multipartHead.size()});
+    segments.push_back({reinterpret_cast<const char *>(&header), sizeof(WavHeader)});
+    break;
+  }
+  case UploadFormat::Wav:
+  case UploadFormat::Auto: // resolved above
+    req.set_header("Content-Type", "audio/wav");
+    segments.push_back({reinterpret_cast<const char *>(&header), sizeof(WavHeader)});
+    break;
+  case UploadFormat::RawPcm:
+    req.set_header("Content-Type", "application/octet-stream");
+    req.set_header("X-Sample-Format", "s16le");
+    req.set_header("X-Sample-Rate", std::to_string(sampleRate));
+    req.set_header("X-Channels", std::to_string(channels));
+    break;
+  case UploadFormat::Flac:
+    req.set_header("Content-Type", flac::CONTENT_TYPE);
+    encodedUpload_.clear();
+    flac::encode(audioData.data(), audioData.size(), sampleRate, channels, encodedUpload_);
+    recordEncoding(flacCost_, std::chrono::duration<double>(std::chrono::steady_clock::now() - encodeStart).count(),
+                   audioSeconds, encodedUpload_.size(), pcmBytes);
+    LOG_DEBUG("HttpClient: FLAC body {} bytes for {} bytes of PCM", encodedUpload_.size(), pcmBytes);
+    break;
+  case UploadFormat::ImaAdpcm:
+    req.set_header("Content-Type", ima::CONTENT_TYPE);
+    encodedUpload_.clear();
+    ima::encodeWav(audioData.data(), audioData.size(), sampleRate, channels, encodedUpload_);
+    recordEncoding(imaAdpcmCost_, std::chrono::duration<double>(std::chrono::steady_clock::now() - encodeStart).count(),
+                   audioSeconds, encodedUpload_.size(), pcmBytes);
+    break;
+  }
+
+  Metrics::getInstance().increment(format == UploadFormat::Multipart  ? Metrics::Counter::UploadsMultipart
+                                   : format == UploadFormat::RawPcm   ? Metrics::Counter::UploadsRawPcm
+                                   : format == UploadFormat::Flac     ? Metrics::Counter::UploadsFlac
+                                   : format == UploadFormat::ImaAdpcm ? Metrics::Counter::UploadsImaAdpcm
+                                                                      : Metrics::Counter::UploadsWav);
+  if (format == UploadFormat::Flac || format == UploadFormat::ImaAdpcm)
+  {
+    segments.push_back({reinterpret_cast<const char *>(encodedUpload_.data()), encodedUpload_.size()});
+  }
+  else
+  {
+    segments.push_back({reinterpret_cast<const char *>(audioData.data()), pcmBytes});
+  }
+  if (!multipartTail.empty())
+  {
+    segments.push_back({multipartTail.data(), multipartTail.size()});
+  }
 
-  std::vector<uint8_t> wavData = createWavFromPCM(audioData, sampleRate, channels);
-  std::string wav_content(wavData.begin(), wavData.end());
+  size_t totalSize = 0;
+  for (const auto &segment : segments)
+  {
+    totalSize += segment.size;
+  }
 
-  std::vector<httplib::MultipartFormData> items = {
-      {"file",
-       wav_content,
-       "recording.wav",
-       "audio/wav"}};
+  req.content_length_ = totalSize;
+  req.content_provider_ = [&segments, totalSize](size_t offset, size_t /*length*/, httplib::DataSink &sink) -> bool
+  {
+    for (size_t i = 0; i < segments.size(); ++i)
+    {
+      const auto &segment = segments[i];
+      if (offset < segment.size)
+      {
+        const bool ok = sink.write(segment.data + offset, segment.size - offset);
+        if (ok)
+        {
+          Metrics::getInstance().increment(Metrics::Counter::BytesSent, segment.size - offset);
+        }
+        if (ok && i + 1 == segments.size())
+        {
+          LatencyTracker::getInstance().markLatest(Stage::UploadEnd);
+        }
+        return ok;
+      }
+      offset -= segment.size;
+    }
+    return false;
+  };
 
-  auto res = cli_.Post(path.c_str(), items);
+  return handleResponse(send(req));
+}
+
+bool HttpClient::postOrchStreaming(const std::string &path, AudioChunkQueue &audioQueue,
+                                   int sampleRate, int channels)
+{
+  LOG_DEBUG("HttpClient: streaming audio upload started");
+
+  // Streaming WAV header: the final length is unknown, so the size fields use
+  // the conventional 0xFFFFFFFF placeholder.
+  WavHeader header = makeWavHeader(0, sampleRate, channels);
+  header.dataSize = 0xFFFFFFFF;
+  header.fileSize = 0xFFFFFFFF;
+
+  const UploadFormat format = uploadFormat_ == UploadFormat::Auto ? chooseStreamingFormat(sampleRate, channels) : uploadFormat_;
+  const bool useFlac = format == UploadFormat::Flac;
+  Metrics::getInstance().increment(useFlac ? Metrics::Counter::UploadsFlac : Metrics::Counter::UploadsWav);
+  flac::Encoder encoder(sampleRate, channels);
+  bool headerSent = false;
+  std::vector<int16_t> chunk;
 
+  // Sends whatever the encoder has produced so far.
+  auto flushEncoded = [&](httplib::DataSink &sink) -> bool
+  {
+    if (encodedUpload_.empty())
+    {
+      return true;
+    }
+    Metrics::getInstance().increment(Metrics::Counter::BytesSent, encodedUpload_.size());
+    const bool ok = sink.write(reinterpret_cast<const char *>(encodedUpload_.data()), encodedUpload_.size());
+    encodedUpload_.clear();
+    return ok;
+  };
+
+  auto provider = [&](size_t /*offset*/, size_t /*length*/, httplib::DataSink &sink) -> bool
+  {
+    if (!headerSent)
+    {
+      headerSent = true;
+      if (useFlac)
+      {
+        encodedUpload_.clear();
+        encoder.begin(encodedUpload_);
+        return flushEncoded(sink);
+      }
+      Metrics::getInstance().increment(Metrics::Counter::BytesSent, sizeof(WavHeader));
+      return sink.write(reinterpret_cast<const char *>(&header), sizeof(WavHeader));
+    }
+
+    if (audioQueue.pop(chunk))
+    {
+      if (useFlac)
+      {
+        encoder.push(chunk.data(), chunk.size(), encodedUpload_);
+        return flushEncoded(sink);
+      }
+      Metrics::getInstance().increment(Metrics::Counter::BytesSent, chunk.size() * sizeof(int16_t));
+      return sink.write(reinterpret_cast<const char *>(chunk.data()), chunk.size() * sizeof(int16_t));
+    }
+
+    if (useFlac)
+    {
+      encoder.finish(encodedUpload_);
+      if (!flushEncoded(sink))
+      {
+        return false;
+      }
+    }
+    sink.done();
+    LatencyTracker::getInstance().markLatest(Stage::UploadEnd);
+    return true;
+  };
+
+  httplib::Request req;
+  req.method = "POST";
+  req.path = path;
+  req.set_header("Content-Type", useFlac ? flac::CONTENT_TYPE : "audio/wav");
+  req.set_header("Transfer-Encoding", "chunked");
+  req.set_header("X-Sample-Rate", std::to_string(sampleRate));
+  req.set_header("X-Channels", std::to_string(channels));
+  req.content_provider_ = provider;
+  req.is_chunked_content_provider_ = true;
+
+  auto res = send(req);
+
+  // Whatever the outcome, stop buffering audio nobody will read.
+  audioQueue.cancel();
+
+  LOG_DEBUG("HttpClient: streaming upload finished: {} samples queued", audioQueue.totalSamples());
+  return handleResponse(res);
+}
+
+httplib::Result HttpClient::send(httplib::Request &req)
+{
+  lastStreamedBytes_ = 0;
+  responsePool_.release(std::move(lastResponseAudio_));
+  lastResponseAudio_ = responsePool_.acquire();
+
+  // Only a 200 body is audio; anything else is collected for the error log.
+  // Without an external receiver the body lands directly in a pooled buffer
+  // rather than in res->body, which would cost another full copy.
+  int status = -1;
+  std::string errorBody;
+  req.response_handler = [&](const httplib::Response &response)
+  {
+    status = response.status;
+    // The body has been read by now, so the kernel's view of the
+    // connection includes the whole upload.
+    link_.sample(cli_.socket());
+    if (status == 200)
+    {
+      LatencyTracker::getInstance().mark(Stage::FirstResponseByte);
+    }
+    return true;
+  };
+  req.content_receiver = [&](const char *data, size_t len, uint64_t /*offset*/, uint64_t /*total*/)
+  {
+    Metrics::getInstance().increment(Metrics::Counter::BytesReceived, len);
+    if (status != 200)
+    {
+      errorBody.append(data, len);
+      return true;
+    }
+    lastStreamedBytes_ += len;
+    if (responseReceiver_)
+    {
+      return responseReceiver_(data, len);
+    }
+    lastResponseAudio_.insert(lastResponseAudio_.end(), data, data + len);
+    return true;
+  };
+
+  std::unique_lock<std::mutex> lock(connectionMutex_);
+  reapIdleConnection();
+  Metrics::getInstance().increment(Metrics::Counter::HttpRequests);
+  LatencyTracker::getInstance().mark(Stage::UploadStart);
+  socketOpened_ = false;
+  auto res = cli_.send(req);
+  if (!countConnection(res))
+  {
+    Metrics::getInstance().increment(Metrics::Counter::HttpRequestsReused);
+  }
+  lastUsed_ = std::chrono::steady_clock::now();
+  lock.unlock();
+  if (res && res->status == 200)
+  {
+    LatencyTracker::getInstance().markLatest(Stage::LastResponseByte);
+  }
+  else if (res)
+  {
+    res->body = std::move(errorBody);
+  }
+  return res;
+}
+
+bool HttpClient::handleResponse(const httplib::Result &res)
+{
   if (res)
   {
     if (res->status == 200)
     {
-      std::cout << "upload successful, received response size: " << res->body.size() << " bytes." << std::endl;
-      lastResponseAudio_.assign(res->body.begin(), res->body.end());
+      LOG_DEBUG("HttpClient: upload successful, {} response size: {} bytes.",
+                responseReceiver_ ? "streamed" : "received", lastStreamedBytes_);
       return true;
     }
     else
     {
-      std::cerr << "server returned status code: " << res->status << ". Body: " << res->body << std::endl;
+      const int statusClass = res->status / 100;
+      Metrics::getInstance().increment(statusClass == 4   ? Metrics::Counter::HttpErrors4xx
+                                       : statusClass == 5 ? Metrics::Counter::HttpErrors5xx
+                                                          : Metrics::Counter::HttpErrorsOther);
+      LOG_ERROR("HttpClient: server returned status code: {}. Body: {}", res->status, res->body);
       return false;
     }
   }
   else
   {
-    std::cerr << "request failed: " << httplib::to_string(res.error()) << std::endl;
+    Metrics::getInstance().increment(Metrics::Counter::HttpTransportErrors);
+    LOG_ERROR("HttpClient: request failed: {}", httplib::to_string(res.error()));
     return false;
   }
 }
@@ -1,7 +1,7 @@
 #include "configLoader.hpp"
+#include "AppLogger.hpp"
 #include <fstream>
 #include <sstream>
-#include <iostream>
 
 // Helper function to trim whitespace from both ends of a string
 std::string trim(const std::string &s)
@@ -22,7 +22,7 @@ bool ConfigLoader::loadFromFile(const std::string &filename)
   std::ifstream file(filename);
   if (!file.is_open())
   {
-    std::cerr << "Error: Could not open configuration file: " << filename << std::endl;
+    LOG_ERROR("ConfigLoader: could not open configuration file: {}", filename);
     return false;
   }
 
@@ -0,0 +1,124 @@
+#include "endpointer.hpp"
+#include <algorithm>
+
+Endpointer::Endpointer(const EndpointerConfig &config)
+{
+  setConfig(config);
+}
+
+void Endpointer::setConfig(const EndpointerConfig &config)
+{
+  config_ = config;
+  config_.minHangoverMs = std::max(config_.minHangoverMs, 0);
+  config_.maxHangoverMs = std::max(config_.maxHangoverMs, config_.minHangoverMs);
+  config_.hangoverMs = std::clamp(config_.hangoverMs, config_.minHangoverMs, config_.maxHangoverMs);
+  reset();
+}
+
+const EndpointerConfig &Endpointer::config() const
+{
+  return config_;
+}
+
+void Endpointer::reset()
+{
+  stats_ = {};
+  speechStarted_ = false;
+  waitedMs_ = 0;
+  elapsedMs_ = 0;
+  silenceMs_ = 0;
+  hangoverMs_ = config_.hangoverMs;
+}
+
+int Endpointer::currentHangoverMs() const
+{
+  const int speechMs = stats_.speechMs;
+  if (config_.longUtteranceMs <= 0 || speechMs <= config_.longUtteranceMs)
+  {
+    return hangoverMs_;
+  }
+  // Scales down with utterance length once past longUtteranceMs.
+  const long scaled = static_cast<long>(hangoverMs_) * config_.longUtteranceMs / speechMs;
+  return std::max(static_cast<int>(scaled), config_.minHangoverMs);
+}
+
+EndpointReason Endpointer::process(bool voiced, int frameMs)
+{
+  if (stats_.reason != EndpointReason::None)
+  {
+    return stats_.reason;
+  }
+
+  if (!speechStarted_)
+  {
+    if (!voiced)
+    {
+      waitedMs_ += frameMs;
+      if (config_.noSpeechTimeoutMs > 0 && waitedMs_ >= config_.noSpeechTimeoutMs)
+      {
+        stats_.reason = EndpointReason::NoSpeechTimeout;
+      }
+      return stats_.reason;
+    }
+    speechStarted_ = true;
+  }
+
+  elapsedMs_ += frameMs;
+
+  if (voiced)
+  {
+    if (silenceMs_ > 0 && silenceMs_ + PAUSE_MARGIN_MS > hangoverMs_)
+    {
+      // The speaker came back after this pause; wait a little longer than it
+      // next time before calling the utterance finished.
+      hangoverMs_ = std::min(silenceMs_ + PAUSE_MARGIN_MS, config_.maxHangoverMs);
+    }
+    silenceMs_ = 0;
+    stats_.speechMs = elapsedMs_;
+  }
+  else
+  {
+    silenceMs_ += frameMs;
+    if (silenceMs_ >= currentHangoverMs())
+    {
+      stats_.reason = EndpointReason::Silence;
+    }
+  }
+
+  if (stats_.reason == EndpointReason::None && config_.maxUtteranceMs > 0 && elapsedMs_ >= config_.maxUtteranceMs)
+  {
+    stats_.reason = EndpointReason::MaxLength;
+  }
+
+  if (stats_.reason != EndpointReason::None)
+  {
+    stats_.latencyMs = silenceMs_;
+    stats_.hangoverMs = currentHangoverMs();
+  }
+  return stats_.reason;
+}
+
+bool Endpointer::speechStarted() const
+{
+  return speechStarted_;
+}
+
+const EndpointStats &Endpointer::stats() const
+{
+  return stats_;
+}
+
+const char *Endpointer::reasonName(EndpointReason reason)
+{
+  switch (reason)
+  {
+  case EndpointReason::Silence:
+    return "silence";
+  case EndpointReason::NoSpeechTimeout:
+    return "no speech";
+  case EndpointReason::MaxLength:
+    return "max length";
+  default:
+    return "none";
+  }
+}
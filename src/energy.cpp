@@ -0,0 +1,133 @@
+#include "energy.hpp"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define ENERGY_HAVE_X86 1
+#endif
+
+#if defined(__ARM_NEON) || defined(__aarch64__)
+#include <arm_neon.h>
+#define ENERGY_HAVE_NEON 1
+#if !defined(__aarch64__)
+#include <sys/auxv.h>
+#include <asm/hwcap.h>
+#endif
+#endif
+
+namespace energy
+{
+  uint64_t sumSquaresScalar(const int16_t *data, size_t numSamples)
+  {
+    uint64_t sum = 0;
+    for (size_t i = 0; i < numSamples; ++i)
+    {
+      const int32_t s = data[i];
+      sum += static_cast<uint32_t>(s * s);
+    }
+    return sum;
+  }
+
+#ifdef ENERGY_HAVE_X86
+  // pmaddwd sums two squares per lane. The only pair that exceeds INT32_MAX is
+  // (-32768, -32768) = 2^31, which still fits when the lane is read as uint32,
+  // so lanes are zero-extended to 64 bits before accumulating.
+  __attribute__((target("sse2"))) static uint64_t sumSquaresSse2(const int16_t *data, size_t numSamples)
+  {
+    const __m128i zero = _mm_setzero_si128();
+    __m128i acc = _mm_setzero_si128();
+
+    size_t i = 0;
+    for (; i + 8 <= numSamples; i += 8)
+    {
+      __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + i));
+      __m128i sq = _mm_madd_epi16(v, v);
+      acc = _mm_add_epi64(acc, _mm_unpacklo_epi32(sq, zero));
+      acc = _mm_add_epi64(acc, _mm_unpackhi_epi32(sq, zero));
+    }
+
+    alignas(16) uint64_t lanes[2];
+    _mm_store_si128(reinterpret_cast<__m128i *>(lanes), acc);
+    return lanes[0] + lanes[1] + sumSquaresScalar(data + i, numSamples - i);
+  }
+
+  __attribute__((target("avx2"))) static uint64_t sumSquaresAvx2(const int16_t *data, size_t numSamples)
+  {
+    __m256i acc0 = _mm256_setzero_si256();
+    __m256i acc1 = _mm256_setzero_si256();
+
+    size_t i = 0;
+    for (; i + 16 <= numSamples; i += 16)
+    {
+      __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(data + i));
+      __m256i sq = _mm256_madd_epi16(v, v);
+      acc0 = _mm256_add_epi64(acc0, _mm256_cvtepu32_epi64(_mm256_castsi256_si128(sq)));
+      acc1 = _mm256_add_epi64(acc1, _mm256_cvtepu32_epi64(_mm256_extracti128_si256(sq, 1)));
+    }
+
+    alignas(32) uint64_t lanes[4];
+    _mm256_store_si256(reinterpret_cast<__m256i *>(lanes), _mm256_add_epi64(acc0, acc1));
+    return lanes[0] + lanes[1] + lanes[2] + lanes[3] + sumSquaresScalar(data + i, numSamples - i);
+  }
+#endif
+
+#ifdef ENERGY_HAVE_NEON
+  // vmull_s16 squares exactly into int32 (at most 2^30), and vpadalq_s32
+  // pairwise-adds those into int64 lanes, so nothing can overflow.
+  static uint64_t sumSquaresNeon(const int16_t *data, size_t numSamples)
+  {
+    int64x2_t acc0 = vdupq_n_s64(0);
+    int64x2_t acc1 = vdupq_n_s64(0);
+
+    size_t i = 0;
+    for (; i + 8 <= numSamples; i += 8)
+    {
+      int16x8_t v = vld1q_s16(data + i);
+      int16x4_t lo = vget_low_s16(v);
+      int16x4_t hi = vget_high_s16(v);
+      acc0 = vpadalq_s32(acc0, vmull_s16(lo, lo));
+      acc1 = vpadalq_s32(acc1, vmull_s16(hi, hi));
+    }
+
+    int64x2_t acc = vaddq_s64(acc0, acc1);
+    uint64_t sum = static_cast<uint64_t>(vgetq_lane_s64(acc, 0) + vgetq_lane_s64(acc, 1));
+    return sum + sumSquaresScalar(data + i, numSamples - i);
+  }
+#endif
+
+  std::vector<Kernel> availableKernels()
+  {
+    std::vector<Kernel> kernels = {{"scalar", &sumSquaresScalar}};
+
+#ifdef ENERGY_HAVE_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("sse2"))
+    {
+      kernels.push_back({"sse2", &sumSquaresSse2});
+    }
+    if (__builtin_cpu_supports("avx2"))
+    {
+      kernels.push_back({"avx2", &sumSquaresAvx2});
+    }
+#endif
+
+#ifdef ENERGY_HAVE_NEON
+#if defined(__aarch64__)
+    kernels.push_back({"neon", &sumSquaresNeon}); // mandatory on AArch64
+#else
+    if (getauxval(AT_HWCAP) & HWCAP_NEON)
+    {
+      kernels.push_back({"neon", &sumSquaresNeon});
+    }
+#endif
+#endif
+
+    return kernels;
+  }
+
+  const Kernel &activeKernel()
+  {
+    // Kernels are listed slowest to fastest; thread-safe static init picks once.
+    static const Kernel kernel = availableKernels().back();
+    return kernel;
+  }
+}
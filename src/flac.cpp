@@ -0,0 +1,1099 @@
+#include "flac.hpp"
+#include "AppLogger.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+namespace flac
+{
+  namespace
+  {
+    constexpr int BITS_PER_SAMPLE = 16;
+    constexpr int MAX_FIXED_ORDER = 4;
+    constexpr int MAX_PARTITION_ORDER = 8;
+    constexpr int MAX_RICE_PARAMETER = 14; // 15 is the escape code
+    constexpr int QLP_PRECISION = 12;
+    constexpr int MAX_QLP_SHIFT = 15;
+    constexpr size_t MAX_PENDING_BYTES = 1 << 20; // no sane frame is this long
+
+    enum SubframeType : uint32_t
+    {
+      SUBFRAME_CONSTANT = 0x00,
+      SUBFRAME_VERBATIM = 0x01,
+      SUBFRAME_FIXED = 0x08, // | order
+      SUBFRAME_LPC = 0x20    // | (order - 1)
+    };
+
+    uint8_t crc8(const uint8_t *data, size_t size)
+    {
+      uint8_t crc = 0;
+      for (size_t i = 0; i < size; ++i)
+      {
+        crc ^= data[i];
+        for (int b = 0; b < 8; ++b)
+        {
+          crc = (crc & 0x80) ? static_cast<uint8_t>((crc << 1) ^ 0x07) : static_cast<uint8_t>(crc << 1);
+        }
+      }
+      return crc;
+    }
+
+    uint16_t crc16(const uint8_t *data, size_t size)
+    {
+      uint16_t crc = 0;
+      for (size_t i = 0; i < size; ++i)
+      {
+        crc ^= static_cast<uint16_t>(data[i]) << 8;
+        for (int b = 0; b < 8; ++b)
+        {
+          crc = (crc & 0x8000) ? static_cast<uint16_t>((crc << 1) ^ 0x8005) : static_cast<uint16_t>(crc << 1);
+        }
+      }
+      return crc;
+    }
+
+    // MSB-first bit packer appending to a byte vector.
+    class BitWriter
+    {
+    public:
+      explicit BitWriter(std::vector<uint8_t> &out) : out_(out) {}
+
+      void put(uint32_t value, int bits)
+      {
+        if (bits == 0)
+        {
+          return;
+        }
+        acc_ = (acc_ << bits) | (bits == 32 ? value : (value & ((1u << bits) - 1)));
+        count_ += bits;
+        while (count_ >= 8)
+        {
+          count_ -= 8;
+          out_.push_back(static_cast<uint8_t>(acc_ >> count_));
+        }
+        acc_ &= (uint64_t{1} << count_) - 1;
+      }
+
+      void putSigned(int32_t value, int bits) { put(static_cast<uint32_t>(value), bits); }
+
+      void putRice(int32_t value, int parameter)
+      {
+        const uint32_t folded = (static_cast<uint32_t>(value) << 1) ^ static_cast<uint32_t>(value >> 31);
+        uint32_t zeros = folded >> parameter;
+        while (zeros >= 31)
+        {
+          put(0, 31);
+          zeros -= 31;
+        }
+        put(1, static_cast<int>(zeros) + 1);
+        put(folded, parameter);
+      }
+
+      void alignToByte()
+      {
+        if (count_ > 0)
+        {
+          put(0, 8 - count_);
+        }
+      }
+
+    private:
+      std::vector<uint8_t> &out_;
+      uint64_t acc_ = 0;
+      int count_ = 0;
+    };
+
+    // MSB-first reader that flags, rather than faults on, reads past the end.
+    class BitReader
+    {
+    public:
+      BitReader(const uint8_t *data, size_t size) : data_(data), size_(size) {}
+
+      bool exhausted() const { return exhausted_; }
+      size_t bytePosition() const { return bit_ / 8; }
+
+      uint32_t get(int bits)
+      {
+        uint32_t value = 0;
+        for (int i = 0; i < bits; ++i)
+        {
+          value = (value << 1) | bit();
+        }
+        return value;
+      }
+
+      int32_t getSigned(int bits)
+      {
+        if (bits == 0)
+        {
+          return 0;
+        }
+        const uint32_t raw = get(bits);
+        const uint32_t sign = uint32_t{1} << (bits - 1);
+        return static_cast<int32_t>((raw ^ sign) - sign);
+      }
+
+      uint32_t getUnary()
+      {
+        uint32_t zeros = 0;
+        while (!exhausted_)
+        {
+          // Whole zero bytes at a time; unary runs are often long.
+          if ((bit_ & 7) == 0 && bit_ / 8 < size_ && data_[bit_ / 8] == 0)
+          {
+            zeros += 8;
+            bit_ += 8;
+            continue;
+          }
+          if (bit())
+          {
+            break;
+          }
+          ++zeros;
+        }
+        return zeros;
+      }
+
+      int32_t getRice(int parameter)
+      {
+        const uint32_t folded = (getUnary() << parameter) | get(parameter);
+        return static_cast<int32_t>(folded >> 1) ^ -static_cast<int32_t>(folded & 1);
+      }
+
+      void alignToByte() { bit_ = (bit_ + 7) & ~size_t{7}; }
+
+      // FLAC's UTF-8-style coded frame or sample number.
+      bool getCodedNumber()
+      {
+        const uint32_t first = get(8);
+        int extra = 0;
+        if ((first & 0x80) == 0)
+        {
+          extra = 0;
+        }
+        else if ((first & 0xE0) == 0xC0)
+        {
+          extra = 1;
+        }
+        else if ((first & 0xF0) == 0xE0)
+        {
+          extra = 2;
+        }
+        else if ((first & 0xF8) == 0xF0)
+        {
+          extra = 3;
+        }
+        else if ((first & 0xFC) == 0xF8)
+        {
+          extra = 4;
+        }
+        else if ((first & 0xFE) == 0xFC)
+        {
+          extra = 5;
+        }
+        else if (first == 0xFE)
+        {
+          extra = 6;
+        }
+        else
+        {
+          return false;
+        }
+        for (int i = 0; i < extra; ++i)
+        {
+          if ((get(8) & 0xC0) != 0x80)
+          {
+            return false;
+          }
+        }
+        return true;
+      }
+
+    private:
+      const uint8_t *data_;
+      size_t size_;
+      size_t bit_ = 0;
+      bool exhausted_ = false;
+
+      uint32_t bit()
+      {
+        if (bit_ >= size_ * 8)
+        {
+          exhausted_ = true;
+          return 0;
+        }
+        const uint32_t value = (data_[bit_ / 8] >> (7 - (bit_ & 7))) & 1;
+        ++bit_;
+        return value;
+      }
+    };
+
+    void putCodedNumber(BitWriter &writer, uint64_t value)
+    {
+      if (value < 0x80)
+      {
+        writer.put(static_cast<uint32_t>(value), 8);
+        return;
+      }
+      int extra = 1;
+      while (extra < 6 && value >= (uint64_t{1} << (6 + 5 * extra)))
+      {
+        ++extra;
+      }
+      const uint32_t leading = (0xFF00u >> (extra + 1)) & 0xFF;
+      writer.put(leading | static_cast<uint32_t>(value >> (6 * extra)), 8);
+      for (int i = extra - 1; i >= 0; --i)
+      {
+        writer.put(0x80 | static_cast<uint32_t>((value >> (6 * i)) & 0x3F), 8);
+      }
+    }
+
+    // --- Residual coding ---
+
+    struct RiceChoice
+    {
+      uint64_t bits = std::numeric_limits<uint64_t>::max();
+      int partitionOrder = 0;
+      int parameters[1 << MAX_PARTITION_ORDER] = {};
+    };
+
+    // Cheapest Rice parameter for n folded values summing to sum, using the
+    // usual estimate sum(u >> k) ~= sum >> k.
+    int bestParameter(uint64_t sum, size_t n, uint64_t &bits)
+    {
+      int k = 0;
+      while (k < MAX_RICE_PARAMETER && (static_cast<uint64_t>(n) << (k + 1)) < sum)
+      {
+        ++k;
+      }
+      bits = std::numeric_limits<uint64_t>::max();
+      int best = k;
+      for (int candidate = std::max(k - 1, 0); candidate <= std::min(k + 1, MAX_RICE_PARAMETER); ++candidate)
+      {
+        const uint64_t cost = n * static_cast<uint64_t>(candidate + 1) + (sum >> candidate);
+        if (cost < bits)
+        {
+          bits = cost;
+          best = candidate;
+        }
+      }
+      return best;
+    }
+
+    // Picks the partition order and per-partition parameters for a residual
+    // covering samples [order, blockSize). Sums at the finest order are merged
+    // pairwise for the coarser ones.
+    void chooseRice(const int32_t *residual, size_t blockSize, int predictorOrder, RiceChoice &choice)
+    {
+      int maxOrder = 0;
+      while (maxOrder < MAX_PARTITION_ORDER && (blockSize % (size_t{2} << maxOrder)) == 0 &&
+             (blockSize >> (maxOrder + 1)) > static_cast<size_t>(predictorOrder))
+      {
+        ++maxOrder;
+      }
+
+      uint64_t sums[1 << MAX_PARTITION_ORDER];
+      const size_t finest = size_t{1} << maxOrder;
+      const size_t partitionSize = blockSize >> maxOrder;
+      size_t r = 0;
+      for (size_t p = 0; p < finest; ++p)
+      {
+        const size_t end = (p + 1) * partitionSize - predictorOrder;
+        uint64_t sum = 0;
+        for (; r < end; ++r)
+        {
+          sum += (static_cast<uint32_t>(residual[r]) << 1) ^ static_cast<uint32_t>(residual[r] >> 31);
+        }
+        sums[p] = sum;
+      }
+
+      choice.bits = std::numeric_limits<uint64_t>::max();
+      for (int order = maxOrder; order >= 0; --order)
+      {
+        const size_t partitions = size_t{1} << order;
+        uint64_t total = 6; // method + partition order
+        int parameters[1 << MAX_PARTITION_ORDER];
+        for (size_t p = 0; p < partitions; ++p)
+        {
+          size_t n = blockSize >> order;
+          if (p == 0)
+          {
+            n -= predictorOrder;
+          }
+          uint64_t bits;
+          parameters[p] = bestParameter(sums[p], n, bits);
+          total += 4 + bits;
+        }
+        if (total < choice.bits)
+        {
+          choice.bits = total;
+          choice.partitionOrder = order;
+          std::copy(parameters, parameters + partitions, choice.parameters);
+        }
+        for (size_t p = 0; p < partitions / 2; ++p)
+        {
+          sums[p] = sums[2 * p] + sums[2 * p + 1];
+        }
+      }
+    }
+
+    void writeResidual(BitWriter &writer, const int32_t *residual, size_t blockSize, int predictorOrder, const RiceChoice &choice)
+    {
+      writer.put(0, 2); // 4-bit Rice parameters
+      writer.put(static_cast<uint32_t>(choice.partitionOrder), 4);
+      const size_t partitions = size_t{1} << choice.partitionOrder;
+      size_t r = 0;
+      for (size_t p = 0; p < partitions; ++p)
+      {
+        const int k = choice.parameters[p];
+        writer.put(static_cast<uint32_t>(k), 4);
+        const size_t end = (p + 1) * (blockSize >> choice.partitionOrder) - predictorOrder;
+        for (; r < end; ++r)
+        {
+          writer.putRice(residual[r], k);
+        }
+      }
+    }
+
+    // --- Prediction ---
+
+    void fixedResidual(const int32_t *x, size_t n, int order, int32_t *residual)
+    {
+      for (size_t i = order; i < n; ++i)
+      {
+        int32_t r;
+        switch (order)
+        {
+        case 0:
+          r = x[i];
+          break;
+        case 1:
+          r = x[i] - x[i - 1];
+          break;
+        case 2:
+          r = x[i] - 2 * x[i - 1] + x[i - 2];
+          break;
+        case 3:
+          r = x[i] - 3 * x[i - 1] + 3 * x[i - 2] - x[i - 3];
+          break;
+        default:
+          r = x[i] - 4 * x[i - 1] + 6 * x[i - 2] - 4 * x[i - 3] + x[i - 4];
+          break;
+        }
+        residual[i - order] = r;
+      }
+    }
+
+    // Levinson-Durbin on the autocorrelation; coefficients[m - 1] holds the
+    // order-m predictor x[n] ~ sum a[j] x[n - 1 - j]. Returns the highest
+    // order that could be computed.
+    int computeLpc(const double *autoc, int maxOrder, double coefficients[][MAX_LPC_ORDER])
+    {
+      double a[MAX_LPC_ORDER] = {};
+      double error = autoc[0];
+      for (int m = 0; m < maxOrder; ++m)
+      {
+        if (error <= 0)
+        {
+          return m;
+        }
+        double acc = autoc[m + 1];
+        for (int j = 0; j < m; ++j)
+        {
+          acc -= a[j] * autoc[m - j];
+        }
+        const double k = acc / error;
+        double next[MAX_LPC_ORDER];
+        for (int j = 0; j < m; ++j)
+        {
+          next[j] = a[j] - k * a[m - 1 - j];
+        }
+        next[m] = k;
+        std::copy(next, next + m + 1, a);
+        std::copy(a, a + m + 1, coefficients[m]);
+        error *= 1.0 - k * k;
+      }
+      return maxOrder;
+    }
+
+    // Rounds coefficients to QLP_PRECISION-bit integers with error feedback.
+    bool quantizeLpc(const double *coefficients, int order, int32_t *qlp, int &shift)
+    {
+      double cmax = 0;
+      for (int i = 0; i < order; ++i)
+      {
+        cmax = std::max(cmax, std::fabs(coefficients[i]));
+      }
+      if (cmax <= 0)
+      {
+        return false;
+      }
+      int log2cmax;
+      std::frexp(cmax, &log2cmax);
+      // Largest shift that keeps cmax inside a signed QLP_PRECISION-bit value.
+      shift = std::min(QLP_PRECISION - 1 - log2cmax, MAX_QLP_SHIFT);
+      if (shift < 0)
+      {
+        return false;
+      }
+      const int32_t maxCoefficient = (1 << (QLP_PRECISION - 1)) - 1;
+      const int32_t minCoefficient = -(1 << (QLP_PRECISION - 1));
+      double error = 0;
+      for (int i = 0; i < order; ++i)
+      {
+        error += coefficients[i] * (1 << shift);
+        const int32_t q = std::clamp(static_cast<int32_t>(std::lround(error)), minCoefficient, maxCoefficient);
+        error -= q;
+        qlp[i] = q;
+      }
+      return true;
+    }
+
+    bool lpcResidual(const int32_t *x, size_t n, const int32_t *qlp, int order, int shift, int32_t *residual)
+    {
+      for (size_t i = order; i < n; ++i)
+      {
+        int64_t prediction = 0;
+        for (int j = 0; j < order; ++j)
+        {
+          prediction += static_cast<int64_t>(qlp[j]) * x[i - 1 - j];
+        }
+        const int64_t r = x[i] - (prediction >> shift);
+        if (r > std::numeric_limits<int32_t>::max() / 2 || r < std::numeric_limits<int32_t>::min() / 2)
+        {
+          return false;
+        }
+        residual[i - order] = static_cast<int32_t>(r);
+      }
+      return true;
+    }
+  }
+
+  // --- Encoder ---
+
+  Encoder::Encoder(int sampleRate, int channels, int maxLpcOrder)
+      : sampleRate_(sampleRate), channels_(std::clamp(channels, 1, 8)),
+        maxLpcOrder_(std::clamp(maxLpcOrder, 0, MAX_LPC_ORDER))
+  {
+  }
+
+  void Encoder::begin(std::vector<uint8_t> &out, uint64_t totalFrames)
+  {
+    frameNumber_ = 0;
+    pending_.clear();
+
+    out.insert(out.end(), {'f', 'L', 'a', 'C'});
+    BitWriter writer(out);
+    writer.put(1, 1); // last metadata block
+    writer.put(0, 7); // STREAMINFO
+    writer.put(34, 24);
+    writer.put(static_cast<uint32_t>(BLOCK_SIZE), 16);
+    writer.put(static_cast<uint32_t>(BLOCK_SIZE), 16);
+    writer.put(0, 24); // frame sizes unknown
+    writer.put(0, 24);
+    writer.put(static_cast<uint32_t>(sampleRate_), 20);
+    writer.put(static_cast<uint32_t>(channels_ - 1), 3);
+    writer.put(BITS_PER_SAMPLE - 1, 5);
+    writer.put(static_cast<uint32_t>(totalFrames >> 32) & 0xF, 4);
+    writer.put(static_cast<uint32_t>(totalFrames), 32);
+    for (int i = 0; i < 4; ++i)
+    {
+      writer.put(0, 32); // no MD5
+    }
+  }
+
+  void Encoder::push(const int16_t *samples, size_t count, std::vector<uint8_t> &out)
+  {
+    const size_t blockSamples = BLOCK_SIZE * channels_;
+    if (!pending_.empty())
+    {
+      const size_t take = std::min(count, blockSamples - pending_.size());
+      pending_.insert(pending_.end(), samples, samples + take);
+      samples += take;
+      count -= take;
+      if (pending_.size() < blockSamples)
+      {
+        return;
+      }
+      encodeFrame(pending_.data(), BLOCK_SIZE, out);
+      pending_.clear();
+    }
+    while (count >= blockSamples)
+    {
+      encodeFrame(samples, BLOCK_SIZE, out);
+      samples += blockSamples;
+      count -= blockSamples;
+    }
+    pending_.insert(pending_.end(), samples, samples + count);
+  }
+
+  void Encoder::finish(std::vector<uint8_t> &out)
+  {
+    const size_t frames = pending_.size() / channels_;
+    if (frames > 0)
+    {
+      encodeFrame(pending_.data(), frames, out);
+    }
+    pending_.clear();
+  }
+
+  void Encoder::encodeFrame(const int16_t *samples, size_t frames, std::vector<uint8_t> &out)
+  {
+    const size_t frameStart = out.size();
+    BitWriter writer(out);
+
+    writer.put(0x3FFE, 14); // sync
+    writer.put(0, 1);
+    writer.put(0, 1); // fixed block size
+    writer.put(7, 4); // block size - 1 follows in 16 bits
+    writer.put(0, 4); // sample rate from STREAMINFO
+    writer.put(static_cast<uint32_t>(channels_ - 1), 4);
+    writer.put(4, 3); // 16 bits per sample
+    writer.put(0, 1);
+    putCodedNumber(writer, frameNumber_++);
+    writer.put(static_cast<uint32_t>(frames - 1), 16);
+    out.push_back(crc8(out.data() + frameStart, out.size() - frameStart));
+
+    channel_.resize(frames);
+    residual_.resize(frames);
+    bestResidual_.resize(frames);
+    if (window_.size() != frames)
+    {
+      // Welch window for the autocorrelation.
+      window_.resize(frames);
+      const double half = (frames - 1) / 2.0;
+      for (size_t i = 0; i < frames; ++i)
+      {
+        const double t = half > 0 ? (i - half) / half : 0;
+        window_[i] = 1.0 - t * t;
+      }
+    }
+
+    for (int c = 0; c < channels_; ++c)
+    {
+      bool constant = true;
+      for (size_t i = 0; i < frames; ++i)
+      {
+        channel_[i] = samples[i * channels_ + c];
+        constant = constant && channel_[i] == channel_[0];
+      }
+
+      if (constant)
+      {
+        writer.put(SUBFRAME_CONSTANT << 1, 8);
+        writer.putSigned(channel_[0], BITS_PER_SAMPLE);
+        continue;
+      }
+
+      // Candidates: fixed orders, then LPC orders; keep the cheapest.
+      uint64_t bestBits = static_cast<uint64_t>(frames) * BITS_PER_SAMPLE; // verbatim
+      uint32_t bestType = SUBFRAME_VERBATIM;
+      int bestOrder = 0;
+      RiceChoice bestRice;
+      int32_t bestQlp[MAX_LPC_ORDER] = {};
+      int bestShift = 0;
+      RiceChoice rice;
+
+      for (int order = 0; order <= MAX_FIXED_ORDER && static_cast<size_t>(order) < frames; ++order)
+      {
+        fixedResidual(channel_.data(), frames, order, residual_.data());
+        chooseRice(residual_.data(), frames, order, rice);
+        const uint64_t bits = static_cast<uint64_t>(order) * BITS_PER_SAMPLE + rice.bits;
+        if (bits < bestBits)
+        {
+          bestBits = bits;
+          bestType = SUBFRAME_FIXED;
+          bestOrder = order;
+          bestRice = rice;
+          bestResidual_.swap(residual_);
+        }
+      }
+
+      const int maxLpc = std::min<int>(maxLpcOrder_, static_cast<int>(frames) - 1);
+      if (maxLpc > 0)
+      {
+        double autoc[MAX_LPC_ORDER + 1] = {};
+        for (int lag = 0; lag <= maxLpc; ++lag)
+        {
+          double sum = 0;
+          for (size_t i = lag; i < frames; ++i)
+          {
+            sum += channel_[i] * window_[i] * channel_[i - lag] * window_[i - lag];
+          }
+          autoc[lag] = sum;
+        }
+        double coefficients[MAX_LPC_ORDER][MAX_LPC_ORDER];
+        const int orders = computeLpc(autoc, maxLpc, coefficients);
+        for (int order = 1; order <= orders; ++order)
+        {
+          int32_t qlp[MAX_LPC_ORDER];
+          int shift;
+          if (!quantizeLpc(coefficients[order - 1], order, qlp, shift) ||
+              !lpcResidual(channel_.data(), frames, qlp, order, shift, residual_.data()))
+          {
+            continue;
+          }
+          chooseRice(residual_.data(), frames, order, rice);
+          const uint64_t bits = static_cast<uint64_t>(order) * (BITS_PER_SAMPLE + QLP_PRECISION) + 9 + rice.bits;
+          if (bits < bestBits)
+          {
+            bestBits = bits;
+            bestType = SUBFRAME_LPC;
+            bestOrder = order;
+            bestRice = rice;
+            std::copy(qlp, qlp + order, bestQlp);
+            bestShift = shift;
+            bestResidual_.swap(residual_);
+          }
+        }
+      }
+
+      switch (bestType)
+      {
+      case SUBFRAME_FIXED:
+        writer.put((SUBFRAME_FIXED | bestOrder) << 1, 8);
+        for (int i = 0; i < bestOrder; ++i)
+        {
+          writer.putSigned(channel_[i], BITS_PER_SAMPLE);
+        }
+        writeResidual(writer, bestResidual_.data(), frames, bestOrder, bestRice);
+        break;
+      case SUBFRAME_LPC:
+        writer.put((SUBFRAME_LPC | (bestOrder - 1)) << 1, 8);
+        for (int i = 0; i < bestOrder; ++i)
+        {
+          writer.putSigned(channel_[i], BITS_PER_SAMPLE);
+        }
+        writer.put(QLP_PRECISION - 1, 4);
+        writer.putSigned(bestShift, 5);
+        for (int i = 0; i < bestOrder; ++i)
+        {
+          writer.putSigned(bestQlp[i], QLP_PRECISION);
+        }
+        writeResidual(writer, bestResidual_.data(), frames, bestOrder, bestRice);
+        break;
+      default:
+        writer.put(SUBFRAME_VERBATIM << 1, 8);
+        for (size_t i = 0; i < frames; ++i)
+        {
+          writer.putSigned(channel_[i], BITS_PER_SAMPLE);
+        }
+        break;
+      }
+    }
+
+    writer.alignToByte();
+    const uint16_t crc = crc16(out.data() + frameStart, out.size() - frameStart);
+    out.push_back(static_cast<uint8_t>(crc >> 8));
+    out.push_back(static_cast<uint8_t>(crc));
+  }
+
+  void encode(const int16_t *samples, size_t count, int sampleRate, int channels, std::vector<uint8_t> &out)
+  {
+    Encoder encoder(sampleRate, channels);
+    encoder.begin(out, count / std::max(channels, 1));
+    encoder.push(samples, count, out);
+    encoder.finish(out);
+  }
+
+  // --- Decoder ---
+
+  bool Decoder::feed(const uint8_t *data, size_t size, std::vector<int16_t> &out)
+  {
+    if (state_ == State::Failed)
+    {
+      return false;
+    }
+    // Drop what earlier calls used up before growing the buffer.
+    if (consumed_ > 0)
+    {
+      pending_.erase(pending_.begin(), pending_.begin() + consumed_);
+      consumed_ = 0;
+    }
+    pending_.insert(pending_.end(), data, data + size);
+
+    while (true)
+    {
+      const Result result = state_ == State::Frames ? decodeFrame(out) : parseHeaders();
+      if (result == Result::Corrupt)
+      {
+        state_ = State::Failed;
+        return false;
+      }
+      if (result == Result::NeedMore)
+      {
+        if (pending_.size() - consumed_ > MAX_PENDING_BYTES)
+        {
+          LOG_ERROR("flac: no complete frame in {} bytes", pending_.size() - consumed_);
+          state_ = State::Failed;
+          return false;
+        }
+        return true;
+      }
+    }
+  }
+
+  Decoder::Result Decoder::parseHeaders()
+  {
+    const uint8_t *p = pending_.data() + consumed_;
+    const size_t available = pending_.size() - consumed_;
+
+    if (state_ == State::Marker)
+    {
+      if (available < 4)
+      {
+        return Result::NeedMore;
+      }
+      if (std::memcmp(p, "fLaC", 4) != 0)
+      {
+        LOG_ERROR("flac: missing stream marker");
+        return Result::Corrupt;
+      }
+      consumed_ += 4;
+      state_ = State::Metadata;
+      return Result::Done;
+    }
+
+    if (available < 4)
+    {
+      return Result::NeedMore;
+    }
+    const bool last = (p[0] & 0x80) != 0;
+    const int type = p[0] & 0x7F;
+    const size_t length = (static_cast<size_t>(p[1]) << 16) | (static_cast<size_t>(p[2]) << 8) | p[3];
+    if (available < 4 + length)
+    {
+      return Result::NeedMore;
+    }
+    if (type == 0)
+    {
+      if (length < 34)
+      {
+        LOG_ERROR("flac: STREAMINFO too short");
+        return Result::Corrupt;
+      }
+      BitReader info(p + 4, length);
+      info.get(16); // block sizes
+      info.get(16);
+      info.get(24); // frame sizes
+      info.get(24);
+      sampleRate_ = static_cast<int>(info.get(20));
+      channels_ = static_cast<int>(info.get(3)) + 1;
+      bitsPerSample_ = static_cast<int>(info.get(5)) + 1;
+    }
+    consumed_ += 4 + length;
+    if (last)
+    {
+      if (sampleRate_ == 0)
+      {
+        LOG_ERROR("flac: stream has no STREAMINFO");
+        return Result::Corrupt;
+      }
+      state_ = State::Frames;
+    }
+    return Result::Done;
+  }
+
+  Decoder::Result Decoder::decodeFrame(std::vector<int16_t> &out)
+  {
+    const uint8_t *frame = pending_.data() + consumed_;
+    const size_t available = pending_.size() - consumed_;
+    if (available < 2)
+    {
+      return Result::NeedMore;
+    }
+    BitReader in(frame, available);
+
+    if (in.get(14) != 0x3FFE || in.get(1) != 0)
+    {
+      LOG_ERROR("flac: lost frame sync");
+      return Result::Corrupt;
+    }
+    in.get(1); // blocking strategy
+    const uint32_t blockCode = in.get(4);
+    const uint32_t rateCode = in.get(4);
+    const uint32_t assignment = in.get(4);
+    const uint32_t sizeCode = in.get(3);
+    in.get(1);
+    if (!in.getCodedNumber() && !in.exhausted())
+    {
+      LOG_ERROR("flac: bad frame number");
+      return Result::Corrupt;
+    }
+
+    size_t blockSize = 0;
+    if (blockCode == 1)
+    {
+      blockSize = 192;
+    }
+    else if (blockCode >= 2 && blockCode <= 5)
+    {
+      blockSize = size_t{576} << (blockCode - 2);
+    }
+    else if (blockCode == 6)
+    {
+      blockSize = in.get(8) + 1;
+    }
+    else if (blockCode == 7)
+    {
+      blockSize = in.get(16) + 1;
+    }
+    else if (blockCode >= 8)
+    {
+      blockSize = size_t{256} << (blockCode - 8);
+    }
+    if (rateCode == 12)
+    {
+      in.get(8);
+    }
+    else if (rateCode == 13 || rateCode == 14)
+    {
+      in.get(16);
+    }
+
+    static const int SAMPLE_SIZES[8] = {0, 8, 12, 0, 16, 20, 24, 32};
+    const int bits = sizeCode == 0 ? bitsPerSample_ : SAMPLE_SIZES[sizeCode];
+    const int channels = assignment < 8 ? static_cast<int>(assignment) + 1 : 2;
+    if (in.exhausted())
+    {
+      return Result::NeedMore;
+    }
+    const size_t headerBytes = in.bytePosition();
+    if (blockSize == 0 || bits == 0 || assignment > 10 || rateCode == 15 || channels != channels_ ||
+        in.get(8) != crc8(frame, headerBytes))
+    {
+      if (in.exhausted())
+      {
+        return Result::NeedMore;
+      }
+      LOG_ERROR("flac: bad frame header");
+      return Result::Corrupt;
+    }
+
+    decoded_.resize(channels);
+    for (int c = 0; c < channels; ++c)
+    {
+      // The side channel carries one extra bit.
+      const bool side = (assignment == 8 && c == 1) || (assignment == 9 && c == 0) || (assignment == 10 && c == 1);
+      const int sampleBits = bits + (side ? 1 : 0);
+      std::vector<int32_t> &x = decoded_[c];
+      x.resize(blockSize);
+
+      in.get(1);
+      const uint32_t type = in.get(6);
+      int wasted = 0;
+      if (in.get(1))
+      {
+        wasted = static_cast<int>(in.getUnary()) + 1;
+      }
+      const int codedBits = sampleBits - wasted;
+
+      int order = 0;
+      int32_t qlp[32] = {};
+      int shift = 0;
+      int precision = 0;
+      bool lpc = false;
+      if (type == SUBFRAME_CONSTANT)
+      {
+        std::fill(x.begin(), x.end(), in.getSigned(codedBits));
+      }
+      else if (type == SUBFRAME_VERBATIM)
+      {
+        for (size_t i = 0; i < blockSize; ++i)
+        {
+          x[i] = in.getSigned(codedBits);
+        }
+      }
+      else if ((type & 0x38) == SUBFRAME_FIXED && (type & 7) <= MAX_FIXED_ORDER)
+      {
+        order = static_cast<int>(type & 7);
+      }
+      else if (type & SUBFRAME_LPC)
+      {
+        order = static_cast<int>(type & 0x1F) + 1;
+        lpc = true;
+      }
+      else
+      {
+        LOG_ERROR("flac: reserved subframe type {}", type);
+        return Result::Corrupt;
+      }
+
+      if (order > 0 || type == SUBFRAME_FIXED)
+      {
+        if (static_cast<size_t>(order) > blockSize)
+        {
+          LOG_ERROR("flac: predictor order {} exceeds block size", order);
+          return Result::Corrupt;
+        }
+        for (int i = 0; i < order; ++i)
+        {
+          x[i] = in.getSigned(codedBits);
+        }
+        if (lpc)
+        {
+          precision = static_cast<int>(in.get(4)) + 1;
+          shift = in.getSigned(5);
+          if (precision == 16 || shift < 0)
+          {
+            LOG_ERROR("flac: unsupported LPC precision or shift");
+            return Result::Corrupt;
+          }
+          for (int i = 0; i < order; ++i)
+          {
+            qlp[i] = in.getSigned(precision);
+          }
+        }
+
+        // Residual straight into x[order..], predicted in place below.
+        const uint32_t method = in.get(2);
+        if (method > 1)
+        {
+          LOG_ERROR("flac: reserved residual coding method");
+          return Result::Corrupt;
+        }
+        const int parameterBits = method == 0 ? 4 : 5;
+        const uint32_t escape = method == 0 ? 15 : 31;
+        const int partitionOrder = static_cast<int>(in.get(4));
+        const size_t partitions = size_t{1} << partitionOrder;
+        const size_t partitionSize = blockSize >> partitionOrder;
+        if ((partitionSize << partitionOrder) != blockSize || partitionSize < static_cast<size_t>(order))
+        {
+          if (in.exhausted())
+          {
+            return Result::NeedMore;
+          }
+          LOG_ERROR("flac: bad residual partitioning");
+          return Result::Corrupt;
+        }
+        size_t i = order;
+        for (size_t p = 0; p < partitions && !in.exhausted(); ++p)
+        {
+          const size_t end = (p + 1) * partitionSize;
+          const uint32_t parameter = in.get(parameterBits);
+          if (parameter == escape)
+          {
+            const int rawBits = static_cast<int>(in.get(5));
+            for (; i < end; ++i)
+            {
+              x[i] = in.getSigned(rawBits);
+            }
+          }
+          else
+          {
+            for (; i < end && !in.exhausted(); ++i)
+            {
+              x[i] = in.getRice(static_cast<int>(parameter));
+            }
+          }
+        }
+        if (in.exhausted())
+        {
+          return Result::NeedMore;
+        }
+
+        if (lpc)
+        {
+          for (size_t n = order; n < blockSize; ++n)
+          {
+            int64_t prediction = 0;
+            for (int j = 0; j < order; ++j)
+            {
+              prediction += static_cast<int64_t>(qlp[j]) * x[n - 1 - j];
+            }
+            x[n] += static_cast<int32_t>(prediction >> shift);
+          }
+        }
+        else
+        {
+          for (size_t n = order; n < blockSize; ++n)
+          {
+            switch (order)
+            {
+            case 1:
+              x[n] += x[n - 1];
+              break;
+            case 2:
+              x[n] += 2 * x[n - 1] - x[n - 2];
+              break;
+            case 3:
+              x[n] += 3 * x[n - 1] - 3 * x[n - 2] + x[n - 3];
+              break;
+            case 4:
+              x[n] += 4 * x[n - 1] - 6 * x[n - 2] + 4 * x[n - 3] - x[n - 4];
+              break;
+            default:
+              break;
+            }
+          }
+        }
+      }
+
+      if (in.exhausted())
+      {
+        return Result::NeedMore;
+      }
+      if (wasted > 0)
+      {
+        for (auto &v : x)
+        {
+          v = static_cast<int32_t>(static_cast<uint32_t>(v) << wasted);
+        }
+      }
+    }
+
+    in.alignToByte();
+    const size_t bodyBytes = in.bytePosition();
+    const uint32_t crc = in.get(16);
+    if (in.exhausted())
+    {
+      return Result::NeedMore;
+    }
+    if (crc != crc16(frame, bodyBytes))
+    {
+      LOG_ERROR("flac: frame CRC mismatch");
+      return Result::Corrupt;
+    }
+    consumed_ += bodyBytes + 2;
+
+    // Undo stereo decorrelation, then interleave as int16.
+    if (assignment == 8)
+    {
+      for (size_t i = 0; i < blockSize; ++i)
+      {
+        decoded_[1][i] = decoded_[0][i] - decoded_[1][i];
+      }
+    }
+    else if (assignment == 9)
+    {
+      for (size_t i = 0; i < blockSize; ++i)
+      {
+        decoded_[0][i] += decoded_[1][i];
+      }
+    }
+    else if (assignment == 10)
+    {
+      for (size_t i = 0; i < blockSize; ++i)
+      {
+        const int32_t side = decoded_[1][i];
+        const int32_t mid = static_cast<int32_t>((static_cast<uint32_t>(decoded_[0][i]) << 1) | (side & 1));
+        decoded_[0][i] = (mid + side) >> 1;
+        decoded_[1][i] = (mid - side) >> 1;
+      }
+    }
+
+    const size_t base = out.size();
+    out.resize(base + blockSize * channels);
+    for (int c = 0; c < channels; ++c)
+    {
+      const std::vector<int32_t> &x = decoded_[c];
+      for (size_t i = 0; i < blockSize; ++i)
+      {
+        const int32_t v = bits >= 16 ? x[i] >> (bits - 16) : x[i] * (1 << (16 - bits));
+        out[base + i * channels + c] = static_cast<int16_t>(v);
+      }
+    }
+    return Result::Done;
+  }
+}
@@ -0,0 +1,141 @@
+#include "healthMonitor.hpp"
+#include "AppLogger.hpp"
+#include "metrics.hpp"
+#include <algorithm>
+#include <chrono>
+
+HealthMonitor::HealthMonitor(const std::string &host, int port, const std::string &path,
+                             const std::string &authToken, const HealthMonitorConfig &config)
+    : cli_(host, port), path_(path), config_(config), rng_(std::random_device{}())
+{
+  cli_.set_default_headers({{"X-Auth", authToken}});
+  cli_.set_keep_alive(true);
+  cli_.set_tcp_nodelay(true);
+  const auto timeout = std::chrono::milliseconds(config_.timeoutMs);
+  cli_.set_connection_timeout(timeout);
+  cli_.set_read_timeout(timeout);
+  cli_.set_write_timeout(timeout);
+}
+
+HealthMonitor::~HealthMonitor()
+{
+  stop();
+}
+
+void HealthMonitor::start(TransitionCallback onTransition)
+{
+  onTransition_ = std::move(onTransition);
+  thread_ = std::thread(&HealthMonitor::run, this);
+}
+
+void HealthMonitor::stop()
+{
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stopping_ = true;
+  }
+  wake_.notify_one();
+  cli_.stop(); // abandons a probe in flight
+  if (thread_.joinable())
+  {
+    thread_.join();
+  }
+}
+
+void HealthMonitor::probeNow()
+{
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    probeRequested_ = true;
+  }
+  wake_.notify_one();
+}
+
+const char *HealthMonitor::stateName(OrchestratorHealth state)
+{
+  switch (state)
+  {
+  case OrchestratorHealth::Up:
+    return "up";
+  case OrchestratorHealth::Down:
+    return "down";
+  default:
+    return "unknown";
+  }
+}
+
+bool HealthMonitor::probe()
+{
+  auto res = cli_.Get(path_);
+  if (res && res->status == 200)
+  {
+    return true;
+  }
+  Metrics::getInstance().increment(Metrics::Counter::HealthProbeFailures);
+  if (res)
+  {
+    LOG_DEBUG("HealthMonitor: probe returned status {}", res->status);
+  }
+  else
+  {
+    LOG_DEBUG("HealthMonitor: probe failed: {}", httplib::to_string(res.error()));
+  }
+  return false;
+}
+
+// Full jitter over an exponentially growing window, so clients that lost the
+// orchestrator together do not all come back at the same instant.
+int HealthMonitor::backoffMs(int failures)
+{
+  const int shift = std::min(failures - 1, 16);
+  const int window = static_cast<int>(std::min<int64_t>(static_cast<int64_t>(config_.minBackoffMs) << shift, config_.maxBackoffMs));
+  std::uniform_int_distribution<int> jitter(0, window);
+  return jitter(rng_);
+}
+
+void HealthMonitor::run()
+{
+  int failures = 0;
+  while (true)
+  {
+    const bool ok = probe();
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (stopping_)
+      {
+        return;
+      }
+    }
+    failures = ok ? 0 : failures + 1;
+
+    const OrchestratorHealth previous = state();
+    OrchestratorHealth next = previous;
+    if (ok)
+    {
+      next = OrchestratorHealth::Up;
+    }
+    else if (previous != OrchestratorHealth::Up || failures >= config_.failuresToDown)
+    {
+      next = OrchestratorHealth::Down;
+    }
+    if (next != previous)
+    {
+      state_.store(next, std::memory_order_release);
+      LOG_INFO("HealthMonitor: orchestrator {} -> {}", stateName(previous), stateName(next));
+      if (onTransition_)
+      {
+        onTransition_(previous, next);
+      }
+    }
+
+    const int delayMs = failures == 0 ? config_.intervalMs : backoffMs(failures);
+    std::unique_lock<std::mutex> lock(mutex_);
+    wake_.wait_for(lock, std::chrono::milliseconds(delayMs), [this]
+                   { return stopping_ || probeRequested_; });
+    if (stopping_)
+    {
+      return;
+    }
+    probeRequested_ = false;
+  }
+}
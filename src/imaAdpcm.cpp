@@ -0,0 +1,183 @@
+#include "imaAdpcm.hpp"
+#include <algorithm>
+#include <cstring>
+
+namespace ima
+{
+  namespace
+  {
+    const int STEPS[89] = {
+        7, 8, 9, 10, 11, 12, 13, 14, 16, 17, 19, 21, 23, 25, 28, 31, 34, 37, 41, 45, 50, 55, 60, 66, 73, 80, 88, 97,
+        107, 118, 130, 143, 157, 173, 190, 209, 230, 253, 279, 307, 337, 371, 408, 449, 494, 544, 598, 658, 724, 796,
+        876, 963, 1060, 1166, 1282, 1411, 1552, 1707, 1878, 2066, 2272, 2499, 2749, 3024, 3327, 3660, 4026, 4428,
+        4871, 5358, 5894, 6484, 7132, 7845, 8630, 9493, 10442, 11487, 12635, 13899, 15289, 16818, 18500, 20350,
+        22385, 24623, 27086, 29794, 32767};
+    const int INDEX_ADJUST[16] = {-1, -1, -1, -1, 2, 4, 6, 8, -1, -1, -1, -1, 2, 4, 6, 8};
+
+    struct Channel
+    {
+      int predictor = 0;
+      int index = 0;
+
+      int16_t decode(uint8_t nibble)
+      {
+        const int step = STEPS[index];
+        int diff = step >> 3;
+        if (nibble & 1)
+        {
+          diff += step >> 2;
+        }
+        if (nibble & 2)
+        {
+          diff += step >> 1;
+        }
+        if (nibble & 4)
+        {
+          diff += step;
+        }
+        predictor = std::clamp(predictor + ((nibble & 8) ? -diff : diff), -32768, 32767);
+        index = std::clamp(index + INDEX_ADJUST[nibble], 0, 88);
+        return static_cast<int16_t>(predictor);
+      }
+
+      // Picks the nibble whose reconstruction is closest to sample, then
+      // tracks the decoder's state.
+      uint8_t encode(int sample)
+      {
+        int step = STEPS[index];
+        int diff = sample - predictor;
+        uint8_t nibble = 0;
+        if (diff < 0)
+        {
+          nibble = 8;
+          diff = -diff;
+        }
+        for (uint8_t bit = 4; bit > 0; bit >>= 1)
+        {
+          if (diff >= step)
+          {
+            nibble |= bit;
+            diff -= step;
+          }
+          step >>= 1;
+        }
+        decode(nibble);
+        return nibble;
+      }
+    };
+
+    void putU16(std::vector<uint8_t> &out, uint32_t v)
+    {
+      out.push_back(static_cast<uint8_t>(v));
+      out.push_back(static_cast<uint8_t>(v >> 8));
+    }
+
+    void putU32(std::vector<uint8_t> &out, uint32_t v)
+    {
+      putU16(out, v & 0xFFFF);
+      putU16(out, v >> 16);
+    }
+  }
+
+  size_t samplesPerBlock(size_t blockAlign, int channels)
+  {
+    const size_t header = 4 * static_cast<size_t>(channels);
+    return blockAlign > header ? 1 + (blockAlign - header) * 2 / channels : 0;
+  }
+
+  // After the per-channel headers come 4-byte groups per channel,
+  // interleaved, of eight nibbles each, low nibble first.
+  void decodeBlock(const uint8_t *block, size_t blockAlign, int channels, std::vector<int16_t> &out)
+  {
+    const size_t header = 4 * static_cast<size_t>(channels);
+    const size_t groups = (blockAlign - header) / header;
+    const size_t base = out.size();
+    out.resize(base + (1 + 8 * groups) * channels);
+    for (int c = 0; c < channels; ++c)
+    {
+      Channel state;
+      int16_t first;
+      std::memcpy(&first, block + 4 * c, sizeof(first));
+      state.predictor = first;
+      state.index = std::min<int>(block[4 * c + 2], 88);
+      int16_t *dst = out.data() + base + c;
+      *dst = first;
+      dst += channels;
+      for (size_t g = 0; g < groups; ++g)
+      {
+        const uint8_t *bytes = block + header + (g * channels + c) * 4;
+        for (int b = 0; b < 4; ++b)
+        {
+          *dst = state.decode(bytes[b] & 0x0F);
+          dst += channels;
+          *dst = state.decode(bytes[b] >> 4);
+          dst += channels;
+        }
+      }
+    }
+  }
+
+  void encodeWav(const int16_t *samples, size_t count, int sampleRate, int channels, std::vector<uint8_t> &out)
+  {
+    const size_t blockAlign = BLOCK_ALIGN_PER_CHANNEL * channels;
+    const size_t perBlock = samplesPerBlock(blockAlign, channels);
+    const size_t frames = count / channels;
+    const size_t blocks = (frames + perBlock - 1) / perBlock;
+    const uint32_t dataSize = static_cast<uint32_t>(blocks * blockAlign);
+
+    out.reserve(out.size() + 60 + dataSize);
+    out.insert(out.end(), {'R', 'I', 'F', 'F'});
+    putU32(out, 52 + dataSize);
+    out.insert(out.end(), {'W', 'A', 'V', 'E', 'f', 'm', 't', ' '});
+    putU32(out, 20);
+    putU16(out, FORMAT_TAG);
+    putU16(out, channels);
+    putU32(out, sampleRate);
+    putU32(out, static_cast<uint32_t>(static_cast<uint64_t>(sampleRate) * blockAlign / perBlock));
+    putU16(out, static_cast<uint32_t>(blockAlign));
+    putU16(out, 4);
+    putU16(out, 2); // extra fmt bytes
+    putU16(out, static_cast<uint32_t>(perBlock));
+    out.insert(out.end(), {'f', 'a', 'c', 't'});
+    putU32(out, 4);
+    putU32(out, static_cast<uint32_t>(frames));
+    out.insert(out.end(), {'d', 'a', 't', 'a'});
+    putU32(out, dataSize);
+
+    std::vector<Channel> state(channels);
+    const size_t header = 4 * static_cast<size_t>(channels);
+    for (size_t b = 0; b < blocks; ++b)
+    {
+      const size_t start = b * perBlock;
+      // Frame i of this block, repeating the last real frame as padding.
+      auto sample = [&](size_t i, int c)
+      {
+        return samples[std::min(start + i, frames - 1) * channels + c];
+      };
+
+      const size_t blockStart = out.size();
+      out.resize(blockStart + blockAlign);
+      uint8_t *block = out.data() + blockStart;
+      for (int c = 0; c < channels; ++c)
+      {
+        const int16_t first = sample(0, c);
+        state[c].predictor = first;
+        std::memcpy(block + 4 * c, &first, sizeof(first));
+        block[4 * c + 2] = static_cast<uint8_t>(state[c].index);
+        block[4 * c + 3] = 0;
+        const size_t groups = (blockAlign - header) / header;
+        for (size_t g = 0; g < groups; ++g)
+        {
+          uint8_t *bytes = block + header + (g * channels + c) * 4;
+          for (int k = 0; k < 4; ++k)
+          {
+            const size_t i = 1 + g * 8 + k * 2;
+            const uint8_t low = state[c].encode(sample(i, c));
+            const uint8_t high = state[c].encode(sample(i + 1, c));
+            bytes[k] = static_cast<uint8_t>(low | (high << 4));
+          }
+        }
+      }
+    }
+  }
+}
@@ -0,0 +1,274 @@
+#include "latency.hpp"
+#include "AppLogger.hpp"
+#include <algorithm>
+#include <iomanip>
+#include <sstream>
+
+namespace
+{
+  constexpr auto REPORTER_POLL = std::chrono::milliseconds(250);
+
+  int64_t nowNs()
+  {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+  }
+
+  int floorLog2(uint64_t v)
+  {
+    return 63 - __builtin_clzll(v);
+  }
+}
+
+// --- LatencyHistogram ---
+
+int LatencyHistogram::bucketFor(uint64_t micros)
+{
+  micros = std::min<uint64_t>(micros, (uint64_t{1} << MAX_EXPONENT) - 1);
+  if (micros < 2 * SUB_BUCKETS)
+  {
+    return static_cast<int>(micros);
+  }
+  const int exponent = floorLog2(micros);
+  const int sub = static_cast<int>(micros >> (exponent - SUB_BUCKET_BITS)) - SUB_BUCKETS;
+  return 2 * SUB_BUCKETS + (exponent - SUB_BUCKET_BITS - 1) * SUB_BUCKETS + sub;
+}
+
+uint64_t LatencyHistogram::bucketMidpoint(int index)
+{
+  if (index < 2 * SUB_BUCKETS)
+  {
+    return static_cast<uint64_t>(index);
+  }
+  const int exponent = SUB_BUCKET_BITS + 1 + (index - 2 * SUB_BUCKETS) / SUB_BUCKETS;
+  const uint64_t sub = static_cast<uint64_t>((index - 2 * SUB_BUCKETS) % SUB_BUCKETS);
+  const int shift = exponent - SUB_BUCKET_BITS;
+  return ((SUB_BUCKETS + sub) << shift) + (uint64_t{1} << shift) / 2;
+}
+
+void LatencyHistogram::record(uint64_t micros)
+{
+  buckets_[bucketFor(micros)].fetch_add(1, std::memory_order_relaxed);
+  count_.fetch_add(1, std::memory_order_relaxed);
+  sum_.fetch_add(micros, std::memory_order_relaxed);
+  uint64_t seen = max_.load(std::memory_order_relaxed);
+  while (micros > seen && !max_.compare_exchange_weak(seen, micros, std::memory_order_relaxed))
+  {
+  }
+}
+
+void LatencyHistogram::reset()
+{
+  for (auto &bucket : buckets_)
+  {
+    bucket.store(0, std::memory_order_relaxed);
+  }
+  count_ = 0;
+  sum_ = 0;
+  max_ = 0;
+}
+
+double LatencyHistogram::mean() const
+{
+  const uint64_t n = count();
+  return n > 0 ? static_cast<double>(sum_.load(std::memory_order_relaxed)) / n : 0.0;
+}
+
+uint64_t LatencyHistogram::countAtOrBelow(uint64_t micros) const
+{
+  // The bucket holding micros counts only if micros is its top value.
+  const int last = bucketFor(micros + 1) - 1;
+  uint64_t total = 0;
+  for (int i = 0; i <= last; ++i)
+  {
+    total += buckets_[i].load(std::memory_order_relaxed);
+  }
+  return total;
+}
+
+uint64_t LatencyHistogram::percentile(double p) const
+{
+  const uint64_t n = count();
+  if (n == 0)
+  {
+    return 0;
+  }
+  const uint64_t target = std::max<uint64_t>(1, static_cast<uint64_t>(p / 100.0 * n + 0.5));
+  uint64_t seen = 0;
+  for (int i = 0; i < NUM_BUCKETS; ++i)
+  {
+    seen += buckets_[i].load(std::memory_order_relaxed);
+    if (seen >= target)
+    {
+      return std::min(bucketMidpoint(i), max());
+    }
+  }
+  return max();
+}
+
+// --- LatencyTracker ---
+
+LatencyTracker &LatencyTracker::getInstance()
+{
+  static LatencyTracker instance;
+  return instance;
+}
+
+LatencyTracker::~LatencyTracker()
+{
+  stopReporter();
+}
+
+const char *LatencyTracker::stageName(Stage stage)
+{
+  switch (stage)
+  {
+  case Stage::WakeDetected:
+    return "wake";
+  case Stage::SpeechOnset:
+    return "speech_onset";
+  case Stage::Endpoint:
+    return "endpoint";
+  case Stage::UploadStart:
+    return "upload_start";
+  case Stage::UploadEnd:
+    return "upload_end";
+  case Stage::FirstResponseByte:
+    return "first_response_byte";
+  case Stage::LastResponseByte:
+    return "last_response_byte";
+  case Stage::PlaybackStart:
+    return "playback_start";
+  case Stage::PlaybackEnd:
+    return "playback_end";
+  default:
+    return "unknown";
+  }
+}
+
+void LatencyTracker::beginInteraction()
+{
+  for (auto &m : marks_)
+  {
+    m.store(0, std::memory_order_relaxed);
+  }
+}
+
+void LatencyTracker::mark(Stage stage)
+{
+  int64_t expected = 0;
+  marks_[static_cast<size_t>(stage)].compare_exchange_strong(expected, nowNs(), std::memory_order_relaxed);
+}
+
+void LatencyTracker::markLatest(Stage stage)
+{
+  marks_[static_cast<size_t>(stage)].store(nowNs(), std::memory_order_relaxed);
+}
+
+void LatencyTracker::endInteraction()
+{
+  const int64_t wake = marks_[static_cast<size_t>(Stage::WakeDetected)].load(std::memory_order_relaxed);
+  if (wake == 0)
+  {
+    return;
+  }
+
+  int64_t previous = wake;
+  for (size_t i = 1; i < NUM_STAGES; ++i)
+  {
+    const int64_t t = marks_[i].load(std::memory_order_relaxed);
+    if (t == 0)
+    {
+      continue;
+    }
+    sinceWake_[i].record(static_cast<uint64_t>(std::max<int64_t>(t - wake, 0) / 1000));
+    sincePrevious_[i].record(static_cast<uint64_t>(std::max<int64_t>(t - previous, 0) / 1000));
+    previous = std::max(previous, t);
+  }
+  interactions_++;
+  beginInteraction();
+}
+
+void LatencyTracker::dump(std::ostream &out) const
+{
+  auto ms = [](uint64_t micros)
+  {
+    return micros / 1000.0;
+  };
+
+  out << "latency over " << interactions_.load() << " interactions (ms; since wake | since previous stage)\n";
+  out << std::left << std::setw(22) << "stage" << std::right
+      << std::setw(6) << "n"
+      << std::setw(10) << "p50" << std::setw(10) << "p95" << std::setw(10) << "p99" << std::setw(10) << "max"
+      << "  |"
+      << std::setw(10) << "p50" << std::setw(10) << "p95" << std::setw(10) << "p99" << "\n";
+  out << std::fixed << std::setprecision(1);
+  for (size_t i = 1; i < NUM_STAGES; ++i)
+  {
+    const LatencyHistogram &w = sinceWake_[i];
+    const LatencyHistogram &p = sincePrevious_[i];
+    out << std::left << std::setw(22) << stageName(static_cast<Stage>(i)) << std::right
+        << std::setw(6) << w.count()
+        << std::setw(10) << ms(w.percentile(50)) << std::setw(10) << ms(w.percentile(95))
+        << std::setw(10) << ms(w.percentile(99)) << std::setw(10) << ms(w.max())
+        << "  |"
+        << std::setw(10) << ms(p.percentile(50)) << std::setw(10) << ms(p.percentile(95))
+        << std::setw(10) << ms(p.percentile(99)) << "\n";
+  }
+}
+
+void LatencyTracker::dumpToLog() const
+{
+  std::ostringstream out;
+  dump(out);
+  std::istringstream lines(out.str());
+  std::string line;
+  while (std::getline(lines, line))
+  {
+    AppLogger::getInstance().info(line);
+  }
+}
+
+void LatencyTracker::startReporter(std::chrono::seconds interval)
+{
+  stopReporter();
+  {
+    std::lock_guard<std::mutex> lock(reporterMutex_);
+    stopReporter_ = false;
+  }
+
+  reporter_ = std::thread([this, interval]()
+                          {
+    auto nextDump = std::chrono::steady_clock::now() + interval;
+    std::unique_lock<std::mutex> lock(reporterMutex_);
+    while (!stopReporter_)
+    {
+      // Polled rather than notified: requestDump() may run in a signal handler.
+      reporterCv_.wait_for(lock, REPORTER_POLL);
+      const bool periodic = interval.count() > 0 && std::chrono::steady_clock::now() >= nextDump;
+      if (dumpRequested_.exchange(false) || periodic)
+      {
+        dumpToLog();
+        nextDump = std::chrono::steady_clock::now() + interval;
+      }
+    } });
+}
+
+void LatencyTracker::stopReporter()
+{
+  {
+    std::lock_guard<std::mutex> lock(reporterMutex_);
+    stopReporter_ = true;
+  }
+  reporterCv_.notify_all();
+  if (reporter_.joinable())
+  {
+    reporter_.join();
+  }
+}
+
+void LatencyTracker::requestDump()
+{
+  dumpRequested_.store(true, std::memory_order_relaxed);
+}
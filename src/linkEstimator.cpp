@@ -0,0 +1,50 @@
+#include "linkEstimator.hpp"
+#include "AppLogger.hpp"
+#include <algorithm>
+#include <cstddef>
+#include <sys/socket.h>
+#include <linux/tcp.h> // glibc's struct tcp_info predates the delivery rate fields
+#include <netinet/in.h>
+
+LinkEstimator::LinkEstimator(double alpha)
+    : alpha_(alpha)
+{
+}
+
+bool LinkEstimator::sample(int sock)
+{
+  tcp_info info{};
+  socklen_t len = sizeof(info);
+  if (sock < 0 || getsockopt(sock, IPPROTO_TCP, TCP_INFO, &info, &len) != 0 || info.tcpi_rtt == 0)
+  {
+    return false;
+  }
+
+  const double rtt = info.tcpi_rtt / 1e6;
+  rttSeconds_ = rttSeconds_ > 0 ? rttSeconds_ + alpha_ * (rtt - rttSeconds_) : rtt;
+
+  // Older kernels do not report a delivery rate; the length check covers
+  // structs truncated to what the kernel knows.
+  const size_t rateEnd = offsetof(tcp_info, tcpi_delivery_rate) + sizeof(info.tcpi_delivery_rate);
+  if (len < rateEnd || info.tcpi_delivery_rate == 0)
+  {
+    return true;
+  }
+  double rate = static_cast<double>(info.tcpi_delivery_rate);
+  // An app-limited sample only shows the link can go at least this fast.
+  if (info.tcpi_delivery_rate_app_limited)
+  {
+    rate = std::max(rate, bytesPerSecond_);
+  }
+  bytesPerSecond_ = bytesPerSecond_ > 0 ? bytesPerSecond_ + alpha_ * (rate - bytesPerSecond_) : rate;
+
+  LOG_TRACE("LinkEstimator: rtt {} ms, delivery {} kB/s{}; now {} ms, {} kB/s", rtt * 1e3,
+            info.tcpi_delivery_rate / 1e3, info.tcpi_delivery_rate_app_limited ? " (app limited)" : "",
+            rttSeconds_ * 1e3, bytesPerSecond_ / 1e3);
+  return true;
+}
+
+double LinkEstimator::transferSeconds(size_t bytes) const
+{
+  return rttSeconds_ / 2 + (bytesPerSecond_ > 0 ? bytes / bytesPerSecond_ : 0.0);
+}
@@ -0,0 +1,204 @@
+#include "logArchiver.hpp"
+#include "AppLogger.hpp"
+#include <algorithm>
+#include <vector>
+#include <fcntl.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace
+{
+  // ioprio_set(2) has no glibc wrapper.
+  constexpr int IOPRIO_WHO_PROCESS = 1;
+  constexpr int IOPRIO_CLASS_IDLE = 3;
+  constexpr int IOPRIO_CLASS_SHIFT = 13;
+
+  // Per-thread on Linux; the gzip children inherit both.
+  void lowerThreadPriority()
+  {
+    const auto tid = static_cast<id_t>(syscall(SYS_gettid));
+    setpriority(PRIO_PROCESS, tid, 19);
+    syscall(SYS_ioprio_set, IOPRIO_WHO_PROCESS, tid, IOPRIO_CLASS_IDLE << IOPRIO_CLASS_SHIFT);
+  }
+
+  bool gzipTo(const std::filesystem::path &source, const std::filesystem::path &target)
+  {
+    const int out = ::open(target.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (out < 0)
+    {
+      return false;
+    }
+    const pid_t pid = fork();
+    if (pid == 0)
+    {
+      dup2(out, STDOUT_FILENO);
+      execlp("gzip", "gzip", "-c", "--", source.c_str(), static_cast<char *>(nullptr));
+      _exit(127);
+    }
+    ::close(out);
+    int status = 0;
+    if (pid < 0 || waitpid(pid, &status, 0) != pid)
+    {
+      return false;
+    }
+    return WIFEXITED(status) && WEXITSTATUS(status) == 0;
+  }
+
+  // rename() when both paths share a filesystem, copy and delete when not.
+  bool moveFile(const std::filesystem::path &source, const std::filesystem::path &target)
+  {
+    std::error_code ec;
+    std::filesystem::rename(source, target, ec);
+    if (!ec)
+    {
+      return true;
+    }
+    ec.clear();
+    std::filesystem::copy_file(source, target, std::filesystem::copy_options::overwrite_existing, ec);
+    if (ec)
+    {
+      return false;
+    }
+    std::filesystem::remove(source, ec);
+    return true;
+  }
+}
+
+LogArchiver::~LogArchiver()
+{
+  stop();
+}
+
+void LogArchiver::configure(const LogRotation &rotation, const std::string &activeName)
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  rotation_ = rotation;
+  activeName_ = activeName;
+  if (!thread_.joinable() && !stopping_)
+  {
+    thread_ = std::thread(&LogArchiver::run, this);
+  }
+}
+
+void LogArchiver::submit(const std::filesystem::path &rotated)
+{
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    pending_.push_back(rotated);
+  }
+  wake_.notify_one();
+}
+
+void LogArchiver::stop()
+{
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stopping_ = true;
+  }
+  wake_.notify_one();
+  if (thread_.joinable())
+  {
+    thread_.join();
+  }
+}
+
+void LogArchiver::run()
+{
+  lowerThreadPriority();
+
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (true)
+  {
+    wake_.wait(lock, [this]
+               { return stopping_ || !pending_.empty(); });
+    if (pending_.empty())
+    {
+      return;
+    }
+    const std::filesystem::path rotated = pending_.front();
+    pending_.pop_front();
+    const LogRotation rotation = rotation_;
+    lock.unlock();
+
+    if (archive(rotated, rotation))
+    {
+      prune(rotation.directory.empty() ? rotated.parent_path() : std::filesystem::path(rotation.directory), rotation);
+    }
+
+    lock.lock();
+  }
+}
+
+bool LogArchiver::archive(const std::filesystem::path &rotated, const LogRotation &rotation)
+{
+  const std::filesystem::path directory = rotation.directory.empty() ? rotated.parent_path() : std::filesystem::path(rotation.directory);
+  std::error_code ec;
+  std::filesystem::create_directories(directory, ec);
+  if (ec)
+  {
+    LOG_ERROR("LogArchiver: could not create {}: {}", directory.string(), ec.message());
+    return false;
+  }
+
+  const std::filesystem::path target = directory / rotated.filename();
+  if (rotation.compress)
+  {
+    std::filesystem::path compressed = target;
+    compressed += ".gz";
+    std::filesystem::path partial = compressed;
+    partial += ".part";
+    if (gzipTo(rotated, partial))
+    {
+      std::filesystem::rename(partial, compressed, ec);
+      if (!ec)
+      {
+        std::filesystem::remove(rotated, ec);
+        return true;
+      }
+    }
+    std::filesystem::remove(partial, ec);
+    LOG_WARN("LogArchiver: could not gzip {}, keeping it uncompressed.", rotated.string());
+  }
+
+  if (rotated != target && !moveFile(rotated, target))
+  {
+    LOG_ERROR("LogArchiver: could not move {} to {}", rotated.string(), directory.string());
+    return false;
+  }
+  return true;
+}
+
+void LogArchiver::prune(const std::filesystem::path &directory, const LogRotation &rotation)
+{
+  std::string prefix;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    prefix = activeName_ + ".";
+  }
+
+  // Rotated names carry a sortable timestamp after the prefix.
+  std::vector<std::filesystem::path> archives;
+  std::error_code ec;
+  for (const auto &entry : std::filesystem::directory_iterator(directory, ec))
+  {
+    const std::string name = entry.path().filename().string();
+    if (entry.is_regular_file(ec) && name.compare(0, prefix.size(), prefix) == 0 &&
+        name.size() > prefix.size() && name.find(".part") == std::string::npos)
+    {
+      archives.push_back(entry.path());
+    }
+  }
+  if (archives.size() <= static_cast<size_t>(std::max(rotation.generations, 0)))
+  {
+    return;
+  }
+
+  std::sort(archives.begin(), archives.end());
+  const size_t excess = archives.size() - static_cast<size_t>(std::max(rotation.generations, 0));
+  for (size_t i = 0; i < excess; ++i)
+  {
+    std::filesystem::remove(archives[i], ec);
+  }
+}
@@ -0,0 +1,388 @@
+#include "logFormat.hpp"
+#include <algorithm>
+#include <cinttypes>
+#include <cstdio>
+#include <unordered_map>
+#include <utility>
+
+namespace logformat
+{
+  namespace
+  {
+    constexpr size_t MAX_FIELD = 0xFFFF;
+    const char *TRUNCATED_MARK = "...";
+
+    template <typename T>
+    void put(std::string &out, T value)
+    {
+      out.append(reinterpret_cast<const char *>(&value), sizeof(T));
+    }
+
+    void putString(std::string &out, const char *s, size_t length)
+    {
+      length = std::min(length, MAX_FIELD);
+      put<uint16_t>(out, static_cast<uint16_t>(length));
+      out.append(s, length);
+    }
+
+    // Bounds-checked cursor over the binary log.
+    class Reader
+    {
+    public:
+      Reader(const char *data, size_t size) : data_(data), size_(size), end_(size) {}
+
+      bool done() const { return pos_ >= size_; }
+      size_t position() const { return pos_; }
+      void seek(size_t pos) { pos_ = std::min(pos, size_); }
+
+      // Reads fail rather than run past end.
+      void setEnd(size_t end) { end_ = std::min(end, size_); }
+
+      template <typename T>
+      bool get(T &value)
+      {
+        if (pos_ > end_ || end_ - pos_ < sizeof(T))
+        {
+          return false;
+        }
+        std::memcpy(&value, data_ + pos_, sizeof(T));
+        pos_ += sizeof(T);
+        return true;
+      }
+
+      bool getString(const char *&s, uint16_t &length)
+      {
+        if (!get(length) || end_ - pos_ < length)
+        {
+          return false;
+        }
+        s = data_ + pos_;
+        pos_ += length;
+        return true;
+      }
+
+    private:
+      const char *data_;
+      size_t size_;
+      size_t end_;
+      size_t pos_ = 0;
+    };
+
+    std::string timestampFromNs(int64_t ns)
+    {
+      char buffer[32];
+      formatTimestamp(static_cast<std::time_t>(ns / 1000000000), buffer, sizeof(buffer));
+      return buffer;
+    }
+  }
+
+  const char *levelTag(Level level)
+  {
+    switch (level)
+    {
+    case Level::Trace:
+      return "[TRACE]";
+    case Level::Debug:
+      return "[DEBUG]";
+    case Level::Info:
+      return "[INFO]";
+    case Level::Warn:
+      return "[WARN]";
+    default:
+      return "[ERROR]";
+    }
+  }
+
+  bool parseLevel(const std::string &name, Level &level)
+  {
+    static const std::pair<const char *, Level> names[] = {
+        {"trace", Level::Trace}, {"debug", Level::Debug}, {"info", Level::Info}, {"warn", Level::Warn}, {"error", Level::Error}};
+    for (const auto &entry : names)
+    {
+      if (name == entry.first)
+      {
+        level = entry.second;
+        return true;
+      }
+    }
+    return false;
+  }
+
+  bool ArgWriter::reserve(size_t bytes)
+  {
+    if (full_)
+    {
+      return false;
+    }
+    // One byte is always kept back for the Truncated tag.
+    if (capacity_ - size_ < bytes + 1)
+    {
+      buffer_[size_++] = static_cast<char>(ArgType::Truncated);
+      full_ = true;
+      return false;
+    }
+    return true;
+  }
+
+  void ArgWriter::addString(const char *s, size_t length)
+  {
+    // Long strings are cut to fit rather than dropped, so the line stays readable.
+    const size_t header = 1 + sizeof(uint16_t);
+    if (!reserve(header + 1))
+    {
+      return;
+    }
+    const size_t kept = std::min({length, capacity_ - size_ - header - 1, MAX_FIELD});
+    const uint16_t storedLength = static_cast<uint16_t>(kept);
+    buffer_[size_] = static_cast<char>(ArgType::String);
+    std::memcpy(buffer_ + size_ + 1, &storedLength, sizeof(storedLength));
+    std::memcpy(buffer_ + size_ + header, s, kept);
+    size_ += header + kept;
+    if (kept < length)
+    {
+      buffer_[size_++] = static_cast<char>(ArgType::Truncated);
+      full_ = true;
+    }
+  }
+
+  void render(std::string &out, const char *format, const char *payload, size_t length)
+  {
+    Reader args(payload, length);
+    bool truncated = false;
+    for (const char *p = format; *p != '\0'; ++p)
+    {
+      if (p[0] != '{' || p[1] != '}')
+      {
+        out.push_back(*p);
+        continue;
+      }
+      ++p;
+      if (truncated)
+      {
+        continue;
+      }
+
+      uint8_t type = static_cast<uint8_t>(ArgType::Truncated);
+      args.get(type);
+      char number[32];
+      switch (static_cast<ArgType>(type))
+      {
+      case ArgType::Int:
+      {
+        int64_t v = 0;
+        args.get(v);
+        std::snprintf(number, sizeof(number), "%" PRId64, v);
+        out.append(number);
+        break;
+      }
+      case ArgType::Uint:
+      {
+        uint64_t v = 0;
+        args.get(v);
+        std::snprintf(number, sizeof(number), "%" PRIu64, v);
+        out.append(number);
+        break;
+      }
+      case ArgType::Double:
+      {
+        double v = 0;
+        args.get(v);
+        std::snprintf(number, sizeof(number), "%g", v);
+        out.append(number);
+        break;
+      }
+      case ArgType::String:
+      {
+        const char *s = nullptr;
+        uint16_t n = 0;
+        if (args.getString(s, n))
+        {
+          out.append(s, n);
+        }
+        break;
+      }
+      default:
+        truncated = true;
+        out.append(TRUNCATED_MARK);
+        break;
+      }
+    }
+
+    // A string cut short as the last argument leaves its marker behind.
+    uint8_t type = 0;
+    if (!truncated && args.get(type) && static_cast<ArgType>(type) == ArgType::Truncated)
+    {
+      out.append(TRUNCATED_MARK);
+    }
+  }
+
+  void formatTimestamp(std::time_t when, char *buffer, size_t size)
+  {
+    std::tm local_tm{};
+    localtime_r(&when, &local_tm);
+    std::strftime(buffer, size, "%Y-%m-%d %H:%M:%S", &local_tm);
+  }
+
+  void appendHeader(std::string &out, int64_t ns)
+  {
+    put(out, RecordType::Header);
+    out.append(MAGIC, sizeof(MAGIC));
+    put(out, VERSION);
+    put(out, ns);
+  }
+
+  void appendSite(std::string &out, uint32_t id, Level level, const char *file, uint32_t line, const char *format)
+  {
+    put(out, RecordType::Site);
+    put(out, id);
+    put(out, level);
+    put(out, line);
+    putString(out, file, std::strlen(file));
+    putString(out, format, std::strlen(format));
+  }
+
+  void appendEntry(std::string &out, uint32_t site, Level level, int64_t ns, const char *payload, size_t length)
+  {
+    put(out, RecordType::Entry);
+    put(out, site);
+    put(out, level);
+    put(out, ns);
+    putString(out, payload, length);
+  }
+
+  void appendEnd(std::string &out, int64_t ns)
+  {
+    put(out, RecordType::End);
+    put(out, ns);
+  }
+
+  bool decode(const char *data, size_t size, std::ostream &out, std::string &error)
+  {
+    Reader in(data, size);
+    std::unordered_map<uint32_t, std::string> sites; // id -> format
+    std::string line;
+    std::string problem;
+    error.clear();
+
+    // The next session header at or after from, or size if there is none.
+    std::string headerStart;
+    put(headerStart, RecordType::Header);
+    headerStart.append(MAGIC, sizeof(MAGIC));
+    put(headerStart, VERSION);
+    auto nextHeader = [&](size_t from)
+    {
+      return static_cast<size_t>(std::search(data + std::min(from, size), data + size,
+                                             headerStart.begin(), headerStart.end()) -
+                                 data);
+    };
+    size_t boundary = nextHeader(1);
+
+    while (!in.done())
+    {
+      const size_t recordStart = in.position();
+      if (recordStart >= boundary)
+      {
+        boundary = nextHeader(recordStart + 1);
+      }
+      // A session cut off by a crash leaves a partial record, whose length
+      // fields would otherwise reach into the next session.
+      in.setEnd(boundary);
+      RecordType type = RecordType::End;
+      bool ok = in.get(type);
+      problem = "malformed or truncated record";
+      switch (type)
+      {
+      case RecordType::Header:
+      {
+        char magic[sizeof(MAGIC)];
+        uint16_t version = 0;
+        int64_t ns = 0;
+        ok = ok && in.get(magic) && std::memcmp(magic, MAGIC, sizeof(MAGIC)) == 0 && in.get(version) && in.get(ns);
+        if (ok && version != VERSION)
+        {
+          problem = "unsupported log version " + std::to_string(version);
+          ok = false;
+        }
+        if (ok)
+        {
+          sites.clear();
+          out << "--- Log Started: " << timestampFromNs(ns) << " ---\n";
+        }
+        break;
+      }
+      case RecordType::Site:
+      {
+        uint32_t id = 0, lineNumber = 0;
+        Level level = Level::Info;
+        const char *file = nullptr, *format = nullptr;
+        uint16_t fileLength = 0, formatLength = 0;
+        ok = ok && in.get(id) && in.get(level) && in.get(lineNumber) &&
+             in.getString(file, fileLength) && in.getString(format, formatLength);
+        if (ok)
+        {
+          sites[id].assign(format, formatLength);
+        }
+        break;
+      }
+      case RecordType::Entry:
+      {
+        uint32_t site = 0;
+        Level level = Level::Info;
+        int64_t ns = 0;
+        const char *payload = nullptr;
+        uint16_t length = 0;
+        ok = ok && in.get(site) && in.get(level) && in.get(ns) && in.getString(payload, length);
+        if (!ok)
+        {
+          break;
+        }
+        line = timestampFromNs(ns);
+        line += ' ';
+        line += levelTag(level);
+        line += ' ';
+        if (site == 0)
+        {
+          line.append(payload, length);
+        }
+        else
+        {
+          auto it = sites.find(site);
+          if (it == sites.end())
+          {
+            problem = "entry refers to undeclared site " + std::to_string(site);
+            ok = false;
+            break;
+          }
+          render(line, it->second.c_str(), payload, length);
+        }
+        out << line << '\n';
+        break;
+      }
+      case RecordType::End:
+      {
+        int64_t ns = 0;
+        ok = ok && in.get(ns);
+        if (ok)
+        {
+          out << "--- Log Ended: " << timestampFromNs(ns) << " ---\n";
+        }
+        break;
+      }
+      default:
+        ok = false;
+        break;
+      }
+
+      // Later sessions in the same file still decode from their own header.
+      if (!ok)
+      {
+        const size_t resume = nextHeader(recordStart + 1);
+        const std::string range = "bytes " + std::to_string(recordStart) + "-" + std::to_string(resume);
+        out << "--- Damaged log, " << range << " skipped: " << problem << " ---\n";
+        error += (error.empty() ? "" : "; ") + range + ": " + problem;
+        in.seek(resume);
+      }
+    }
+    return error.empty();
+  }
+}
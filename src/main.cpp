@@ -1,10 +1,23 @@
 #include "recorder.hpp"
 #include "client.hpp"
 #include "AppLogger.hpp"
+#include "healthMonitor.hpp"
 #include "wakeword.hpp"
+#include "audioCapture.hpp"
+#include "wavFileSource.hpp"
+#include "portAudioSink.hpp"
+#include "audioChunkQueue.hpp"
+#include "streamingPlayer.hpp"
 #include "configLoader.hpp"
+#include "latency.hpp"
+#include "metrics.hpp"
+#include "promptCache.hpp"
+#include "notificationQueue.hpp"
 
 #include <filesystem>
+#include <csignal>
+#include <algorithm>
+#include <memory>
 #include <iostream>
 #include <string>
 #include <thread>
@@ -12,45 +25,40 @@
 #include <cstdlib>
 #include <stdexcept>
 
-void speak_error(const std::string &message)
-{
-  std::string command = "espeak-ng -v en-US+f3 -s 150 \"" + message + "\" 2>/dev/null";
-  AppLogger::getInstance().info("speaking error: \"" + message + "\"");
-  if (std::system(command.c_str()) != 0)
-  {
-    AppLogger::getInstance().error("failed to execute espeak-ng command. Is espeak-ng installed?");
-  }
-}
+// Everything speak_error is called with, rendered into the prompt pack at
+// startup. Anything missing here is rendered on first use instead.
+const std::vector<std::string> FIXED_PROMPTS = {
+    "Failed to create audio directory. Check permissions.",
+    "Orchestrator not available.",
+    "Orchestrator is back online.",
+    "Wake word system failed. Retrying.",
+    "Could not record your command.",
+    "Failed to send command. Retrying.",
+    "Failed to send command after multiple tries.",
+    "Failed to play response.",
+    "No audio response received.",
+    "Wake word detection loop stopped. Attempting restart.",
+    "An unexpected critical error occurred. Restarting systems.",
+};
 
-bool is_orchestrator_reachable(const std::string &host, int port, const std::string &healthPath, const std::string &authToken)
-{
-  AppLogger::getInstance().info("Checking orchestrator connectivity...");
-  httplib::Client temp_cli(host, port);
-  temp_cli.set_connection_timeout(std::chrono::seconds(3));
-  temp_cli.set_read_timeout(std::chrono::seconds(3));
-
-  httplib::Headers headers;
-  headers.emplace("X-Auth", authToken);
-  auto res = temp_cli.Get(healthPath.c_str(), headers);
+// Set once prompts can be played; before that, messages are spoken by
+// espeak-ng directly and the caller waits.
+NotificationQueue *notifications = nullptr;
 
-  if (res && res->status == 200)
+void speak_error(const std::string &message, NotificationQueue::Priority priority = NotificationQueue::Priority::Normal,
+                 const std::string &topic = {})
+{
+  if (notifications)
   {
-    AppLogger::getInstance().info("Orchestrator is reachable.");
-    return true;
+    notifications->notify(message, priority, topic);
+    return;
   }
-  else
+  Metrics::getInstance().increment(Metrics::Counter::SpeakErrors);
+  AppLogger::getInstance().info("speaking error: \"" + message + "\"");
+  std::string command = "espeak-ng -v en-US+f3 -s 150 \"" + message + "\" 2>/dev/null";
+  if (std::system(command.c_str()) != 0)
   {
-    std::string error_msg = "Orchestrator not reachable.";
-    if (res)
-    {
-      error_msg += " Status: " + std::to_string(res->status);
-    }
-    else
-    {
-      error_msg += " Error: " + httplib::to_string(res.error());
-    }
-    AppLogger::getInstance().error(error_msg);
-    return false;
+    AppLogger::getInstance().error("failed to execute espeak-ng command. Is espeak-ng installed?");
   }
 }
 
@@ -113,6 +121,46 @@ void saveDebugAudioFile(bool shouldSave, const std::vector<uint8_t> &wavData, co
   }
 }
 
+void onDumpSignal(int)
+{
+  LatencyTracker::getInstance().requestDump();
+}
+
+// Per-command timings. Speech and endpoint latency are measured in audio time,
+// so they are identical across replays of the same session.
+struct InteractionTiming
+{
+  int speechMs = 0;
+  int endpointLatencyMs = 0;
+  double responseMs = 0; // endpoint -> response fully received
+  double completeMs = 0; // endpoint -> playback finished
+};
+
+void logInteractionTiming(const InteractionTiming &t)
+{
+  LOG_INFO("Interaction timing: speech {} ms, endpoint latency {} ms, response {} ms, complete {} ms",
+           t.speechMs, t.endpointLatencyMs, static_cast<int>(t.responseMs), static_cast<int>(t.completeMs));
+}
+
+void logTimingSummary(const std::vector<InteractionTiming> &timings)
+{
+  if (timings.empty())
+  {
+    AppLogger::getInstance().info("Session summary: no completed interactions.");
+    return;
+  }
+  double response = 0, complete = 0, worstComplete = 0;
+  for (const auto &t : timings)
+  {
+    response += t.responseMs;
+    complete += t.completeMs;
+    worstComplete = std::max(worstComplete, t.completeMs);
+  }
+  LOG_INFO("Session summary: {} interactions, mean response {} ms, mean complete {} ms, worst complete {} ms",
+           timings.size(), static_cast<int>(response / timings.size()), static_cast<int>(complete / timings.size()),
+           static_cast<int>(worstComplete));
+}
+
 int main()
 {
   ConfigLoader config;
@@ -122,8 +170,24 @@ int main()
     return 1;
   }
 
-  AppLogger::getInstance().open(config.getString("logFile", "client.log"));
+  LogRotation rotation;
+  rotation.maxBytes = static_cast<uint64_t>(std::max(config.getInt("log.maxBytes", 0), 0));
+  rotation.maxAgeSeconds = config.getInt("log.maxAgeSeconds", 0);
+  rotation.generations = config.getInt("log.generations", 5);
+  rotation.compress = config.getBool("log.compress", true);
+  rotation.directory = config.getString("log.archiveDirectory", "");
+  AppLogger::getInstance().setRotation(rotation);
+  AppLogger::getInstance().open(config.getString("logFile", "client.log"),
+                                config.getString("logFormat", "text") == "binary" ? AppLogger::Format::Binary : AppLogger::Format::Text);
+  const std::string logLevelName = config.getString("logLevel", "info");
+  AppLogger::Level logLevel = AppLogger::Level::Info;
+  const bool knownLogLevel = logformat::parseLevel(logLevelName, logLevel);
+  AppLogger::setLevel(logLevel);
   AppLogger::getInstance().info("Client application starting...");
+  if (!knownLogLevel)
+  {
+    LOG_WARN("Unknown logLevel '{}', using info.", logLevelName);
+  }
 
   std::ios_base::sync_with_stdio(false);
   std::cin.tie(NULL);
@@ -139,40 +203,154 @@ int main()
     }
   }
 
+  // Stage latency histograms: dumped to the log every latencyDumpSeconds
+  // (0 = never) and on SIGUSR1.
+  LatencyTracker::getInstance().startReporter(std::chrono::seconds(config.getInt("metrics.latencyDumpSeconds", 300)));
+  std::signal(SIGUSR1, onDumpSignal);
+
+  // Counters and the same histograms for Prometheus, on loopback only (0 = off).
+  MetricsServer metricsServer;
+  const int metricsPort = config.getInt("metrics.port", 0);
+  if (metricsPort > 0)
+  {
+    metricsServer.start(metricsPort);
+  }
+
   MicrophoneRecorder recorder;
-  if (!recorder.isInitialized())
+
+  // One always-open source shared by the wake word detector and the recorder:
+  // the microphone, or a recorded session for headless, repeatable runs.
+  std::unique_ptr<AudioSource> source;
+  if (config.getString("audio.source", "portaudio") == "file")
   {
-    AppLogger::getInstance().error("PortAudio global initialization failed. This is critical.");
-    speak_error("Core audio system failed to initialize. Please check logs.");
-    return 1;
+    const std::string replayFile = config.getString("audio.replayFile", "");
+    auto file = std::make_unique<WavFileSource>(replayFile, config.getString("audio.replayMode", "realtime") != "fast");
+    if (!file->isLoaded() || file->getSampleRate() != 16000 || file->getChannels() != 1)
+    {
+      AppLogger::getInstance().error("Replay file must be a 16 kHz mono PCM16 WAV: " + replayFile);
+      return 1;
+    }
+    source = std::move(file);
   }
+  else
+  {
+    source = std::make_unique<AudioCapture>(16000, 1);
+  }
+  AudioSource &capture = *source;
 
   HttpClient http_client(
       config.getString("orchestrator.host", "127.0.0.1"),
       config.getInt("orchestrator.port", 9000),
       config.getString("orchestrator.authToken", ""));
+  http_client.setUploadFormat(HttpClient::parseUploadFormat(config.getString("orchestrator.uploadFormat", "multipart")));
+  http_client.setLossyMinSaving(std::chrono::milliseconds(config.getInt("orchestrator.lossyMinSavingMs", 150)));
+  http_client.setIdleTimeout(std::chrono::seconds(config.getInt("orchestrator.idleTimeoutSeconds", 30)));
+  const bool prewarmConnection = config.getBool("orchestrator.prewarm", true);
 
   PorcupineDetector porcupine_detector(
       config.getString("porcupine.accessKey", ""),
       config.getString("porcupine.modelPath", "models/porcupine_params.pv"),
       config.getString("porcupine.keywordPath", ""),
-      config.getFloat("porcupine.sensitivity", 0.5f));
+      config.getFloat("porcupine.sensitivity", 0.5f),
+      capture);
 
-  while (true)
+  recorder.setPreRollMs(config.getInt("audio.preRollMs", 300));
+  recorder.setVadEngine(config.getString("audio.vadEngine", "energy"));
+  if (config.getBool("audio.adaptiveThresholds", true))
   {
-    AppLogger::getInstance().info("--- New application cycle initiated ---");
+    porcupine_detector.getNoiseFloor().setMargins(config.getFloat("audio.vadStartMarginDb", 12.0f),
+                                                  config.getFloat("audio.vadStopMarginDb", 6.0f));
+    recorder.setNoiseFloorTracker(&porcupine_detector.getNoiseFloor());
+  }
+  // Runs on the detector's thread, which is also the one that records.
+  porcupine_detector.setIdleListener([&recorder](const int16_t *frame, size_t numSamples)
+                                     { recorder.observeIdle(frame, numSamples); });
+
+  EndpointerConfig endpointerConfig;
+  endpointerConfig.noSpeechTimeoutMs = config.getInt("endpoint.noSpeechTimeoutMs", endpointerConfig.noSpeechTimeoutMs);
+  endpointerConfig.hangoverMs = config.getInt("endpoint.hangoverMs", endpointerConfig.hangoverMs);
+  endpointerConfig.minHangoverMs = config.getInt("endpoint.minHangoverMs", endpointerConfig.minHangoverMs);
+  endpointerConfig.maxHangoverMs = config.getInt("endpoint.maxHangoverMs", endpointerConfig.maxHangoverMs);
+  endpointerConfig.longUtteranceMs = config.getInt("endpoint.longUtteranceMs", endpointerConfig.longUtteranceMs);
+  endpointerConfig.maxUtteranceMs = config.getInt("endpoint.maxUtteranceMs", endpointerConfig.maxUtteranceMs);
+  recorder.setEndpointerConfig(endpointerConfig);
+
+  // Streaming playback: the response is played while it downloads instead of
+  // being buffered whole first.
+  const bool streamPlayback = config.getBool("playback.streaming", false);
+  std::unique_ptr<AudioSink> sink;
+  if (config.getString("playback.sink", "portaudio") == "null")
+  {
+    sink = std::make_unique<NullSink>();
+  }
+  else
+  {
+    sink = std::make_unique<PortAudioSink>(config.getInt("playback.prebufferMs", 200));
+  }
+  // Responses and prompts take turns on one output stream: a prompt raised
+  // during a response plays once the response has finished.
+  SharedAudioSink output(*sink);
+  SharedAudioSink::Handle responseOutput(output);
+  SharedAudioSink::Handle promptOutput(output);
+  StreamingPlayer player(responseOutput);
+  std::vector<InteractionTiming> timings;
+
+  // Spoken prompts play from a pre-rendered pack, so they never spawn a
+  // synthesizer in the loop.
+  PromptCache promptCache(config.getString("prompts.pack", "prompts.pack"),
+                          config.getString("prompts.voice", "en-US+f3"),
+                          config.getInt("prompts.wordsPerMinute", 150));
+  promptCache.load(FIXED_PROMPTS);
+  PromptPlayer prompts(promptCache, promptOutput);
+
+  // Prompts are said on their own thread: nothing below waits on speech.
+  NotificationConfig notificationConfig;
+  notificationConfig.maxQueued = static_cast<size_t>(std::max(config.getInt("notifications.maxQueued", 8), 1));
+  notificationConfig.repeatInterval = std::chrono::milliseconds(config.getInt("notifications.repeatIntervalMs", 10000));
+  NotificationQueue notificationQueue([&prompts](const std::string &message)
+                                      {
+    Metrics::getInstance().increment(Metrics::Counter::SpeakErrors);
+    AppLogger::getInstance().info("speaking error: \"" + message + "\"");
+    return prompts.say(message); },
+                                      notificationConfig);
+  notificationQueue.start();
+  notifications = &notificationQueue;
+  if (streamPlayback)
+  {
+    http_client.setResponseReceiver([&player](const char *data, size_t len)
+                                    { return player.feed(data, len); });
+  }
 
-    while (!is_orchestrator_reachable(
-        config.getString("orchestrator.host", "127.0.0.1"),
-        config.getInt("orchestrator.port", 9000),
-        config.getString("orchestrator.healthCheckPath", "/health"),
-        config.getString("orchestrator.authToken", "")))
+  // Reachability is tracked in the background; the wake loop only reads the
+  // published state, and the user hears about changes, not every failed probe.
+  HealthMonitorConfig healthConfig;
+  healthConfig.intervalMs = config.getInt("health.intervalMs", healthConfig.intervalMs);
+  healthConfig.minBackoffMs = config.getInt("health.minBackoffMs", healthConfig.minBackoffMs);
+  healthConfig.maxBackoffMs = config.getInt("health.maxBackoffMs", healthConfig.maxBackoffMs);
+  healthConfig.timeoutMs = config.getInt("health.timeoutMs", healthConfig.timeoutMs);
+  healthConfig.failuresToDown = config.getInt("health.failuresToDown", healthConfig.failuresToDown);
+  HealthMonitor health(
+      config.getString("orchestrator.host", "127.0.0.1"),
+      config.getInt("orchestrator.port", 9000),
+      config.getString("orchestrator.healthCheckPath", "/health"),
+      config.getString("orchestrator.authToken", ""),
+      healthConfig);
+  health.start([](OrchestratorHealth from, OrchestratorHealth to)
+               {
+    if (to == OrchestratorHealth::Down)
     {
-      int delay = config.getInt("retry.networkDelaySeconds", 3);
-      AppLogger::getInstance().error("Orchestrator is not reachable. Retrying in " + std::to_string(delay) + " seconds...");
-      speak_error("Orchestrator not available. Retrying network.");
-      std::this_thread::sleep_for(std::chrono::seconds(delay));
+      LOG_ERROR("Orchestrator is not reachable.");
+      speak_error("Orchestrator not available.", NotificationQueue::Priority::High, "orchestrator");
     }
+    else if (from == OrchestratorHealth::Down)
+    {
+      AppLogger::getInstance().info("Orchestrator is reachable again.");
+      speak_error("Orchestrator is back online.", NotificationQueue::Priority::Normal, "orchestrator");
+    } });
+
+  while (true)
+  {
+    AppLogger::getInstance().info("--- New application cycle initiated ---");
 
     if (!porcupine_detector.isInitialized())
     {
@@ -188,8 +366,56 @@ int main()
       porcupine_detector.run([&]()
                              {
         AppLogger::getInstance().info("Wake word detected! Initiating command processing sequence.");
-        std::vector<int16_t> audioData = recorder.recordWithVAD();
+        if (health.state() == OrchestratorHealth::Down)
+        {
+          // Already announced when it went down; look again now someone is waiting.
+          LOG_WARN("Orchestrator is down. Ignoring wake word.");
+          health.probeNow();
+          return;
+        }
+        if (prewarmConnection)
+        {
+          http_client.prewarm(config.getString("orchestrator.healthCheckPath", "/health"));
+        }
+        const std::string processAudioPath = config.getString("orchestrator.processAudioPath", "/process-audio");
+        const bool streamUpload = config.getBool("orchestrator.streamUpload", false);
+
+        // In streaming mode the upload starts at speech onset and runs alongside
+        // the recorder; the buffered retry loop below is only the fallback.
+        player.reset();
+        AudioChunkQueue uploadQueue;
+        std::thread uploader;
+        bool stream_success = false;
+        RecordingCallbacks callbacks;
+        if (streamUpload)
+        {
+          callbacks.onSpeechStart = [&]()
+          {
+            AppLogger::getInstance().info("Speech onset. Opening streaming upload...");
+            uploader = std::thread([&]()
+                                   { stream_success = http_client.postOrchStreaming(processAudioPath, uploadQueue, 16000, 1); });
+          };
+          callbacks.onAudio = [&](const int16_t *samples, size_t count)
+          { uploadQueue.push(samples, count); };
+          callbacks.onEndpoint = [&]()
+          { uploadQueue.finish(); };
+        }
+
+        std::vector<int16_t> audioData = recorder.recordWithVAD(capture, callbacks);
+        const auto endpointTime = std::chrono::steady_clock::now();
+        uploadQueue.finish();
+        if (uploader.joinable())
+        {
+          uploader.join();
+        }
 
+        const EndpointStats &endpoint = recorder.lastEndpoint();
+        if (endpoint.reason == EndpointReason::NoSpeechTimeout)
+        {
+          // Most likely a false wake; go back to listening without a spoken error.
+          AppLogger::getInstance().info("No speech after wake word. Returning to wake word detection.");
+          return;
+        }
         if (audioData.empty())
         {
           AppLogger::getInstance().error("Recording failed or no speech detected. Skipping.");
@@ -197,18 +423,37 @@ int main()
           return;
         }
 
-        AppLogger::getInstance().info("Voice command recorded: " + std::to_string(audioData.size()) + " samples");
+        LOG_INFO("Voice command recorded: {} samples, endpoint {} after {} ms of speech, endpoint latency {} ms",
+                 audioData.size(), Endpointer::reasonName(endpoint.reason), endpoint.speechMs, endpoint.latencyMs);
         saveDebugAudioFile(config.getBool("saveDebugAudioFiles", false), audioData, config.getString("debug.outputWavFile", "audio/output.wav"));
 
-        AppLogger::getInstance().info("Sending recorded command audio to orchestrator...");
         int post_retries = 0;
-        bool post_success = false;
+        bool post_success = stream_success;
         const int maxPostRetries = config.getInt("retry.maxPostRetries", 5);
         const auto networkRetryDelay = std::chrono::seconds(config.getInt("retry.networkDelaySeconds", 3));
-        const std::string processAudioPath = config.getString("orchestrator.processAudioPath", "/process-audio");
 
-        while (post_retries < maxPostRetries)
+        if (stream_success)
+        {
+          AppLogger::getInstance().info("Command audio successfully streamed.");
+        }
+        else
         {
+          if (streamUpload)
+          {
+            AppLogger::getInstance().error("Streaming upload failed. Falling back to buffered upload.");
+          }
+          AppLogger::getInstance().info("Sending recorded command audio to orchestrator...");
+        }
+
+        while (!post_success && post_retries < maxPostRetries)
+        {
+          if (streamPlayback && player.bytesReceived() > 0)
+          {
+            // Part of the reply has already been played; a resend would repeat it.
+            AppLogger::getInstance().error("Response stream broke off during playback. Not retrying.");
+            break;
+          }
+
           if (http_client.postOrch(processAudioPath, audioData, 16000, 1))
           {
             post_success = true;
@@ -218,26 +463,70 @@ int main()
           else
           {
             post_retries++;
-            AppLogger::getInstance().error("Failed to post command audio (attempt " + std::to_string(post_retries) + "). Retrying...");
-            speak_error("Failed to send command. Retrying.");
-            std::this_thread::sleep_for(networkRetryDelay);
+            Metrics::getInstance().increment(Metrics::Counter::PostRetries);
+            LOG_ERROR("Failed to post command audio (attempt {}). Retrying...", post_retries);
+            speak_error("Failed to send command. Retrying.", NotificationQueue::Priority::Low);
+            if (post_retries < maxPostRetries)
+            {
+              std::this_thread::sleep_for(networkRetryDelay);
+            }
           }
         }
 
+        // The recording has been delivered (or given up on); return its buffer.
+        recorder.recycleRecording(std::move(audioData));
+
+        InteractionTiming timing;
+        timing.speechMs = endpoint.speechMs;
+        timing.endpointLatencyMs = endpoint.latencyMs;
+        timing.responseMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - endpointTime).count();
+        auto recordTiming = [&]()
+        {
+          timing.completeMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - endpointTime).count();
+          logInteractionTiming(timing);
+          timings.push_back(timing);
+        };
+
         if (!post_success)
         {
+          player.reset();
           AppLogger::getInstance().error("Maximum post retries reached. Command not sent.");
-          speak_error("Failed to send command after multiple tries.");
+          speak_error("Failed to send command after multiple tries.", NotificationQueue::Priority::High);
+          return;
+        }
+
+        if (streamPlayback)
+        {
+          // Playback began while the response was downloading; play out the tail.
+          if (!player.finish())
+          {
+            AppLogger::getInstance().error("Failed to play streamed response audio.");
+            speak_error("Failed to play response.");
+          }
+          else
+          {
+            AppLogger::getInstance().info("Streamed response audio played successfully.");
+          }
+          recordTiming();
+          AppLogger::getInstance().info("Command sequence completed.");
           return;
         }
 
         AppLogger::getInstance().info("Playing response audio...");
-        std::vector<uint8_t> responseAudio = http_client.getLastResponseAudio();
+        std::vector<uint8_t> responseAudio = http_client.takeLastResponseAudio();
 
         if (!responseAudio.empty())
         {
           saveDebugAudioFile(config.getBool("saveDebugAudioFiles", false), responseAudio, config.getString("debug.responseWavFile", "audio/response.wav"));
-          if (!recorder.playAudioData(responseAudio))
+          player.reset();
+          if (!player.feed(reinterpret_cast<const char *>(responseAudio.data()), responseAudio.size()))
+          {
+            // The decoder or the audio output has logged why.
+            LOG_ERROR("Response audio ({} bytes) could not be decoded or played.", responseAudio.size());
+            player.finish();
+            speak_error("Failed to play response.");
+          }
+          else if (!player.finish())
           {
             AppLogger::getInstance().error("Failed to play response audio.");
             speak_error("Failed to play response.");
@@ -246,21 +535,31 @@ int main()
           {
             AppLogger::getInstance().info("Response audio played successfully.");
           }
+          recordTiming();
         }
         else
         {
           AppLogger::getInstance().error("No response audio received from orchestrator.");
           speak_error("No audio response received.");
         }
+        http_client.recycleResponseBuffer(std::move(responseAudio));
         AppLogger::getInstance().info("Command sequence completed."); });
 
+      if (capture.endOfStream())
+      {
+        AppLogger::getInstance().info("Replay finished.");
+        logTimingSummary(timings);
+        LatencyTracker::getInstance().dumpToLog();
+        return 0;
+      }
       AppLogger::getInstance().error("PorcupineDetector.run() exited unexpectedly.");
       speak_error("Wake word detection loop stopped. Attempting restart.");
     }
     catch (const std::exception &e)
     {
       AppLogger::getInstance().error("Unhandled exception in main loop: " + std::string(e.what()));
-      speak_error("An unexpected critical error occurred. Restarting systems.");
+      player.reset(); // hand the output back, or the prompt below would wait for it
+      speak_error("An unexpected critical error occurred. Restarting systems.", NotificationQueue::Priority::High);
       std::this_thread::sleep_for(std::chrono::seconds(5));
     }
 
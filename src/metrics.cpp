@@ -0,0 +1,183 @@
+#include "metrics.hpp"
+#include "latency.hpp"
+#include "AppLogger.hpp"
+#include "httplib.h"
+#include <sstream>
+
+namespace
+{
+  struct CounterInfo
+  {
+    const char *name;
+    const char *labels;
+    const char *help;
+  };
+
+  // Indexed by Metrics::Counter. Counters sharing a name are one family
+  // split by label; HELP/TYPE are written for the first of each.
+  constexpr CounterInfo COUNTERS[] = {
+      {"sarah_wake_detections_total", "", "Wake words detected."},
+      {"sarah_vad_aborts_total", "", "Wake events that ended without a recorded command."},
+      {"sarah_post_retries_total", "", "Failed command uploads that were retried or given up on."},
+      {"sarah_http_errors_total", "class=\"4xx\"", "Orchestrator requests that did not return 200, by class."},
+      {"sarah_http_errors_total", "class=\"5xx\"", nullptr},
+      {"sarah_http_errors_total", "class=\"other\"", nullptr},
+      {"sarah_http_errors_total", "class=\"transport\"", nullptr},
+      {"sarah_http_requests_total", "", "Command uploads sent to the orchestrator."},
+      {"sarah_http_connections_opened_total", "", "TCP connections established to the orchestrator, including by prewarms."},
+      {"sarah_http_requests_reused_total", "", "Command uploads sent on an already open connection."},
+      {"sarah_bytes_sent_total", "", "Request body bytes sent to the orchestrator."},
+      {"sarah_bytes_received_total", "", "Response body bytes received from the orchestrator."},
+      {"sarah_audio_read_errors_total", "", "Audio source reads that failed or timed out."},
+      {"sarah_audio_reinits_total", "", "Wake word engine or audio stream re-initialisations."},
+      {"sarah_speak_errors_total", "", "Spoken error messages."},
+      {"sarah_health_probe_failures_total", "", "Orchestrator health probes that failed or did not return 200."},
+      {"sarah_uploads_total", "format=\"multipart\"", "Command uploads, by body encoding."},
+      {"sarah_uploads_total", "format=\"wav\"", nullptr},
+      {"sarah_uploads_total", "format=\"raw\"", nullptr},
+      {"sarah_uploads_total", "format=\"flac\"", nullptr},
+      {"sarah_uploads_total", "format=\"ima_adpcm\"", nullptr},
+      {"sarah_notifications_skipped_total", "reason=\"coalesced\"", "Spoken notifications not said, by reason."},
+      {"sarah_notifications_skipped_total", "reason=\"rate_limited\"", nullptr},
+      {"sarah_notifications_skipped_total", "reason=\"dropped\"", nullptr},
+  };
+  static_assert(sizeof(COUNTERS) / sizeof(COUNTERS[0]) == static_cast<size_t>(Metrics::Counter::Count),
+                "every counter needs a name");
+
+  // Indexed by Metrics::Gauge, grouped into families like COUNTERS.
+  constexpr CounterInfo GAUGES[] = {
+      {"sarah_link_rtt_seconds", "", "Smoothed round-trip time to the orchestrator, from the kernel's TCP estimate."},
+      {"sarah_link_upload_bytes_per_second", "", "Smoothed upload throughput to the orchestrator, from the kernel's delivery rate."},
+      {"sarah_upload_flac_size_ratio", "", "Smoothed FLAC body size as a fraction of the PCM it encodes."},
+      {"sarah_upload_expected_seconds", "format=\"wav\"", "Expected encode plus transfer time of the last command, by body encoding."},
+      {"sarah_upload_expected_seconds", "format=\"flac\"", nullptr},
+      {"sarah_upload_expected_seconds", "format=\"ima_adpcm\"", nullptr},
+      {"sarah_vad_noise_floor_dbfs", "", "Background noise floor estimated between commands, in dBFS."},
+      {"sarah_vad_start_threshold_dbfs", "", "Frame energy that starts a command, in dBFS."},
+      {"sarah_vad_stop_threshold_dbfs", "", "Frame energy below which a command counts as silence, in dBFS."},
+  };
+  static_assert(sizeof(GAUGES) / sizeof(GAUGES[0]) == static_cast<size_t>(Metrics::Gauge::Count),
+                "every gauge needs a name");
+
+  // Bucket bounds in seconds, chosen around the latencies a voice round trip sees.
+  constexpr double LATENCY_BUCKETS[] = {0.005, 0.01, 0.025, 0.05, 0.1, 0.25, 0.5, 1, 2.5, 5, 10, 30};
+
+  void writeHistogram(std::ostringstream &out, const char *stage, const char *since, const LatencyHistogram &h)
+  {
+    const std::string labels = std::string("stage=\"") + stage + "\",since=\"" + since + "\"";
+    for (double le : LATENCY_BUCKETS)
+    {
+      out << "sarah_stage_latency_seconds_bucket{" << labels << ",le=\"" << le << "\"} "
+          << h.countAtOrBelow(static_cast<uint64_t>(le * 1e6)) << "\n";
+    }
+    out << "sarah_stage_latency_seconds_bucket{" << labels << ",le=\"+Inf\"} " << h.count() << "\n";
+    out << "sarah_stage_latency_seconds_sum{" << labels << "} " << h.sum() / 1e6 << "\n";
+    out << "sarah_stage_latency_seconds_count{" << labels << "} " << h.count() << "\n";
+  }
+}
+
+Metrics &Metrics::getInstance()
+{
+  static Metrics instance;
+  return instance;
+}
+
+std::string Metrics::renderPrometheus() const
+{
+  std::ostringstream out;
+  for (size_t i = 0; i < static_cast<size_t>(Counter::Count); ++i)
+  {
+    const CounterInfo &info = COUNTERS[i];
+    if (info.help)
+    {
+      out << "# HELP " << info.name << " " << info.help << "\n";
+      out << "# TYPE " << info.name << " counter\n";
+    }
+    out << info.name;
+    if (info.labels[0] != '\0')
+    {
+      out << "{" << info.labels << "}";
+    }
+    out << " " << counters_[i].load(std::memory_order_relaxed) << "\n";
+  }
+
+  for (size_t i = 0; i < static_cast<size_t>(Gauge::Count); ++i)
+  {
+    const CounterInfo &info = GAUGES[i];
+    if (info.help)
+    {
+      out << "# HELP " << info.name << " " << info.help << "\n";
+      out << "# TYPE " << info.name << " gauge\n";
+    }
+    out << info.name;
+    if (info.labels[0] != '\0')
+    {
+      out << "{" << info.labels << "}";
+    }
+    out << " " << gauges_[i].load(std::memory_order_relaxed) << "\n";
+  }
+
+  const uint64_t requests = get(Counter::HttpRequests);
+  const uint64_t reused = get(Counter::HttpRequestsReused);
+  out << "# HELP sarah_http_connection_reuse_ratio Share of command uploads sent on an already open connection.\n";
+  out << "# TYPE sarah_http_connection_reuse_ratio gauge\n";
+  out << "sarah_http_connection_reuse_ratio "
+      << (requests > 0 ? static_cast<double>(reused) / requests : 0.0) << "\n";
+
+  out << "# HELP sarah_log_records_dropped_total Log records dropped because the logger queue was full.\n";
+  out << "# TYPE sarah_log_records_dropped_total counter\n";
+  out << "sarah_log_records_dropped_total " << AppLogger::getInstance().droppedRecords() << "\n";
+
+  const LatencyTracker &latency = LatencyTracker::getInstance();
+  out << "# HELP sarah_interactions_total Completed wake-to-reply interactions.\n";
+  out << "# TYPE sarah_interactions_total counter\n";
+  out << "sarah_interactions_total " << latency.interactions() << "\n";
+
+  out << "# HELP sarah_stage_latency_seconds Time at which each stage was reached, since the wake word or the previous stage.\n";
+  out << "# TYPE sarah_stage_latency_seconds histogram\n";
+  for (size_t i = 1; i < static_cast<size_t>(Stage::Count); ++i)
+  {
+    const Stage stage = static_cast<Stage>(i);
+    writeHistogram(out, LatencyTracker::stageName(stage), "wake", latency.sinceWake(stage));
+    writeHistogram(out, LatencyTracker::stageName(stage), "previous", latency.sincePrevious(stage));
+  }
+  return out.str();
+}
+
+// --- MetricsServer ---
+
+MetricsServer::MetricsServer()
+    : server_(std::make_unique<httplib::Server>())
+{
+  server_->Get("/metrics", [](const httplib::Request &, httplib::Response &res)
+               { res.set_content(Metrics::getInstance().renderPrometheus(), "text/plain; version=0.0.4"); });
+}
+
+MetricsServer::~MetricsServer()
+{
+  stop();
+}
+
+bool MetricsServer::start(int port)
+{
+  if (!server_->bind_to_port("127.0.0.1", port))
+  {
+    AppLogger::getInstance().error("MetricsServer: Could not bind 127.0.0.1:" + std::to_string(port));
+    return false;
+  }
+  thread_ = std::thread([this]()
+                        { server_->listen_after_bind(); });
+  // A stop() before the server is listening would otherwise hang.
+  server_->wait_until_ready();
+  AppLogger::getInstance().info("MetricsServer: Serving /metrics on 127.0.0.1:" + std::to_string(port));
+  return true;
+}
+
+void MetricsServer::stop()
+{
+  server_->stop();
+  if (thread_.joinable())
+  {
+    thread_.join();
+  }
+}
@@ -0,0 +1,187 @@
+#include "mockOrchestrator.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+
+namespace
+{
+  constexpr size_t WAV_HEADER_BYTES = 44;
+  constexpr size_t TRICKLE_CHUNK_BYTES = 1024;
+
+  void putU32(std::string &s, size_t at, uint32_t v)
+  {
+    std::memcpy(&s[at], &v, sizeof(v));
+  }
+
+  void putU16(std::string &s, size_t at, uint16_t v)
+  {
+    std::memcpy(&s[at], &v, sizeof(v));
+  }
+
+  // 16 kHz mono PCM16 WAV of exactly totalBytes, holding a quiet tone.
+  std::string makeResponseWav(size_t totalBytes)
+  {
+    totalBytes = std::max(totalBytes, WAV_HEADER_BYTES + 2);
+    const size_t dataBytes = (totalBytes - WAV_HEADER_BYTES) & ~static_cast<size_t>(1);
+
+    std::string wav(WAV_HEADER_BYTES + dataBytes, '\0');
+    std::memcpy(&wav[0], "RIFF", 4);
+    putU32(wav, 4, static_cast<uint32_t>(wav.size() - 8));
+    std::memcpy(&wav[8], "WAVEfmt ", 8);
+    putU32(wav, 16, 16);
+    putU16(wav, 20, 1);
+    putU16(wav, 22, 1);
+    putU32(wav, 24, 16000);
+    putU32(wav, 28, 32000);
+    putU16(wav, 32, 2);
+    putU16(wav, 34, 16);
+    std::memcpy(&wav[36], "data", 4);
+    putU32(wav, 40, static_cast<uint32_t>(dataBytes));
+
+    for (size_t i = 0; i < dataBytes / 2; ++i)
+    {
+      const int16_t s = static_cast<int16_t>(1000.0 * std::sin(2.0 * 3.14159265358979 * 440.0 * i / 16000.0));
+      std::memcpy(&wav[WAV_HEADER_BYTES + i * 2], &s, sizeof(s));
+    }
+    return wav;
+  }
+}
+
+MockOrchestrator::MockOrchestrator(const MockOrchestratorOptions &options)
+    : options_(options),
+      response_(makeResponseWav(options.responseBytes)),
+      rng_(options.seed)
+{
+  setupRoutes();
+}
+
+MockOrchestrator::~MockOrchestrator()
+{
+  stop();
+}
+
+bool MockOrchestrator::authorized(const httplib::Request &req, httplib::Response &res)
+{
+  if (options_.authToken.empty() || req.get_header_value("X-Auth") == options_.authToken)
+  {
+    return true;
+  }
+  rejectedAuth_++;
+  res.status = 401;
+  res.set_content("unauthorized", "text/plain");
+  return false;
+}
+
+MockOrchestrator::Fault MockOrchestrator::drawFault()
+{
+  std::lock_guard<std::mutex> lock(rngMutex_);
+  std::uniform_real_distribution<double> uniform(0.0, 1.0);
+  if (uniform(rng_) < options_.failRate)
+  {
+    return Fault::Fail;
+  }
+  if (uniform(rng_) < options_.resetRate)
+  {
+    return Fault::Reset;
+  }
+  if (uniform(rng_) < options_.trickleRate)
+  {
+    return Fault::Trickle;
+  }
+  return Fault::None;
+}
+
+void MockOrchestrator::setupRoutes()
+{
+  server_.Get("/health", [this](const httplib::Request &req, httplib::Response &res)
+              {
+    if (authorized(req, res))
+    {
+      res.set_content("ok", "text/plain");
+    } });
+
+  server_.Post("/process-audio", [this](const httplib::Request &req, httplib::Response &res)
+               {
+    requests_++;
+    bytesReceived_ += req.body.size();
+    if (!authorized(req, res))
+    {
+      return;
+    }
+
+    if (options_.latencyMs > 0)
+    {
+      std::this_thread::sleep_for(std::chrono::milliseconds(options_.latencyMs));
+    }
+
+    switch (drawFault())
+    {
+    case Fault::Fail:
+      injectedFailures_++;
+      res.status = 500;
+      res.set_content("injected failure", "text/plain");
+      return;
+
+    case Fault::Reset:
+      injectedResets_++;
+      // Returning false from the provider makes httplib drop the connection.
+      res.set_content_provider(response_.size(), "audio/wav",
+                               [this](size_t offset, size_t, httplib::DataSink &sink)
+                               {
+                                 if (offset > 0)
+                                 {
+                                   return false;
+                                 }
+                                 sink.write(response_.data(), response_.size() / 2);
+                                 return true;
+                               });
+      return;
+
+    case Fault::Trickle:
+    {
+      trickled_++;
+      const auto pause = std::chrono::microseconds(
+          1000000 * TRICKLE_CHUNK_BYTES / std::max<size_t>(options_.trickleBytesPerSecond, 1));
+      res.set_content_provider(response_.size(), "audio/wav",
+                               [this, pause](size_t offset, size_t length, httplib::DataSink &sink)
+                               {
+                                 std::this_thread::sleep_for(pause);
+                                 sink.write(response_.data() + offset, std::min(length, TRICKLE_CHUNK_BYTES));
+                                 return true;
+                               });
+      return;
+    }
+
+    case Fault::None:
+      break;
+    }
+
+    res.set_content(response_, "audio/wav"); });
+}
+
+bool MockOrchestrator::listen(const std::string &host, int port)
+{
+  return server_.listen(host, port);
+}
+
+bool MockOrchestrator::start(const std::string &host, int port)
+{
+  if (!server_.bind_to_port(host, port))
+  {
+    return false;
+  }
+  thread_ = std::thread([this]()
+                        { server_.listen_after_bind(); });
+  server_.wait_until_ready();
+  return true;
+}
+
+void MockOrchestrator::stop()
+{
+  server_.stop();
+  if (thread_.joinable())
+  {
+    thread_.join();
+  }
+}
@@ -0,0 +1,114 @@
+#include "noiseFloor.hpp"
+#include "energy.hpp"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace
+{
+  float dbToPowerRatio(float db)
+  {
+    return std::pow(10.0f, db / 10.0f);
+  }
+
+  float meanSquareToDbfs(float meanSquare)
+  {
+    return meanSquare > 0.0f ? 10.0f * std::log10(meanSquare / (32768.0f * 32768.0f)) : -120.0f;
+  }
+}
+
+NoiseFloorTracker::NoiseFloorTracker(int sampleRate, float windowSeconds)
+    : subwindowSamples_(std::max<size_t>(1, static_cast<size_t>(sampleRate * windowSeconds / NUM_SUBWINDOWS))),
+      subwindowMin_(std::numeric_limits<float>::max()),
+      subwindowMins_(NUM_SUBWINDOWS, std::numeric_limits<float>::max()),
+      startMargin_(dbToPowerRatio(12.0f)),
+      stopMargin_(dbToPowerRatio(6.0f))
+{
+}
+
+bool NoiseFloorTracker::update(const int16_t *frame, size_t numSamples)
+{
+  if (numSamples == 0)
+  {
+    return false;
+  }
+
+  const float power = energy::meanSquare(frame, numSamples);
+  smoothed_ = smoothed_ < 0.0f ? power : SMOOTHING * smoothed_ + (1.0f - SMOOTHING) * power;
+  subwindowMin_ = std::min(subwindowMin_, smoothed_);
+
+  samplesInSubwindow_ += numSamples;
+  if (samplesInSubwindow_ < subwindowSamples_)
+  {
+    return false;
+  }
+
+  // Sub-window complete: it replaces the oldest one and the floor is the
+  // minimum across the whole window.
+  samplesInSubwindow_ = 0;
+  subwindowMins_[subwindowIndex_] = subwindowMin_;
+  subwindowIndex_ = (subwindowIndex_ + 1) % NUM_SUBWINDOWS;
+  subwindowMin_ = std::numeric_limits<float>::max();
+  if (++subwindowsSeen_ < NUM_SUBWINDOWS)
+  {
+    return false;
+  }
+
+  const float windowMin = *std::min_element(subwindowMins_.begin(), subwindowMins_.end());
+  floor_.store(windowMin * BIAS, std::memory_order_relaxed);
+  hasEstimate_.store(true, std::memory_order_relaxed);
+  return true;
+}
+
+void NoiseFloorTracker::reset()
+{
+  samplesInSubwindow_ = 0;
+  smoothed_ = -1.0f;
+  subwindowMin_ = std::numeric_limits<float>::max();
+  std::fill(subwindowMins_.begin(), subwindowMins_.end(), std::numeric_limits<float>::max());
+  subwindowIndex_ = 0;
+  subwindowsSeen_ = 0;
+  floor_.store(0.0f, std::memory_order_relaxed);
+  hasEstimate_.store(false, std::memory_order_relaxed);
+}
+
+bool NoiseFloorTracker::hasEstimate() const
+{
+  return hasEstimate_.load(std::memory_order_relaxed);
+}
+
+float NoiseFloorTracker::floorMeanSquare() const
+{
+  return floor_.load(std::memory_order_relaxed);
+}
+
+float NoiseFloorTracker::floorDbfs() const
+{
+  return meanSquareToDbfs(floorMeanSquare());
+}
+
+void NoiseFloorTracker::setMargins(float startDb, float stopDb)
+{
+  startMargin_.store(dbToPowerRatio(startDb), std::memory_order_relaxed);
+  stopMargin_.store(dbToPowerRatio(std::min(stopDb, startDb)), std::memory_order_relaxed);
+}
+
+float NoiseFloorTracker::startThresholdSq() const
+{
+  return std::max(floorMeanSquare() * startMargin_.load(std::memory_order_relaxed), MIN_START_SQ);
+}
+
+float NoiseFloorTracker::stopThresholdSq() const
+{
+  return std::max(floorMeanSquare() * stopMargin_.load(std::memory_order_relaxed), MIN_STOP_SQ);
+}
+
+float NoiseFloorTracker::startThresholdDbfs() const
+{
+  return meanSquareToDbfs(startThresholdSq());
+}
+
+float NoiseFloorTracker::stopThresholdDbfs() const
+{
+  return meanSquareToDbfs(stopThresholdSq());
+}
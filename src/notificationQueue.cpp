@@ -0,0 +1,146 @@
+#include "notificationQueue.hpp"
+#include "AppLogger.hpp"
+#include "metrics.hpp"
+#include <algorithm>
+
+NotificationQueue::NotificationQueue(Speaker speak, const NotificationConfig &config)
+    : speak_(std::move(speak)), config_(config)
+{
+}
+
+NotificationQueue::~NotificationQueue()
+{
+  stop();
+}
+
+void NotificationQueue::start()
+{
+  thread_ = std::thread(&NotificationQueue::run, this);
+}
+
+void NotificationQueue::stop()
+{
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stopping_ = true;
+    queue_.clear();
+  }
+  wake_.notify_one();
+  if (thread_.joinable())
+  {
+    thread_.join();
+  }
+}
+
+size_t NotificationQueue::pending() const
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  return queue_.size();
+}
+
+void NotificationQueue::notify(const std::string &text, Priority priority, const std::string &topic)
+{
+  Metrics &metrics = Metrics::getInstance();
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (stopping_)
+    {
+      return;
+    }
+
+    // Already on its way: keep one copy, at the higher of the two priorities.
+    auto queued = std::find_if(queue_.begin(), queue_.end(), [&](const Item &item)
+                               { return item.text == text; });
+    if (queued != queue_.end() || text == speaking_)
+    {
+      if (queued != queue_.end())
+      {
+        queued->priority = std::max(queued->priority, priority);
+      }
+      metrics.increment(Metrics::Counter::NotificationsCoalesced);
+      LOG_DEBUG("NotificationQueue: coalesced \"{}\"", text);
+      return;
+    }
+
+    // A newer report of the same state replaces one still waiting, even
+    // if it is itself a repeat the user has just heard.
+    if (!topic.empty())
+    {
+      const size_t before = queue_.size();
+      queue_.erase(std::remove_if(queue_.begin(), queue_.end(), [&](const Item &item)
+                                  { return item.topic == topic; }),
+                   queue_.end());
+      metrics.increment(Metrics::Counter::NotificationsCoalesced, before - queue_.size());
+    }
+
+    // Only a repeat of the last thing said is held back: anything else may
+    // be a change of state the user has not heard yet.
+    const auto now = std::chrono::steady_clock::now();
+    if (text == lastSaid_ && now - lastSaidAt_ < config_.repeatInterval)
+    {
+      metrics.increment(Metrics::Counter::NotificationsRateLimited);
+      LOG_DEBUG("NotificationQueue: \"{}\" was said {} ms ago; skipped", text,
+                std::chrono::duration_cast<std::chrono::milliseconds>(now - lastSaidAt_).count());
+      return;
+    }
+
+    // Progress messages are stale once something more important is queued.
+    if (priority > Priority::Low)
+    {
+      const size_t before = queue_.size();
+      queue_.erase(std::remove_if(queue_.begin(), queue_.end(), [](const Item &item)
+                                  { return item.priority == Priority::Low; }),
+                   queue_.end());
+      metrics.increment(Metrics::Counter::NotificationsDropped, before - queue_.size());
+    }
+
+    if (queue_.size() >= std::max<size_t>(config_.maxQueued, 1))
+    {
+      // Evict the oldest of the least important, unless that is the newcomer.
+      auto victim = std::min_element(queue_.begin(), queue_.end(), [](const Item &a, const Item &b)
+                                     { return a.priority < b.priority; });
+      metrics.increment(Metrics::Counter::NotificationsDropped);
+      if (victim->priority > priority)
+      {
+        LOG_DEBUG("NotificationQueue: queue full; dropped \"{}\"", text);
+        return;
+      }
+      LOG_DEBUG("NotificationQueue: queue full; dropped \"{}\"", victim->text);
+      queue_.erase(victim);
+    }
+    queue_.push_back({text, priority, topic});
+  }
+  wake_.notify_one();
+}
+
+void NotificationQueue::run()
+{
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (true)
+  {
+    wake_.wait(lock, [this]
+               { return stopping_ || !queue_.empty(); });
+    if (stopping_)
+    {
+      return;
+    }
+
+    // Most important first; arrival order among equals.
+    auto next = std::max_element(queue_.begin(), queue_.end(), [](const Item &a, const Item &b)
+                                 { return a.priority < b.priority; });
+    speaking_ = std::move(next->text);
+    queue_.erase(next);
+    lastSaid_ = speaking_;
+
+    lock.unlock();
+    const bool said = speak_(speaking_);
+    lock.lock();
+
+    if (!said)
+    {
+      LOG_ERROR("NotificationQueue: failed to say \"{}\"", speaking_);
+    }
+    lastSaidAt_ = std::chrono::steady_clock::now();
+    speaking_.clear();
+  }
+}
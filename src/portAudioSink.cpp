@@ -0,0 +1,189 @@
+#include "portAudioSink.hpp"
+#include "AppLogger.hpp"
+#include <algorithm>
+#include <chrono>
+#include <thread>
+
+namespace
+{
+  constexpr int JITTER_BUFFER_SECONDS = 2;
+
+  // The jitter buffer is sized for this up front; a response in a larger
+  // format reallocates it once.
+  constexpr size_t JITTER_BUFFER_SAMPLES = 48000 * 2 * JITTER_BUFFER_SECONDS;
+}
+
+PortAudioSink::PortAudioSink(int prebufferMs)
+    : prebufferMs(std::max(prebufferMs, 0)),
+      jitterBuffer_(std::make_unique<SpscRingBuffer<int16_t>>(JITTER_BUFFER_SAMPLES))
+{
+  // Reference counted, like the capture side.
+  PaError err = Pa_Initialize();
+  if (err != paNoError)
+  {
+    LOG_ERROR("PortAudioSink: PortAudio initialization failed: {}", Pa_GetErrorText(err));
+    return;
+  }
+  paInitialized = true;
+}
+
+PortAudioSink::~PortAudioSink()
+{
+  abort();
+  if (paInitialized)
+  {
+    Pa_Terminate();
+  }
+}
+
+int PortAudioSink::paCallback(const void * /*input*/, void *output,
+                              unsigned long frameCount,
+                              const PaStreamCallbackTimeInfo * /*timeInfo*/,
+                              PaStreamCallbackFlags /*statusFlags*/,
+                              void *userData)
+{
+  auto *self = static_cast<PortAudioSink *>(userData);
+  auto *out = static_cast<int16_t *>(output);
+
+  const size_t needed = frameCount * self->channels_;
+  const size_t got = self->jitterBuffer_->read(out, needed);
+  if (got < needed)
+  {
+    std::fill(out + got, out + needed, 0);
+    if (!self->draining_.load(std::memory_order_relaxed))
+    {
+      self->underrunFrames_.fetch_add((needed - got) / self->channels_, std::memory_order_relaxed);
+    }
+  }
+  return paContinue;
+}
+
+bool PortAudioSink::open(int sampleRate, int channels)
+{
+  abort();
+  if (!paInitialized)
+  {
+    LOG_ERROR("PortAudioSink: PortAudio not initialized. Cannot play audio.");
+    return false;
+  }
+
+  sampleRate_ = sampleRate;
+  channels_ = channels;
+  const size_t needed = static_cast<size_t>(sampleRate) * channels * JITTER_BUFFER_SECONDS;
+  if (jitterBuffer_->capacity() < needed)
+  {
+    jitterBuffer_ = std::make_unique<SpscRingBuffer<int16_t>>(needed);
+  }
+  open_ = true;
+  prebufferSamples_ = static_cast<size_t>(prebufferMs) * sampleRate / 1000 * channels;
+  draining_ = false;
+  underrunFrames_ = 0;
+  return true;
+}
+
+bool PortAudioSink::startStream()
+{
+  PaError err = Pa_OpenDefaultStream(&stream,
+                                     0,
+                                     channels_,
+                                     paInt16,
+                                     sampleRate_,
+                                     paFramesPerBufferUnspecified,
+                                     &PortAudioSink::paCallback,
+                                     this);
+  if (err != paNoError)
+  {
+    LOG_ERROR("PortAudioSink: error opening playback stream: {}", Pa_GetErrorText(err));
+    stream = nullptr;
+    return false;
+  }
+
+  err = Pa_StartStream(stream);
+  if (err != paNoError)
+  {
+    LOG_ERROR("PortAudioSink: error starting playback stream: {}", Pa_GetErrorText(err));
+    Pa_CloseStream(stream);
+    stream = nullptr;
+    return false;
+  }
+  return true;
+}
+
+bool PortAudioSink::write(const int16_t *samples, size_t count)
+{
+  if (!open_)
+  {
+    return false;
+  }
+
+  while (count > 0)
+  {
+    size_t written = jitterBuffer_->write(samples, count);
+    samples += written;
+    count -= written;
+
+    // Start once the prebuffer is full, or when the buffer cannot take more.
+    if (!stream && (jitterBuffer_->available() >= prebufferSamples_ || count > 0))
+    {
+      if (!startStream())
+      {
+        return false;
+      }
+    }
+
+    if (count > 0)
+    {
+      // Jitter buffer full: let the speaker catch up (backpressures the socket).
+      std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+  }
+  return true;
+}
+
+bool PortAudioSink::drain()
+{
+  if (!open_)
+  {
+    return false;
+  }
+
+  // Short clips never reach the prebuffer threshold.
+  if (!stream && !startStream())
+  {
+    jitterBuffer_->discardAll();
+    open_ = false;
+    return false;
+  }
+
+  draining_ = true;
+  while (jitterBuffer_->available() > 0 && Pa_IsStreamActive(stream) == 1)
+  {
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+  }
+
+  // Pa_StopStream returns after the device has played all queued buffers.
+  Pa_StopStream(stream);
+  Pa_CloseStream(stream);
+  stream = nullptr;
+  jitterBuffer_->discardAll();
+  open_ = false;
+
+  if (underrunFrames() > 0)
+  {
+    LOG_WARN("PortAudioSink: playback underruns: {} frames", underrunFrames());
+  }
+  return true;
+}
+
+void PortAudioSink::abort()
+{
+  if (stream)
+  {
+    Pa_AbortStream(stream);
+    Pa_CloseStream(stream);
+    stream = nullptr;
+  }
+  // The stream is closed, so nothing else reads the buffer.
+  jitterBuffer_->discardAll();
+  open_ = false;
+}
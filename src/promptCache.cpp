@@ -0,0 +1,323 @@
+#include "promptCache.hpp"
+#include "AppLogger.hpp"
+#include "streamingPlayer.hpp"
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace
+{
+  constexpr char PACK_MAGIC[4] = {'S', 'P', 'K', '1'};
+
+  struct PackEntry
+  {
+    uint32_t textOffset;
+    uint32_t textLength;
+    uint32_t sampleRate;
+    uint32_t reserved;
+    uint64_t sampleOffset; // bytes from the start of the pack
+    uint64_t sampleCount;
+  };
+  static_assert(sizeof(PackEntry) == 32, "pack entries are 32 bytes");
+}
+
+PromptCache::PromptCache(const std::string &packPath, const std::string &voice, int wordsPerMinute)
+    : packPath_(packPath), voice_(voice), wordsPerMinute_(wordsPerMinute)
+{
+}
+
+PromptCache::~PromptCache()
+{
+  if (map_)
+  {
+    munmap(const_cast<uint8_t *>(map_), mapSize_);
+  }
+}
+
+void PromptCache::load(const std::vector<std::string> &texts)
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  mapPack();
+
+  const auto start = std::chrono::steady_clock::now();
+  size_t added = 0;
+  for (const auto &text : texts)
+  {
+    if (packed_.count(text) == 0 && rendered_.count(text) == 0 && renderLocked(text))
+    {
+      ++added;
+    }
+  }
+  if (added > 0)
+  {
+    savePack();
+    LOG_INFO("PromptCache: rendered {} prompts in {} ms", added,
+             std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count());
+  }
+  LOG_INFO("PromptCache: {} prompts ready from {}", packed_.size() + rendered_.size(), packPath_);
+}
+
+bool PromptCache::get(const std::string &text, PromptClip &clip)
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (auto it = packed_.find(text); it != packed_.end())
+  {
+    clip = it->second;
+    return true;
+  }
+  auto it = rendered_.find(text);
+  if (it == rendered_.end())
+  {
+    LOG_DEBUG("PromptCache: rendering uncached prompt \"{}\"", text);
+    if (!renderLocked(text))
+    {
+      return false;
+    }
+    savePack();
+    it = rendered_.find(text);
+  }
+  clip.samples = it->second.samples.data();
+  clip.count = it->second.samples.size();
+  clip.sampleRate = it->second.sampleRate;
+  return true;
+}
+
+size_t PromptCache::size() const
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  return packed_.size() + rendered_.size();
+}
+
+std::string PromptCache::settings() const
+{
+  return voice_ + " " + std::to_string(wordsPerMinute_);
+}
+
+void PromptCache::mapPack()
+{
+  const int fd = ::open(packPath_.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0)
+  {
+    return; // first run
+  }
+  struct stat st;
+  if (fstat(fd, &st) != 0 || st.st_size < 12)
+  {
+    ::close(fd);
+    return;
+  }
+  void *map = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+  ::close(fd);
+  if (map == MAP_FAILED)
+  {
+    LOG_WARN("PromptCache: could not map {}", packPath_);
+    return;
+  }
+  map_ = static_cast<const uint8_t *>(map);
+  mapSize_ = static_cast<size_t>(st.st_size);
+
+  uint32_t count;
+  uint32_t settingsLength;
+  std::memcpy(&count, map_ + 4, sizeof(count));
+  std::memcpy(&settingsLength, map_ + 8, sizeof(settingsLength));
+  const size_t entriesStart = 12 + static_cast<size_t>(settingsLength);
+  if (std::memcmp(map_, PACK_MAGIC, 4) != 0 || entriesStart > mapSize_ ||
+      count > (mapSize_ - entriesStart) / sizeof(PackEntry))
+  {
+    LOG_WARN("PromptCache: ignoring invalid pack {}", packPath_);
+    return;
+  }
+  if (std::string(reinterpret_cast<const char *>(map_ + 12), settingsLength) != settings())
+  {
+    LOG_INFO("PromptCache: voice settings changed; rendering prompts again");
+    return;
+  }
+  for (uint32_t i = 0; i < count; ++i)
+  {
+    PackEntry entry;
+    std::memcpy(&entry, map_ + entriesStart + i * sizeof(PackEntry), sizeof(entry));
+    const bool inBounds = entry.textOffset + static_cast<uint64_t>(entry.textLength) <= mapSize_ &&
+                          entry.sampleOffset % alignof(int16_t) == 0 && entry.sampleOffset <= mapSize_ &&
+                          entry.sampleCount <= (mapSize_ - entry.sampleOffset) / sizeof(int16_t);
+    if (!inBounds || entry.sampleRate == 0)
+    {
+      LOG_WARN("PromptCache: pack entry {} is corrupt; it will be rendered again", i);
+      continue;
+    }
+    PromptClip clip;
+    clip.samples = reinterpret_cast<const int16_t *>(map_ + entry.sampleOffset);
+    clip.count = static_cast<size_t>(entry.sampleCount);
+    clip.sampleRate = static_cast<int>(entry.sampleRate);
+    packed_.emplace(std::string(reinterpret_cast<const char *>(map_ + entry.textOffset), entry.textLength), clip);
+  }
+}
+
+bool PromptCache::renderLocked(const std::string &text)
+{
+  Rendered clip;
+  if (!synthesize(text, voice_, wordsPerMinute_, clip.samples, clip.sampleRate))
+  {
+    LOG_ERROR("PromptCache: espeak-ng failed to render \"{}\". Is espeak-ng installed?", text);
+    return false;
+  }
+  rendered_.emplace(text, std::move(clip));
+  return true;
+}
+
+// Writes every clip to a new file and renames it over the pack. The current
+// mapping keeps the old file's pages, so clips already handed out stay valid.
+void PromptCache::savePack()
+{
+  struct Item
+  {
+    const std::string *text;
+    PromptClip clip;
+  };
+  std::vector<Item> items;
+  for (const auto &[text, clip] : packed_)
+  {
+    items.push_back({&text, clip});
+  }
+  for (const auto &[text, rendered] : rendered_)
+  {
+    items.push_back({&text, {rendered.samples.data(), rendered.samples.size(), rendered.sampleRate}});
+  }
+
+  const std::string settings = this->settings();
+  const uint64_t entriesStart = 12 + settings.size();
+  std::vector<PackEntry> entries(items.size());
+  uint64_t offset = entriesStart + entries.size() * sizeof(PackEntry);
+  for (size_t i = 0; i < items.size(); ++i)
+  {
+    entries[i].textOffset = static_cast<uint32_t>(offset);
+    entries[i].textLength = static_cast<uint32_t>(items[i].text->size());
+    entries[i].sampleRate = static_cast<uint32_t>(items[i].clip.sampleRate);
+    entries[i].reserved = 0;
+    offset += items[i].text->size();
+  }
+  offset = (offset + 7) & ~uint64_t{7};
+  const uint64_t samplesStart = offset;
+  for (size_t i = 0; i < items.size(); ++i)
+  {
+    entries[i].sampleOffset = offset;
+    entries[i].sampleCount = items[i].clip.count;
+    offset += items[i].clip.count * sizeof(int16_t);
+  }
+
+  const std::string tmpPath = packPath_ + ".tmp";
+  std::ofstream out(tmpPath, std::ios::binary | std::ios::trunc);
+  const uint32_t count = static_cast<uint32_t>(entries.size());
+  const uint32_t settingsLength = static_cast<uint32_t>(settings.size());
+  out.write(PACK_MAGIC, 4);
+  out.write(reinterpret_cast<const char *>(&count), sizeof(count));
+  out.write(reinterpret_cast<const char *>(&settingsLength), sizeof(settingsLength));
+  out.write(settings.data(), settings.size());
+  out.write(reinterpret_cast<const char *>(entries.data()), entries.size() * sizeof(PackEntry));
+  uint64_t written = entriesStart + entries.size() * sizeof(PackEntry);
+  for (const auto &item : items)
+  {
+    out.write(item.text->data(), item.text->size());
+    written += item.text->size();
+  }
+  const char padding[8] = {};
+  out.write(padding, samplesStart - written);
+  for (const auto &item : items)
+  {
+    out.write(reinterpret_cast<const char *>(item.clip.samples), item.clip.count * sizeof(int16_t));
+  }
+  out.close();
+  if (!out || std::rename(tmpPath.c_str(), packPath_.c_str()) != 0)
+  {
+    LOG_WARN("PromptCache: could not write {}; prompts will be rendered again next start", packPath_);
+    std::remove(tmpPath.c_str());
+  }
+}
+
+bool PromptCache::synthesize(const std::string &text, const std::string &voice, int wordsPerMinute,
+                             std::vector<int16_t> &samples, int &sampleRate)
+{
+  int fds[2];
+  if (pipe2(fds, O_CLOEXEC) != 0)
+  {
+    return false;
+  }
+  const std::string speed = std::to_string(wordsPerMinute);
+  const pid_t pid = fork();
+  if (pid == 0)
+  {
+    dup2(fds[1], STDOUT_FILENO);
+    const int devNull = ::open("/dev/null", O_WRONLY);
+    if (devNull >= 0)
+    {
+      dup2(devNull, STDERR_FILENO);
+    }
+    // "--" so a prompt that starts with '-' is spoken, not parsed as an option.
+    execlp("espeak-ng", "espeak-ng", "-v", voice.c_str(), "-s", speed.c_str(), "--stdout", "--", text.c_str(),
+           static_cast<char *>(nullptr));
+    _exit(127);
+  }
+  ::close(fds[1]);
+  if (pid < 0)
+  {
+    ::close(fds[0]);
+    return false;
+  }
+
+  WavStreamParser parser;
+  bool parsed = true;
+  uint8_t buffer[16384];
+  ssize_t n;
+  while ((n = ::read(fds[0], buffer, sizeof(buffer))) != 0)
+  {
+    if (n < 0)
+    {
+      if (errno == EINTR)
+      {
+        continue;
+      }
+      break;
+    }
+    parsed = parsed && parser.feed(buffer, static_cast<size_t>(n), samples);
+  }
+  ::close(fds[0]);
+
+  int status = 0;
+  if (waitpid(pid, &status, 0) != pid || !WIFEXITED(status) || WEXITSTATUS(status) != 0 ||
+      !parsed || !parser.hasFormat() || parser.getChannels() != 1 || samples.empty())
+  {
+    samples.clear();
+    return false;
+  }
+  sampleRate = parser.getSampleRate();
+  return true;
+}
+
+// --- PromptPlayer ---
+
+PromptPlayer::PromptPlayer(PromptCache &cache, AudioSink &sink)
+    : cache_(cache), sink_(sink)
+{
+}
+
+bool PromptPlayer::say(const std::string &text)
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  PromptClip clip;
+  if (!cache_.get(text, clip))
+  {
+    return false;
+  }
+  if (!sink_.open(clip.sampleRate, 1) || !sink_.write(clip.samples, clip.count))
+  {
+    sink_.abort();
+    return false;
+  }
+  return sink_.drain();
+}
@@ -1,244 +1,167 @@
 #include "recorder.hpp"
-#include <portaudio.h>
-#include <iostream>
-#include <fstream>
-#include <cstring>
+#include "AppLogger.hpp"
+#include "audioSource.hpp"
+#include "energy.hpp"
+#include "latency.hpp"
+#include "metrics.hpp"
 #include <cmath>
+#include <algorithm>
 
 MicrophoneRecorder::MicrophoneRecorder(int sampleRate, int channels)
-    : sampleRate(sampleRate), channels(channels), initialized(false)
+    : sampleRate(sampleRate), channels(channels)
 {
-  recordingBuffer_.reserve(MAX_RECORDING_SAMPLES);
+  setPreRollMs(DEFAULT_PRE_ROLL_MS);
+  setVadEngine("energy");
+  LOG_DEBUG("Recorder: energy kernel {}", energy::activeKernel().name);
+}
 
-  PaError err = Pa_Initialize();
-  if (err == paNoError)
-  {
-    initialized = true;
-    std::cout << "PortAudio initialized successfully." << std::endl;
-  }
-  else
-  {
-    std::cerr << "Error: PortAudio initialization failed: " << Pa_GetErrorText(err) << std::endl;
-  }
+void MicrophoneRecorder::setPreRollMs(int ms)
+{
+  onsetPreRoll_.resize(static_cast<size_t>(std::max(ms, 0)) * sampleRate / 1000 * channels);
 }
 
-MicrophoneRecorder::~MicrophoneRecorder()
+void MicrophoneRecorder::recycleRecording(std::vector<int16_t> &&buffer)
 {
-  if (initialized)
-  {
-    PaError err = Pa_Terminate();
-    if (err != paNoError)
-    {
-      std::cerr << "Warning: PortAudio termination failed: " << Pa_GetErrorText(err) << std::endl;
-    }
-  }
+  recordingPool_.release(std::move(buffer));
 }
 
-bool MicrophoneRecorder::isInitialized() const
+const BufferPool<int16_t> &MicrophoneRecorder::recordingPool() const
 {
-  return initialized;
+  return recordingPool_;
 }
 
-float MicrophoneRecorder::computeRMS(const int16_t *data, size_t numSamples)
+void MicrophoneRecorder::setVadEngine(const std::string &engine)
 {
-  if (numSamples == 0)
-  {
-    return 0.0f;
-  }
+  vad_ = createVad(engine, sampleRate, VAD_START_THRESHOLD_SQ, VAD_STOP_THRESHOLD_SQ);
+  LOG_INFO("VAD: engine {}", vad_->name());
+}
+
+void MicrophoneRecorder::setNoiseFloorTracker(const NoiseFloorTracker *tracker)
+{
+  noiseFloor_ = tracker;
+}
+
+void MicrophoneRecorder::observeIdle(const int16_t *frame, size_t numSamples)
+{
+  vad_->observeIdle(frame, numSamples);
+}
+
+void MicrophoneRecorder::setEndpointerConfig(const EndpointerConfig &config)
+{
+  endpointer_.setConfig(config);
+}
 
-  double sum_sq = 0.0;
-  for (size_t i = 0; i < numSamples; ++i)
+const EndpointStats &MicrophoneRecorder::lastEndpoint() const
+{
+  return endpointer_.stats();
+}
+
+void MicrophoneRecorder::applyNoiseFloor()
+{
+  if (!noiseFloor_ || !noiseFloor_->hasEstimate())
   {
-    sum_sq += static_cast<double>(data[i]) * data[i];
+    vad_->setEnergyThresholds(VAD_START_THRESHOLD_SQ, VAD_STOP_THRESHOLD_SQ);
+    return;
   }
-  return static_cast<float>(sum_sq / numSamples);
+
+  const float startSq = noiseFloor_->startThresholdSq();
+  const float stopSq = noiseFloor_->stopThresholdSq();
+  vad_->setEnergyThresholds(startSq, stopSq);
+  LOG_DEBUG("VAD: noise floor {} dBFS (RMS {}), start RMS {}, stop RMS {}",
+            noiseFloor_->floorDbfs(), std::sqrt(noiseFloor_->floorMeanSquare()), std::sqrt(startSq), std::sqrt(stopSq));
 }
 
-std::vector<int16_t> MicrophoneRecorder::recordWithVAD()
+std::vector<int16_t> MicrophoneRecorder::recordWithVAD(AudioSource &capture, const RecordingCallbacks &callbacks)
 {
-  if (!initialized)
+  if (capture.getSampleRate() != sampleRate || capture.getChannels() != channels)
   {
-    std::cerr << "Error: PortAudio not initialized. Cannot record." << std::endl;
-    return {}; // Return empty vector
+    LOG_ERROR("Recorder: capture stream format does not match recorder format.");
+    return {};
   }
 
   const int frameSize = sampleRate * FRAME_DURATION_MS / 1000;
   std::vector<int16_t> frameBuffer(frameSize * channels);
-  recordingBuffer_.clear();
-
-  PaStream *stream;
-  PaError err = Pa_OpenDefaultStream(&stream,
-                                     channels,
-                                     0,
-                                     paInt16,
-                                     sampleRate,
-                                     frameSize,
-                                     nullptr, nullptr);
-  if (err != paNoError)
-  {
-    std::cerr << "Error opening audio stream: " << Pa_GetErrorText(err) << std::endl;
-    return {};
-  }
+  recordingBuffer_ = recordingPool_.acquire();
+  onsetPreRoll_.clear();
 
-  err = Pa_StartStream(stream);
-  if (err != paNoError)
-  {
-    std::cerr << "Error starting audio stream: " << Pa_GetErrorText(err) << std::endl;
-    Pa_CloseStream(stream);
-    return {};
-  }
+  applyNoiseFloor();
+  endpointer_.reset();
 
-  std::cout << "[VAD] Listening for voice..." << std::endl;
+  LOG_DEBUG("VAD: listening for voice...");
   bool recording = false;
-  int silenceCount = 0;
 
   while (true)
   {
-    err = Pa_ReadStream(stream, frameBuffer.data(), frameSize);
-    if (err != paNoError)
+    if (!capture.read(frameBuffer.data(), frameBuffer.size()))
     {
-      std::cerr << "Error reading from stream: " << Pa_GetErrorText(err) << std::endl;
+      LOG_ERROR("Recorder: error reading from capture stream.");
+      Metrics::getInstance().increment(Metrics::Counter::AudioReadErrors);
       break;
     }
 
-    float energy = computeRMS(frameBuffer.data(), frameSize * channels);
+    const bool voiced = vad_->process(frameBuffer.data(), frameSize * channels, recording);
+    const EndpointReason endpoint = endpointer_.process(voiced, FRAME_DURATION_MS);
 
-    if (!recording && energy > VAD_START_THRESHOLD_SQ)
+    if (!recording && voiced)
     {
-      std::cout << "[VAD] Voice detected. Recording..." << std::endl;
+      LatencyTracker::getInstance().mark(Stage::SpeechOnset);
+      LOG_DEBUG("VAD: voice detected. Recording...");
       recording = true;
-      silenceCount = 0;
+      // Keep the soft onset the VAD did not yet count as speech.
+      onsetPreRoll_.appendTo(recordingBuffer_);
+      if (callbacks.onSpeechStart)
+      {
+        callbacks.onSpeechStart();
+      }
+      if (callbacks.onAudio && !recordingBuffer_.empty())
+      {
+        callbacks.onAudio(recordingBuffer_.data(), recordingBuffer_.size());
+      }
+    }
+    else if (!recording)
+    {
+      onsetPreRoll_.push(frameBuffer.data(), frameBuffer.size());
     }
 
     if (recording)
     {
       recordingBuffer_.insert(recordingBuffer_.end(), frameBuffer.begin(), frameBuffer.end());
-
-      if (recordingBuffer_.size() >= MAX_RECORDING_SAMPLES)
+      if (callbacks.onAudio)
       {
-        std::cout << "[VAD] Maximum recording length reached. Stopping." << std::endl;
-        break;
+        callbacks.onAudio(frameBuffer.data(), frameBuffer.size());
       }
 
-      if (energy < VAD_STOP_THRESHOLD_SQ)
-      {
-        silenceCount++;
-        if (silenceCount > MAX_SILENCE_FRAMES_BEFORE_STOP)
-        {
-          std::cout << "[VAD] Sustained silence detected. Stopping recording." << std::endl;
-          break;
-        }
-      }
-      else
+      if (recordingBuffer_.size() >= MAX_RECORDING_SAMPLES)
       {
-        silenceCount = 0;
+        LOG_WARN("VAD: recording buffer full. Stopping.");
+        break;
       }
     }
-  }
-
-  Pa_StopStream(stream);
-  Pa_CloseStream(stream);
-
-  if (!recordingBuffer_.empty())
-  {
-    std::cout << "[Recorder] Audio recorded: " << recordingBuffer_.size() << " samples" << std::endl;
-    return recordingBuffer_;
-  }
-
-  std::cout << "[Recorder] No speech detected during recording session." << std::endl;
-  return {};
-}
-
-bool MicrophoneRecorder::playAudioData(const std::vector<uint8_t> &wavData)
-{
-  if (!initialized)
-  {
-    std::cerr << "Error: PortAudio not initialized. Cannot play audio." << std::endl;
-    return false;
-  }
 
-  if (wavData.size() < 44)
-  {
-    std::cerr << "Error: Audio data too small to contain valid WAV header." << std::endl;
-    return false;
-  }
-
-  const uint8_t *header = wavData.data();
-
-  if (std::memcmp(header, "RIFF", 4) != 0 || std::memcmp(header + 8, "WAVE", 4) != 0)
-  {
-    std::cerr << "Error: Invalid WAV file signature." << std::endl;
-    return false;
-  }
-
-  uint16_t numChannels = *reinterpret_cast<const uint16_t *>(header + 22);
-  uint32_t wavSampleRate = *reinterpret_cast<const uint32_t *>(header + 24);
-  uint16_t bitsPerSample = *reinterpret_cast<const uint16_t *>(header + 34);
-
-  size_t dataOffset = 0;
-  for (size_t i = 12; i < wavData.size() - 8; i += 4)
-  {
-    if (std::memcmp(header + i, "data", 4) == 0)
+    if (endpoint != EndpointReason::None)
     {
-      dataOffset = i + 8;
+      LatencyTracker::getInstance().mark(Stage::Endpoint);
+      const EndpointStats &stats = endpointer_.stats();
+      LOG_DEBUG("VAD: endpoint ({}): speech {} ms, endpoint latency {} ms, hangover {} ms",
+                Endpointer::reasonName(endpoint), stats.speechMs, stats.latencyMs, stats.hangoverMs);
       break;
     }
   }
 
-  if (dataOffset == 0)
+  if (recording && callbacks.onEndpoint)
   {
-    std::cerr << "Error: Could not find data chunk in WAV file." << std::endl;
-    return false;
+    callbacks.onEndpoint();
   }
 
-  size_t dataSize = wavData.size() - dataOffset;
-  size_t bytesPerSample = bitsPerSample / 8;
-  size_t numSamples = dataSize / (bytesPerSample * numChannels);
-
-  PaStream *stream;
-  PaError err = Pa_OpenDefaultStream(&stream,
-                                     0,
-                                     numChannels,
-                                     paInt16,
-                                     wavSampleRate,
-                                     paFramesPerBufferUnspecified,
-                                     nullptr, nullptr);
-
-  if (err != paNoError)
-  {
-    std::cerr << "Error opening playback stream: " << Pa_GetErrorText(err) << std::endl;
-    return false;
-  }
-
-  err = Pa_StartStream(stream);
-  if (err != paNoError)
-  {
-    std::cerr << "Error starting playback stream: " << Pa_GetErrorText(err) << std::endl;
-    Pa_CloseStream(stream);
-    return false;
-  }
-
-  constexpr size_t BUFFER_SIZE_FRAMES = 1024;
-  const int16_t *audioData = reinterpret_cast<const int16_t *>(wavData.data() + dataOffset);
-  size_t framesPlayed = 0;
-  size_t totalFrames = numSamples / numChannels;
-
-  while (framesPlayed < totalFrames)
+  if (!recordingBuffer_.empty())
   {
-    size_t framesToPlay = std::min(BUFFER_SIZE_FRAMES, totalFrames - framesPlayed);
-
-    err = Pa_WriteStream(stream, audioData + (framesPlayed * numChannels), framesToPlay);
-    if (err != paNoError)
-    {
-      std::cerr << "Error during playback: " << Pa_GetErrorText(err) << std::endl;
-      break;
-    }
-
-    framesPlayed += framesToPlay;
+    LOG_DEBUG("Recorder: audio recorded: {} samples", recordingBuffer_.size());
+    return std::move(recordingBuffer_);
   }
 
-  Pa_StopStream(stream);
-  Pa_CloseStream(stream);
+  recordingPool_.release(std::move(recordingBuffer_));
+  Metrics::getInstance().increment(Metrics::Counter::VadAborts);
 
-  return (err == paNoError);
-}
\ No newline at end of file
+  LOG_DEBUG("Recorder: no speech detected during recording session.");
+  return {};
+}
@@ -0,0 +1,430 @@
+#include "streamingPlayer.hpp"
+#include "AppLogger.hpp"
+#include "imaAdpcm.hpp"
+#include "latency.hpp"
+#include <algorithm>
+#include <cstring>
+
+namespace
+{
+  uint16_t readU16(const uint8_t *p)
+  {
+    uint16_t v;
+    std::memcpy(&v, p, sizeof(v));
+    return v;
+  }
+
+  uint32_t readU32(const uint8_t *p)
+  {
+    uint32_t v;
+    std::memcpy(&v, p, sizeof(v));
+    return v;
+  }
+
+  // WAVE format tags.
+  constexpr uint16_t WAVE_FORMAT_PCM = 0x0001;
+  constexpr uint16_t WAVE_FORMAT_ALAW = 0x0006;
+  constexpr uint16_t WAVE_FORMAT_MULAW = 0x0007;
+  constexpr uint16_t WAVE_FORMAT_EXTENSIBLE = 0xFFFE;
+
+  // G.711 expansion, one table lookup per byte.
+  struct G711Table
+  {
+    int16_t values[256];
+
+    explicit G711Table(bool aLaw)
+    {
+      for (int i = 0; i < 256; ++i)
+      {
+        if (aLaw)
+        {
+          const int a = i ^ 0x55;
+          const int segment = (a & 0x70) >> 4;
+          int t = (a & 0x0F) << 4;
+          t = segment == 0 ? t + 8 : (t + 0x108) << (segment - 1);
+          values[i] = static_cast<int16_t>((a & 0x80) ? t : -t);
+        }
+        else
+        {
+          const int u = ~i & 0xFF;
+          const int t = (((u & 0x0F) << 3) + 0x84) << ((u & 0x70) >> 4);
+          values[i] = static_cast<int16_t>((u & 0x80) ? 0x84 - t : t - 0x84);
+        }
+      }
+    }
+  };
+
+  const G711Table ALAW(true);
+  const G711Table MULAW(false);
+}
+
+// --- WavStreamParser ---
+
+void WavStreamParser::reset()
+{
+  state_ = State::RiffHeader;
+  pending_.clear();
+  needed_ = 12;
+  skipRemaining_ = 0;
+  haveFmt_ = false;
+  factFrames_ = 0;
+  samplesOut_ = 0;
+}
+
+bool WavStreamParser::feed(const uint8_t *data, size_t len, std::vector<int16_t> &out)
+{
+  size_t pos = 0;
+  while (pos < len)
+  {
+    switch (state_)
+    {
+    case State::Error:
+      return false;
+
+    case State::SkipChunk:
+    {
+      size_t n = std::min(skipRemaining_, len - pos);
+      pos += n;
+      skipRemaining_ -= n;
+      if (skipRemaining_ == 0)
+      {
+        state_ = State::ChunkHeader;
+        needed_ = 8;
+      }
+      break;
+    }
+
+    case State::Data:
+    {
+      const size_t start = out.size();
+      pos += feedData(data + pos, len - pos, out);
+      limitToFact(out, start);
+      break;
+    }
+
+    default:
+    {
+      size_t n = std::min(needed_ - pending_.size(), len - pos);
+      pending_.insert(pending_.end(), data + pos, data + pos + n);
+      pos += n;
+      if (pending_.size() == needed_ && !handleHeaderBytes())
+      {
+        state_ = State::Error;
+        return false;
+      }
+      break;
+    }
+    }
+  }
+  return true;
+}
+
+// Decodes from the data chunk; returns the bytes consumed. Units split across
+// network reads wait in pending_.
+size_t WavStreamParser::feedData(const uint8_t *data, size_t len, std::vector<int16_t> &out)
+{
+  switch (audioFormat_)
+  {
+  case WAVE_FORMAT_ALAW:
+  case WAVE_FORMAT_MULAW:
+  {
+    const int16_t *table = audioFormat_ == WAVE_FORMAT_ALAW ? ALAW.values : MULAW.values;
+    const size_t old = out.size();
+    out.resize(old + len);
+    for (size_t i = 0; i < len; ++i)
+    {
+      out[old + i] = table[data[i]];
+    }
+    return len;
+  }
+
+  case ima::FORMAT_TAG:
+  {
+    size_t pos = 0;
+    if (!pending_.empty())
+    {
+      pos = std::min<size_t>(blockAlign_ - pending_.size(), len);
+      pending_.insert(pending_.end(), data, data + pos);
+      if (pending_.size() < blockAlign_)
+      {
+        return pos;
+      }
+      ima::decodeBlock(pending_.data(), blockAlign_, channels_, out);
+      pending_.clear();
+    }
+    for (; len - pos >= blockAlign_; pos += blockAlign_)
+    {
+      ima::decodeBlock(data + pos, blockAlign_, channels_, out);
+    }
+    pending_.insert(pending_.end(), data + pos, data + len);
+    return len;
+  }
+
+  default:
+  {
+    // A sample split across two network reads.
+    if (!pending_.empty())
+    {
+      pending_.push_back(data[0]);
+      out.push_back(static_cast<int16_t>(readU16(pending_.data())));
+      pending_.clear();
+      return 1;
+    }
+
+    size_t samples = len / sizeof(int16_t);
+    size_t old = out.size();
+    out.resize(old + samples);
+    std::memcpy(out.data() + old, data, samples * sizeof(int16_t));
+    size_t pos = samples * sizeof(int16_t);
+
+    if (pos < len)
+    {
+      pending_.push_back(data[pos++]);
+    }
+    return pos;
+  }
+  }
+}
+
+// Drops decoded frames beyond the fact chunk's count, i.e. block padding.
+void WavStreamParser::limitToFact(std::vector<int16_t> &out, size_t start)
+{
+  if (factFrames_ == 0)
+  {
+    return;
+  }
+  // Counted in samples: a split read can end partway through a frame, and the
+  // rest of that frame arrives with the next one.
+  const uint64_t limit = static_cast<uint64_t>(factFrames_) * channels_;
+  const uint64_t keep = std::min<uint64_t>(out.size() - start, limit - std::min(samplesOut_, limit));
+  out.resize(start + keep);
+  samplesOut_ += keep;
+}
+
+bool WavStreamParser::checkEncoding() const
+{
+  bool supported = false;
+  switch (audioFormat_)
+  {
+  case WAVE_FORMAT_PCM:
+    supported = bitsPerSample_ == 16;
+    break;
+  case WAVE_FORMAT_ALAW:
+  case WAVE_FORMAT_MULAW:
+    supported = bitsPerSample_ == 8;
+    break;
+  case ima::FORMAT_TAG:
+    supported = bitsPerSample_ == 4 && blockAlign_ > 4 * channels_ && blockAlign_ % (4 * channels_) == 0;
+    break;
+  default:
+    break;
+  }
+  if (!supported)
+  {
+    LOG_ERROR("StreamingPlayer: unsupported WAV encoding (format {}, {} bits).", audioFormat_, bitsPerSample_);
+  }
+  return supported;
+}
+
+bool WavStreamParser::handleHeaderBytes()
+{
+  const uint8_t *p = pending_.data();
+
+  switch (state_)
+  {
+  case State::RiffHeader:
+    if (std::memcmp(p, "RIFF", 4) != 0 || std::memcmp(p + 8, "WAVE", 4) != 0)
+    {
+      LOG_ERROR("StreamingPlayer: invalid WAV file signature.");
+      return false;
+    }
+    state_ = State::ChunkHeader;
+    needed_ = 8;
+    break;
+
+  case State::ChunkHeader:
+  {
+    uint32_t chunkSize = readU32(p + 4);
+    if (std::memcmp(p, "fmt ", 4) == 0)
+    {
+      if (chunkSize < 16)
+      {
+        LOG_ERROR("StreamingPlayer: WAV fmt chunk too small.");
+        return false;
+      }
+      state_ = State::FmtChunk;
+      needed_ = chunkSize + (chunkSize & 1);
+    }
+    else if (std::memcmp(p, "fact", 4) == 0 && chunkSize >= 4)
+    {
+      state_ = State::FactChunk;
+      needed_ = chunkSize + (chunkSize & 1);
+    }
+    else if (std::memcmp(p, "data", 4) == 0)
+    {
+      if (!haveFmt_)
+      {
+        LOG_ERROR("StreamingPlayer: WAV data chunk before fmt chunk.");
+        return false;
+      }
+      if (!checkEncoding())
+      {
+        return false;
+      }
+      state_ = State::Data;
+    }
+    else
+    {
+      skipRemaining_ = chunkSize + (chunkSize & 1);
+      state_ = skipRemaining_ > 0 ? State::SkipChunk : State::ChunkHeader;
+    }
+    break;
+  }
+
+  case State::FmtChunk:
+    audioFormat_ = readU16(p);
+    channels_ = readU16(p + 2);
+    sampleRate_ = readU32(p + 4);
+    blockAlign_ = readU16(p + 12);
+    bitsPerSample_ = readU16(p + 14);
+    if (audioFormat_ == WAVE_FORMAT_EXTENSIBLE && needed_ >= 40)
+    {
+      audioFormat_ = readU16(p + 24); // first two bytes of the SubFormat GUID
+    }
+    haveFmt_ = channels_ > 0 && sampleRate_ > 0;
+    if (!haveFmt_)
+    {
+      LOG_ERROR("StreamingPlayer: invalid WAV fmt chunk.");
+      return false;
+    }
+    state_ = State::ChunkHeader;
+    needed_ = 8;
+    break;
+
+  case State::FactChunk:
+  {
+    // Streaming encoders that do not know the length write 0 or ~0.
+    const uint32_t frames = readU32(p);
+    factFrames_ = frames == 0xFFFFFFFF ? 0 : frames;
+    state_ = State::ChunkHeader;
+    needed_ = 8;
+    break;
+  }
+
+  default:
+    return false;
+  }
+
+  pending_.clear();
+  return true;
+}
+
+// --- StreamingPlayer ---
+
+StreamingPlayer::StreamingPlayer(AudioSink &sink)
+    : sink_(sink)
+{
+}
+
+void StreamingPlayer::reset()
+{
+  sink_.abort();
+  sinkOpen_ = false;
+  container_ = Container::Unknown;
+  magic_.clear();
+  parser_.reset();
+  flac_ = flac::Decoder();
+  bytesReceived_ = 0;
+  failed = false;
+}
+
+bool StreamingPlayer::feed(const char *data, size_t len)
+{
+  bytesReceived_ += len;
+  if (failed)
+  {
+    return false;
+  }
+
+  decoded_.clear();
+  const uint8_t *bytes = reinterpret_cast<const uint8_t *>(data);
+  bool ok;
+  if (container_ == Container::Unknown)
+  {
+    // "RIFF" or "fLaC"; hold the first bytes until there are enough to tell.
+    const size_t n = std::min(len, 4 - magic_.size());
+    magic_.insert(magic_.end(), bytes, bytes + n);
+    if (magic_.size() < 4)
+    {
+      return true;
+    }
+    container_ = std::memcmp(magic_.data(), "fLaC", 4) == 0 ? Container::Flac : Container::Wav;
+    ok = decode(magic_.data(), magic_.size()) && decode(bytes + n, len - n);
+  }
+  else
+  {
+    ok = decode(bytes, len);
+  }
+  if (!ok)
+  {
+    failed = true;
+    return false;
+  }
+
+  if (decoded_.empty())
+  {
+    return true;
+  }
+
+  if (!sinkOpen_)
+  {
+    const bool isFlac = container_ == Container::Flac;
+    if (!sink_.open(isFlac ? flac_.sampleRate() : parser_.getSampleRate(),
+                    isFlac ? flac_.channels() : parser_.getChannels()))
+    {
+      failed = true;
+      return false;
+    }
+    sinkOpen_ = true;
+    // Samples reach the device once the sink's prebuffer fills.
+    LatencyTracker::getInstance().mark(Stage::PlaybackStart);
+  }
+
+  if (!sink_.write(decoded_.data(), decoded_.size()))
+  {
+    failed = true;
+    return false;
+  }
+  return true;
+}
+
+bool StreamingPlayer::decode(const uint8_t *data, size_t len)
+{
+  if (container_ == Container::Flac)
+  {
+    return flac_.feed(data, len, decoded_);
+  }
+  return parser_.feed(data, len, decoded_);
+}
+
+bool StreamingPlayer::finish()
+{
+  if (!sinkOpen_)
+  {
+    if (!failed)
+    {
+      LOG_ERROR("StreamingPlayer: response contained no playable audio.");
+    }
+    return false;
+  }
+
+  sinkOpen_ = false;
+  if (failed)
+  {
+    sink_.abort();
+    return false;
+  }
+  const bool played = sink_.drain();
+  LatencyTracker::getInstance().mark(Stage::PlaybackEnd);
+  return played;
+}
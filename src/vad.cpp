@@ -0,0 +1,302 @@
+#include "vad.hpp"
+#include "energy.hpp"
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+  constexpr float PI = 3.14159265358979f;
+
+  // Band edges in Hz, as in WebRTC's VAD.
+  constexpr float BAND_EDGES[SpectralVad::NUM_BANDS + 1] = {80, 250, 500, 1000, 2000, 3000, 4000};
+
+  // Higher bands carry more of the discriminating formant energy.
+  constexpr float BAND_WEIGHTS[SpectralVad::NUM_BANDS] = {6, 8, 10, 12, 14, 16};
+
+  // Decision thresholds on the weighted mean log-likelihood ratio.
+  constexpr float LLR_ONSET = 1.0f;
+  constexpr float LLR_CONTINUE = -1.5f;
+
+  // Flatness near 0.56 is white noise; voiced speech sits far below it.
+  constexpr float FLATNESS_PIVOT = 0.35f;
+  constexpr float FLATNESS_WEIGHT = 6.0f;
+
+  // Adaptation rates and model limits (dB).
+  constexpr float NOISE_RATE = 0.02f;
+  constexpr float NOISE_FALL_RATE = 0.15f; // faster when the level drops below the noise mean
+  constexpr float SPEECH_RATE = 0.01f;
+  constexpr float MIN_SPEECH_NOISE_GAP = 6.0f;
+  constexpr float MIN_STDDEV = 1.5f;
+  constexpr float MAX_STDDEV = 12.0f;
+
+  float logGaussian(float x, float mean, float stddev)
+  {
+    const float z = (x - mean) / stddev;
+    return -0.5f * z * z - std::log(stddev) - 0.9189385f; // log(sqrt(2*pi))
+  }
+
+  // log(sum_k w_k N(x; m_k, s_k)) computed stably.
+  template <typename Mixture>
+  float mixtureLogLikelihood(const Mixture &m, float x, float *responsibilities = nullptr)
+  {
+    float logs[SpectralVad::NUM_COMPONENTS];
+    float maxLog = -1e30f;
+    for (int k = 0; k < SpectralVad::NUM_COMPONENTS; ++k)
+    {
+      logs[k] = std::log(m.weight[k]) + logGaussian(x, m.mean[k], m.stddev[k]);
+      maxLog = std::max(maxLog, logs[k]);
+    }
+    float sum = 0.0f;
+    for (int k = 0; k < SpectralVad::NUM_COMPONENTS; ++k)
+    {
+      logs[k] = std::exp(logs[k] - maxLog);
+      sum += logs[k];
+    }
+    if (responsibilities)
+    {
+      for (int k = 0; k < SpectralVad::NUM_COMPONENTS; ++k)
+      {
+        responsibilities[k] = logs[k] / sum;
+      }
+    }
+    return maxLog + std::log(sum);
+  }
+}
+
+// --- EnergyVad ---
+
+EnergyVad::EnergyVad(float startThresholdSq, float stopThresholdSq)
+    : startThresholdSq_(startThresholdSq), stopThresholdSq_(stopThresholdSq)
+{
+}
+
+void EnergyVad::setEnergyThresholds(float startThresholdSq, float stopThresholdSq)
+{
+  startThresholdSq_ = startThresholdSq;
+  stopThresholdSq_ = stopThresholdSq;
+}
+
+bool EnergyVad::process(const int16_t *frame, size_t numSamples, bool inSpeech)
+{
+  lastEnergy_ = energy::meanSquare(frame, numSamples);
+  return inSpeech ? lastEnergy_ >= stopThresholdSq_ : lastEnergy_ > startThresholdSq_;
+}
+
+// --- SpectralVad ---
+
+SpectralVad::SpectralVad(int sampleRate)
+    : sampleRate_(sampleRate)
+{
+  // Smallest power of two holding a 20 ms frame.
+  const size_t frameSamples = static_cast<size_t>(sampleRate) / 50;
+  fftSize_ = 1;
+  while (fftSize_ < frameSamples)
+  {
+    fftSize_ <<= 1;
+  }
+
+  window_.resize(frameSamples);
+  idleFrame_.reserve(frameSamples);
+  for (size_t i = 0; i < frameSamples; ++i)
+  {
+    window_[i] = 0.5f - 0.5f * std::cos(2.0f * PI * i / (frameSamples - 1));
+  }
+
+  twiddleRe_.resize(fftSize_ / 2);
+  twiddleIm_.resize(fftSize_ / 2);
+  for (size_t i = 0; i < fftSize_ / 2; ++i)
+  {
+    twiddleRe_[i] = std::cos(2.0f * PI * i / fftSize_);
+    twiddleIm_[i] = -std::sin(2.0f * PI * i / fftSize_);
+  }
+  re_.resize(fftSize_);
+  im_.resize(fftSize_);
+  power_.resize(fftSize_ / 2 + 1);
+
+  const float binHz = static_cast<float>(sampleRate) / fftSize_;
+  auto toBin = [&](float hz)
+  {
+    return std::min(static_cast<size_t>(hz / binHz + 0.5f), fftSize_ / 2);
+  };
+  for (int b = 0; b < NUM_BANDS; ++b)
+  {
+    bandBins_[b] = {toBin(BAND_EDGES[b]), std::max(toBin(BAND_EDGES[b + 1]), toBin(BAND_EDGES[b]) + 1)};
+  }
+  flatnessBins_ = {toBin(250), toBin(4000)};
+}
+
+void SpectralVad::computePowerSpectrum(const int16_t *frame, size_t numSamples)
+{
+  const size_t n = std::min(numSamples, window_.size());
+  for (size_t i = 0; i < fftSize_; ++i)
+  {
+    re_[i] = i < n ? frame[i] * window_[i] / 32768.0f : 0.0f;
+    im_[i] = 0.0f;
+  }
+
+  // In-place iterative radix-2 FFT.
+  for (size_t i = 1, j = 0; i < fftSize_; ++i)
+  {
+    size_t bit = fftSize_ >> 1;
+    for (; j & bit; bit >>= 1)
+    {
+      j ^= bit;
+    }
+    j ^= bit;
+    if (i < j)
+    {
+      std::swap(re_[i], re_[j]);
+    }
+  }
+  for (size_t len = 2; len <= fftSize_; len <<= 1)
+  {
+    const size_t half = len / 2;
+    const size_t step = fftSize_ / len;
+    for (size_t i = 0; i < fftSize_; i += len)
+    {
+      for (size_t k = 0; k < half; ++k)
+      {
+        const float wr = twiddleRe_[k * step];
+        const float wi = twiddleIm_[k * step];
+        const size_t a = i + k;
+        const size_t b = a + half;
+        const float tr = wr * re_[b] - wi * im_[b];
+        const float ti = wr * im_[b] + wi * re_[b];
+        re_[b] = re_[a] - tr;
+        im_[b] = im_[a] - ti;
+        re_[a] += tr;
+        im_[a] += ti;
+      }
+    }
+  }
+
+  for (size_t i = 0; i < power_.size(); ++i)
+  {
+    power_[i] = re_[i] * re_[i] + im_[i] * im_[i];
+  }
+}
+
+void SpectralVad::initializeModels(const std::array<float, NUM_BANDS> &features)
+{
+  for (int b = 0; b < NUM_BANDS; ++b)
+  {
+    noise_[b] = {{0.6f, 0.4f}, {features[b], features[b] + 3.0f}, {3.0f, 5.0f}};
+    speech_[b] = {{0.5f, 0.5f}, {features[b] + 12.0f, features[b] + 22.0f}, {6.0f, 9.0f}};
+  }
+  modelsInitialized_ = true;
+}
+
+void SpectralVad::adapt(const std::array<float, NUM_BANDS> &features, bool speech)
+{
+  for (int b = 0; b < NUM_BANDS; ++b)
+  {
+    const float x = features[b];
+    Mixture &model = speech ? speech_[b] : noise_[b];
+    float resp[NUM_COMPONENTS];
+    mixtureLogLikelihood(model, x, resp);
+
+    float rate = speech ? SPEECH_RATE : NOISE_RATE;
+    if (!speech && x < noise_[b].mean[0])
+    {
+      rate = NOISE_FALL_RATE;
+    }
+
+    for (int k = 0; k < NUM_COMPONENTS; ++k)
+    {
+      const float r = rate * resp[k];
+      const float diff = x - model.mean[k];
+      model.mean[k] += r * diff;
+      const float var = model.stddev[k] * model.stddev[k] + r * (diff * diff - model.stddev[k] * model.stddev[k]);
+      model.stddev[k] = std::clamp(std::sqrt(std::max(var, 0.0f)), MIN_STDDEV, MAX_STDDEV);
+    }
+
+    // Keep the speech model clearly above the noise model so a loud, steady
+    // noise floor cannot drag it down to where everything looks like speech.
+    for (int k = 0; k < NUM_COMPONENTS; ++k)
+    {
+      speech_[b].mean[k] = std::max(speech_[b].mean[k], noise_[b].mean[k] + MIN_SPEECH_NOISE_GAP);
+    }
+  }
+}
+
+bool SpectralVad::process(const int16_t *frame, size_t numSamples, bool inSpeech)
+{
+  computePowerSpectrum(frame, numSamples);
+
+  std::array<float, NUM_BANDS> features;
+  for (int b = 0; b < NUM_BANDS; ++b)
+  {
+    float sum = 1e-10f;
+    for (size_t i = bandBins_[b].first; i < bandBins_[b].second; ++i)
+    {
+      sum += power_[i];
+    }
+    features[b] = 10.0f * std::log10(sum);
+  }
+
+  if (!modelsInitialized_)
+  {
+    initializeModels(features);
+  }
+
+  // Spectral flatness: geometric over arithmetic mean of the power spectrum.
+  double logSum = 0.0;
+  double linSum = 0.0;
+  const size_t flatCount = flatnessBins_.second - flatnessBins_.first;
+  for (size_t i = flatnessBins_.first; i < flatnessBins_.second; ++i)
+  {
+    const double p = power_[i] + 1e-12;
+    logSum += std::log(p);
+    linSum += p;
+  }
+  const float flatness = flatCount > 0
+                             ? static_cast<float>(std::exp(logSum / flatCount) / (linSum / flatCount))
+                             : 1.0f;
+
+  float weighted = 0.0f;
+  float weightSum = 0.0f;
+  for (int b = 0; b < NUM_BANDS; ++b)
+  {
+    const float llr = mixtureLogLikelihood(speech_[b], features[b]) - mixtureLogLikelihood(noise_[b], features[b]);
+    weighted += BAND_WEIGHTS[b] * llr;
+    weightSum += BAND_WEIGHTS[b];
+  }
+  lastLlr_ = weighted / weightSum + FLATNESS_WEIGHT * (FLATNESS_PIVOT - flatness);
+
+  const bool speech = lastLlr_ > (inSpeech ? LLR_CONTINUE : LLR_ONSET);
+  adapt(features, speech);
+  return speech;
+}
+
+// Idle audio is scored like a recording, so talk in the room trains the speech
+// model rather than the noise model.
+void SpectralVad::observeIdle(const int16_t *frame, size_t numSamples)
+{
+  // Idle audio comes in wake word engine frames (512 samples for Porcupine);
+  // cut it into the 20 ms frames a recording is scored in, so none is skipped.
+  const size_t frameSamples = window_.size();
+  while (numSamples > 0)
+  {
+    const size_t n = std::min(numSamples, frameSamples - idleFrame_.size());
+    idleFrame_.insert(idleFrame_.end(), frame, frame + n);
+    frame += n;
+    numSamples -= n;
+    if (idleFrame_.size() == frameSamples)
+    {
+      idleInSpeech_ = process(idleFrame_.data(), frameSamples, idleInSpeech_);
+      idleFrame_.clear();
+    }
+  }
+}
+
+std::unique_ptr<VoiceActivityDetector> createVad(const std::string &engine,
+                                                 int sampleRate,
+                                                 float startThresholdSq,
+                                                 float stopThresholdSq)
+{
+  if (engine == "spectral")
+  {
+    return std::make_unique<SpectralVad>(sampleRate);
+  }
+  return std::make_unique<EnergyVad>(startThresholdSq, stopThresholdSq);
+}
@@ -1,5 +1,8 @@
 #include "wakeword.hpp"
 #include "AppLogger.hpp"
+#include "audioSource.hpp"
+#include "latency.hpp"
+#include "metrics.hpp"
 #include <iostream>
 #include <thread>
 #include <chrono>
@@ -7,11 +10,14 @@
 PorcupineDetector::PorcupineDetector(const std::string &accessKey,
                                      const std::string &modelPath,
                                      const std::string &keywordPath,
-                                     float sensitivity)
-    : accessKeyCopy(accessKey),
+                                     float sensitivity,
+                                     AudioSource &capture)
+    : capture(capture),
+      noiseFloor(capture.getSampleRate()),
+      sensitivity(sensitivity), // Initialize sensitivity member
+      accessKeyCopy(accessKey),
       modelPathCopy(modelPath),
-      keywordPathCopy(keywordPath),
-      sensitivity(sensitivity) // Initialize sensitivity member
+      keywordPathCopy(keywordPath)
 {
   initializedPorcupine = initializePorcupine();
 
@@ -43,6 +49,16 @@ bool PorcupineDetector::isInitialized() const
   return overallInitialized;
 }
 
+NoiseFloorTracker &PorcupineDetector::getNoiseFloor()
+{
+  return noiseFloor;
+}
+
+void PorcupineDetector::setIdleListener(std::function<void(const int16_t *, size_t)> listener)
+{
+  idleListener = std::move(listener);
+}
+
 bool PorcupineDetector::initializePorcupine()
 {
   AppLogger::getInstance().info("PorcupineDetector: Initializing Porcupine engine...");
@@ -75,55 +91,33 @@ bool PorcupineDetector::initializePorcupine()
 
 bool PorcupineDetector::initializeAudioStream()
 {
-  AppLogger::getInstance().info("PorcupineDetector: Initializing PortAudio stream...");
-
-  PaError err = Pa_OpenDefaultStream(&paStream,
-                                     channels,
-                                     0,
-                                     paInt16,
-                                     sampleRate,
-                                     frameLength,
-                                     nullptr,
-                                     nullptr);
-
-  if (err != paNoError)
+  AppLogger::getInstance().info("PorcupineDetector: Attaching to shared capture stream...");
+
+  if (capture.getSampleRate() != sampleRate)
   {
-    AppLogger::getInstance().error("PorcupineDetector: Failed to open PortAudio stream: " + std::string(Pa_GetErrorText(err)));
-    paStream = nullptr;
+    AppLogger::getInstance().error("PorcupineDetector: Capture sample rate " + std::to_string(capture.getSampleRate()) +
+                                   " does not match Porcupine sample rate " + std::to_string(sampleRate));
     return false;
   }
 
-  err = Pa_StartStream(paStream);
-  if (err != paNoError)
+  if (!capture.start())
   {
-    AppLogger::getInstance().error("PorcupineDetector: Failed to start PortAudio stream: " + std::string(Pa_GetErrorText(err)));
-    cleanupAudioStream();
+    AppLogger::getInstance().error("PorcupineDetector: Failed to start shared capture stream.");
     return false;
   }
 
-  AppLogger::getInstance().info("PorcupineDetector: PortAudio stream started successfully.");
+  AppLogger::getInstance().info("PorcupineDetector: Capture stream running.");
   return true;
 }
 
-// --- Cleanup PortAudio Stream ---
+// --- Cleanup Capture Stream ---
 void PorcupineDetector::cleanupAudioStream()
 {
-  if (paStream)
+  if (initializedStream)
   {
-    PaError err = Pa_StopStream(paStream);
-    if (err != paNoError)
-    {
-      AppLogger::getInstance().error("PorcupineDetector: Warning: Failed to stop PortAudio stream: " + std::string(Pa_GetErrorText(err)));
-    }
-
-    err = Pa_CloseStream(paStream);
-    if (err != paNoError)
-    {
-      AppLogger::getInstance().error("PorcupineDetector: Warning: Failed to close PortAudio stream: " + std::string(Pa_GetErrorText(err)));
-    }
-    paStream = nullptr;
+    capture.stop();
     initializedStream = false;
-    AppLogger::getInstance().info("PorcupineDetector: PortAudio stream cleaned up.");
+    AppLogger::getInstance().info("PorcupineDetector: Capture stream cleaned up.");
   }
 }
 
@@ -153,6 +147,7 @@ void PorcupineDetector::run(const std::function<void()> &onWakeWord)
       AppLogger::getInstance().error("PorcupineDetector: Not initialized. Attempting re-initialization...");
       cleanupAudioStream();
       cleanupPorcupine();
+      Metrics::getInstance().increment(Metrics::Counter::AudioReinits);
 
       initializedPorcupine = initializePorcupine();
       if (initializedPorcupine)
@@ -175,10 +170,16 @@ void PorcupineDetector::run(const std::function<void()> &onWakeWord)
 
     if (overallInitialized)
     {
-      PaError err = Pa_ReadStream(paStream, pcmBuffer.data(), frameLength);
-      if (err != paNoError)
+      if (!capture.read(pcmBuffer.data(), frameLength))
       {
-        AppLogger::getInstance().error("PorcupineDetector: PortAudio read error: " + std::string(Pa_GetErrorText(err)));
+        if (capture.endOfStream())
+        {
+          AppLogger::getInstance().info("PorcupineDetector: Audio source finished.");
+          return;
+        }
+        AppLogger::getInstance().error("PorcupineDetector: Capture read timed out or stream stopped.");
+        Metrics::getInstance().increment(Metrics::Counter::AudioReadErrors);
+        Metrics::getInstance().increment(Metrics::Counter::AudioReinits);
         cleanupAudioStream();
         initializedStream = initializeAudioStream();
         overallInitialized = initializedPorcupine && initializedStream;
@@ -191,6 +192,18 @@ void PorcupineDetector::run(const std::function<void()> &onWakeWord)
         continue;
       }
 
+      if (noiseFloor.update(pcmBuffer.data(), pcmBuffer.size()))
+      {
+        Metrics &metrics = Metrics::getInstance();
+        metrics.set(Metrics::Gauge::VadNoiseFloorDbfs, noiseFloor.floorDbfs());
+        metrics.set(Metrics::Gauge::VadStartThresholdDbfs, noiseFloor.startThresholdDbfs());
+        metrics.set(Metrics::Gauge::VadStopThresholdDbfs, noiseFloor.stopThresholdDbfs());
+      }
+      if (idleListener)
+      {
+        idleListener(pcmBuffer.data(), pcmBuffer.size());
+      }
+
       int32_t keywordIndex = -1;
       pv_status_t status = pv_porcupine_process(porcupineHandle, pcmBuffer.data(), &keywordIndex);
       if (status != PV_STATUS_SUCCESS)
@@ -204,9 +217,18 @@ void PorcupineDetector::run(const std::function<void()> &onWakeWord)
 
       if (keywordIndex != -1)
       {
+        Metrics::getInstance().increment(Metrics::Counter::WakeDetections);
+        LatencyTracker::getInstance().beginInteraction();
+        LatencyTracker::getInstance().mark(Stage::WakeDetected);
         AppLogger::getInstance().info("PorcupineDetector: Wake word detected (keyword index: " + std::to_string(keywordIndex) + ")!");
         onWakeWord();
-        AppLogger::getInstance().info("PorcupineDetector: Resuming listening for wake word...");
+        LatencyTracker::getInstance().endInteraction();
+
+        // Whatever accumulated while the command was handled is stale; feeding
+        // it to Porcupine now would only delay detection of the next wake word.
+        size_t stale = capture.drain();
+        AppLogger::getInstance().info("PorcupineDetector: Discarded " + std::to_string(stale) +
+                                      " stale samples. Resuming listening for wake word...");
       }
     }
   }
@@ -0,0 +1,110 @@
+#include "wavFileSource.hpp"
+#include "AppLogger.hpp"
+#include "streamingPlayer.hpp"
+#include <algorithm>
+#include <fstream>
+#include <iterator>
+#include <thread>
+
+WavFileSource::WavFileSource(const std::string &path, bool realtime, int trailingSilenceMs)
+    : realtime_(realtime)
+{
+  std::ifstream file(path, std::ios::binary);
+  if (!file.is_open())
+  {
+    LOG_ERROR("WavFileSource: could not open replay file: {}", path);
+    return;
+  }
+  std::vector<uint8_t> bytes((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+  WavStreamParser parser;
+  if (!parser.feed(bytes.data(), bytes.size(), samples_) || !parser.hasFormat())
+  {
+    LOG_ERROR("WavFileSource: replay file is not a supported WAV: {}", path);
+    samples_.clear();
+    return;
+  }
+
+  sampleRate_ = parser.getSampleRate();
+  channels_ = parser.getChannels();
+  samples_.resize(samples_.size() + static_cast<size_t>(std::max(trailingSilenceMs, 0)) * sampleRate_ / 1000 * channels_, 0);
+  loaded_ = true;
+
+  LOG_INFO("WavFileSource: loaded {}: {} ms at {} Hz, {}", path, samples_.size() / channels_ * 1000 / sampleRate_,
+           sampleRate_, realtime_ ? "real-time" : "as fast as possible");
+}
+
+size_t WavFileSource::clockPosition() const
+{
+  const auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime_).count();
+  const size_t frames = static_cast<size_t>(elapsed * sampleRate_);
+  return std::min(frames * channels_, samples_.size());
+}
+
+double WavFileSource::positionMs() const
+{
+  return sampleRate_ > 0 ? 1000.0 * (position_ / channels_) / sampleRate_ : 0.0;
+}
+
+bool WavFileSource::start()
+{
+  if (!loaded_)
+  {
+    return false;
+  }
+  if (!running_)
+  {
+    // Resume the clock where playback left off.
+    startTime_ = std::chrono::steady_clock::now() -
+                 std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                     std::chrono::duration<double, std::milli>(positionMs()));
+    running_ = true;
+  }
+  return true;
+}
+
+void WavFileSource::stop()
+{
+  running_ = false;
+}
+
+bool WavFileSource::read(int16_t *dest, size_t numSamples, std::chrono::milliseconds timeout)
+{
+  if (!running_ || position_ >= samples_.size())
+  {
+    return false;
+  }
+
+  // The last read may run past the end: it gets what is left, padded with
+  // silence, and the next one reports the end of the stream.
+  const size_t available = std::min(numSamples, samples_.size() - position_);
+  if (realtime_)
+  {
+    const auto deadline = std::chrono::steady_clock::now() + timeout;
+    while (clockPosition() < position_ + available)
+    {
+      if (std::chrono::steady_clock::now() >= deadline)
+      {
+        return false;
+      }
+      std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    }
+  }
+
+  std::copy(samples_.begin() + position_, samples_.begin() + position_ + available, dest);
+  std::fill(dest + available, dest + numSamples, int16_t{0});
+  position_ += available;
+  return true;
+}
+
+size_t WavFileSource::drain()
+{
+  if (!realtime_ || !running_)
+  {
+    return 0;
+  }
+  const size_t now = clockPosition();
+  const size_t dropped = now > position_ ? now - position_ : 0;
+  position_ += dropped;
+  return dropped;
+}
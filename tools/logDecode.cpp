@@ -0,0 +1,37 @@
+// Renders a binary client log (logFormat = binary) in the text log format.
+//
+//   g++ tools/logDecode.cpp src/logFormat.cpp -I include -O2 -o sarah-logdecode
+//   ./sarah-logdecode client_log.log > client_log.txt
+#include "logFormat.hpp"
+
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+
+int main(int argc, char **argv)
+{
+  if (argc != 2)
+  {
+    std::cerr << "usage: sarah-logdecode <binary log file>" << std::endl;
+    return 1;
+  }
+
+  std::ifstream file(argv[1], std::ios::binary);
+  if (!file)
+  {
+    std::cerr << "Could not open " << argv[1] << std::endl;
+    return 1;
+  }
+  const std::string data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+  std::string error;
+  const bool ok = logformat::decode(data.data(), data.size(), std::cout, error);
+  std::cout.flush();
+  if (!ok)
+  {
+    std::cerr << argv[1] << ": " << error << std::endl;
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,75 @@
+// Standalone mock orchestrator, e.g. for replaying sessions headless against a
+// known server. See mockOrchestrator.hpp for what each fault does.
+//
+//   g++ tools/mockOrchestrator.cpp src/mockOrchestrator.cpp -I include -O2 -lpthread -o sarah-mock-orchestrator
+//   ./sarah-mock-orchestrator --port 9000 --auth secret --latency-ms 150 --fail-rate 0.1
+#include "mockOrchestrator.hpp"
+
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+
+namespace
+{
+  void usage()
+  {
+    std::cerr << "usage: sarah-mock-orchestrator [--host H] [--port P] [--auth TOKEN]\n"
+                 "         [--response-bytes N] [--latency-ms N]\n"
+                 "         [--fail-rate R] [--reset-rate R] [--trickle-rate R] [--trickle-bps N]\n"
+                 "         [--seed N]"
+              << std::endl;
+  }
+}
+
+int main(int argc, char **argv)
+{
+  std::string host = "127.0.0.1";
+  int port = 9000;
+  MockOrchestratorOptions options;
+
+  for (int i = 1; i < argc; ++i)
+  {
+    const std::string arg = argv[i];
+    if (i + 1 >= argc)
+    {
+      usage();
+      return 1;
+    }
+    const char *value = argv[++i];
+    if (arg == "--host")
+      host = value;
+    else if (arg == "--port")
+      port = std::atoi(value);
+    else if (arg == "--auth")
+      options.authToken = value;
+    else if (arg == "--response-bytes")
+      options.responseBytes = std::strtoul(value, nullptr, 10);
+    else if (arg == "--latency-ms")
+      options.latencyMs = std::atoi(value);
+    else if (arg == "--fail-rate")
+      options.failRate = std::atof(value);
+    else if (arg == "--reset-rate")
+      options.resetRate = std::atof(value);
+    else if (arg == "--trickle-rate")
+      options.trickleRate = std::atof(value);
+    else if (arg == "--trickle-bps")
+      options.trickleBytesPerSecond = std::strtoul(value, nullptr, 10);
+    else if (arg == "--seed")
+      options.seed = static_cast<unsigned>(std::strtoul(value, nullptr, 10));
+    else
+    {
+      usage();
+      return 1;
+    }
+  }
+
+  MockOrchestrator server(options);
+  std::cout << "Mock orchestrator listening on " << host << ":" << port << std::endl;
+  if (!server.listen(host, port))
+  {
+    std::cerr << "Failed to listen on " << host << ":" << port << std::endl;
+    return 1;
+  }
+  return 0;
+}